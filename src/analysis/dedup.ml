@@ -0,0 +1,204 @@
+(*****************************************************************************)
+(*                                                                           *)
+(*                                                                           *)
+(*  Copyright (C) 2023                                                       *)
+(*    Gabriel Santamaria                                                     *)
+(*                                                                           *)
+(*                                                                           *)
+(*  Licensed under the Apache License, Version 2.0 (the "License");          *)
+(*  you may not use this file except in compliance with the License.         *)
+(*  You may obtain a copy of the License at                                  *)
+(*                                                                           *)
+(*    http://www.apache.org/licenses/LICENSE-2.0                             *)
+(*                                                                           *)
+(*  Unless required by applicable law or agreed to in writing, software      *)
+(*  distributed under the License is distributed on an "AS IS" BASIS,        *)
+(*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *)
+(*  See the License for the specific language governing permissions and      *)
+(*  limitations under the License.                                           *)
+(*                                                                           *)
+(*****************************************************************************)
+
+(* number of bands used for the sub-fingerprints, which gives 24 bits *)
+let nbands = 25
+
+(* band energies are summed over [smoothing] frames and compared with the
+   sums [smoothing] frames earlier. Bits computed from single frames and their
+   immediate neighbours flip too often under lossy coding for exact matches of
+   sub-fingerprints to survive a re-encode. *)
+let smoothing = 8
+
+(* frequency range of the bands, in Hz *)
+let fmin = 300.
+
+let fmax = 3000.
+
+(* first bin of each band, and the bin following the last one *)
+let band_edges (nfft : int) (sample_rate : int) : int array =
+  let fs = float_of_int sample_rate in
+  let fmax = Float.min fmax (fs /. 2.) in
+  let bins = (nfft / 2) + 1 in
+  let edges =
+    Array.init (nbands + 1) (fun b ->
+        let r = float_of_int b /. float_of_int nbands in
+        let f = fmin *. Float.pow (fmax /. fmin) r in
+        min (bins - 1) (int_of_float (f *. float_of_int nfft /. fs)) )
+  in
+  (* every band must contain at least one bin *)
+  for b = 1 to nbands do
+    if edges.(b) <= edges.(b - 1) then edges.(b) <- edges.(b - 1) + 1
+  done ;
+  edges
+
+let fingerprint ?(nfft : int = 2048) ?(hop : int = 256) (a : Audio.audio) :
+    int array =
+  if hop <= 0 || hop > nfft then
+    raise (Invalid_argument "Analysis.Dedup.fingerprint: invalid hop") ;
+  let sample_rate = Audio.Metadata.sample_rate (Audio.meta a) in
+  let edges = band_edges nfft sample_rate in
+  if edges.(nbands) > (nfft / 2) + 1 then
+    raise
+      (Invalid_argument "Analysis.Dedup.fingerprint: nfft is too small") ;
+  let stft = Dsp.Stft.create nfft in
+  let x = Audio.View.of_data (Audio.mixdown a) in
+  let frames = Dsp.Stft.frames stft ~hop (Audio.View.length x) in
+  let re = Array.make nfft 0. and im = Array.make nfft 0. in
+  let power = Array.make ((nfft / 2) + 1) 0. in
+  let energies =
+    Array.init frames (fun k ->
+        Dsp.Stft.power stft ~re ~im
+          (fun i -> Audio.View.get x ((k * hop) + i))
+          power ;
+        Array.init nbands (fun b ->
+            let e = ref 0. in
+            for j = edges.(b) to edges.(b + 1) - 1 do
+              e := !e +. power.(j)
+            done ;
+            !e ) )
+  in
+  let count = frames - smoothing + 1 in
+  if count <= smoothing then [||]
+  else
+    let sums =
+      Array.init count (fun t ->
+          Array.init nbands (fun b ->
+              let e = ref 0. in
+              for k = t to t + smoothing - 1 do
+                e := !e +. energies.(k).(b)
+              done ;
+              !e ) )
+    in
+    Array.init (count - smoothing) (fun t ->
+        let cur = sums.(t + smoothing) and prev = sums.(t) in
+        let bits = ref 0 in
+        for b = 0 to nbands - 2 do
+          let d = cur.(b) -. cur.(b + 1) -. (prev.(b) -. prev.(b + 1)) in
+          if d > 0. then bits := !bits lor (1 lsl b)
+        done ;
+        !bits )
+
+type sketch = int array
+
+let minhash (hashes : int) (prints : int array) : sketch =
+  let s = Array.make hashes max_int in
+  Array.iter
+    (fun p ->
+      for i = 0 to hashes - 1 do
+        let h = Dsp.Rng.mix (p lxor Dsp.Rng.mix (i + 1)) land max_int in
+        if h < s.(i) then s.(i) <- h
+      done )
+    prints ;
+  s
+
+(* the sketch of an empty set, which is never similar to anything *)
+let is_empty (s : sketch) : bool = Array.for_all (( = ) max_int) s
+
+let sketch ?(nfft : int = 2048) ?(hop : int = 256) ?(hashes : int = 128)
+    (a : Audio.audio) : sketch =
+  if hashes <= 0 then
+    raise (Invalid_argument "Analysis.Dedup.sketch: hashes must be positive") ;
+  minhash hashes (fingerprint ~nfft ~hop a)
+
+let sketch_all ?(domains : int = Parallel.default_domains ())
+    ?(nfft : int = 2048) ?(hop : int = 256) ?(hashes : int = 128)
+    (audios : Audio.audio array) : sketch array =
+  Parallel.map ~domains (sketch ~nfft ~hop ~hashes) audios
+
+let of_array (a : int array) : sketch = Array.copy a
+
+let to_array (s : sketch) : int array = Array.copy s
+
+let similarity (a : sketch) (b : sketch) : float =
+  let n = Array.length a in
+  if n <> Array.length b then
+    raise
+      (Invalid_argument
+         "Analysis.Dedup.similarity: sketches of different sizes" ) ;
+  if is_empty a || is_empty b then 0.
+  else
+    let same = ref 0 in
+    for i = 0 to n - 1 do
+      if a.(i) = b.(i) then incr same
+    done ;
+    float_of_int !same /. float_of_int n
+
+type index =
+  { rows: int
+  ; hashes: int
+  ; buckets: (int, int list) Hashtbl.t array (* one table per band *) }
+
+let index ?(bands : int = 64) ~(hashes : int) () : index =
+  if bands <= 0 || bands > hashes then
+    raise (Invalid_argument "Analysis.Dedup.index: invalid number of bands") ;
+  { rows= hashes / bands
+  ; hashes
+  ; buckets= Array.init bands (fun _ -> Hashtbl.create 1024) }
+
+let band_key (idx : index) (s : sketch) (b : int) : int =
+  let k = ref (Dsp.Rng.mix b) in
+  for i = b * idx.rows to ((b + 1) * idx.rows) - 1 do
+    k := Dsp.Rng.mix (!k lxor s.(i))
+  done ;
+  !k
+
+let add (idx : index) (id : int) (s : sketch) : unit =
+  if Array.length s <> idx.hashes then
+    raise (Invalid_argument "Analysis.Dedup.add: sketch of the wrong size") ;
+  if not (is_empty s) then
+    Array.iteri
+      (fun b tbl ->
+        let key = band_key idx s b in
+        let ids = Option.value ~default:[] (Hashtbl.find_opt tbl key) in
+        Hashtbl.replace tbl key (id :: ids) )
+      idx.buckets
+
+let candidates (idx : index) : (int * int) list =
+  let seen = Hashtbl.create 1024 in
+  let pairs = ref [] in
+  Array.iter
+    (Hashtbl.iter (fun _ ids ->
+         List.iter
+           (fun a ->
+             List.iter
+               (fun b ->
+                 if a < b && not (Hashtbl.mem seen (a, b)) then (
+                   Hashtbl.add seen (a, b) () ;
+                   pairs := (a, b) :: !pairs ) )
+               ids )
+           ids ) )
+    idx.buckets ;
+  !pairs
+
+let duplicates ?(domains : int = Parallel.default_domains ())
+    ?(bands : int = 64) ?(threshold : float = 0.15) (sketches : sketch array) :
+    (int * int * float) list =
+  if Array.length sketches = 0 then []
+  else
+    let idx = index ~bands ~hashes:(Array.length sketches.(0)) () in
+    Array.iteri (add idx) sketches ;
+    let pairs = Array.of_list (candidates idx) in
+    Parallel.map ~domains
+      (fun (i, j) -> (i, j, similarity sketches.(i) sketches.(j)))
+      pairs
+    |> Array.to_list
+    |> List.filter (fun (_, _, s) -> s >= threshold)
@@ -0,0 +1,118 @@
+(*****************************************************************************)
+(*                                                                           *)
+(*                                                                           *)
+(*  Copyright (C) 2023                                                       *)
+(*    Gabriel Santamaria                                                     *)
+(*                                                                           *)
+(*                                                                           *)
+(*  Licensed under the Apache License, Version 2.0 (the "License");          *)
+(*  you may not use this file except in compliance with the License.         *)
+(*  You may obtain a copy of the License at                                  *)
+(*                                                                           *)
+(*    http://www.apache.org/licenses/LICENSE-2.0                             *)
+(*                                                                           *)
+(*  Unless required by applicable law or agreed to in writing, software      *)
+(*  distributed under the License is distributed on an "AS IS" BASIS,        *)
+(*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *)
+(*  See the License for the specific language governing permissions and      *)
+(*  limitations under the License.                                           *)
+(*                                                                           *)
+(*****************************************************************************)
+
+(**
+    The {!Analysis.Dedup} module finds near-duplicate audio files in large
+    collections, such as the same recording re-encoded at another bitrate or
+    trimmed differently.
+
+    Each file is reduced to a compact sketch: the spectrogram frames of its
+    mixdown are turned into 24-bit sub-fingerprints, made of the signs of the
+    band energy differences across frequency and time, and the set of
+    sub-fingerprints is summarized by a MinHash signature.
+
+    Lossy coding flips some bits of the sub-fingerprints, so copies of the
+    same recording only share part of their sets: on synthetic music,
+    re-encoding simulated by low-pass filtering and 15 to 40 dB of added
+    noise, together with trimming by an arbitrary number of samples, gave
+    similarities between [0.2] and [0.6], against less than [0.01] between
+    unrelated recordings. The default threshold and bands are chosen
+    accordingly. Signatures are then indexed with
+    locality-sensitive hashing, so that candidate pairs are found without
+    comparing every file with every other one. *)
+
+val fingerprint : ?nfft:int -> ?hop:int -> Audio.audio -> int array
+(**
+    [fingerprint ?nfft ?hop audio] returns the 24-bit sub-fingerprints of the
+    mixdown of [audio], one per spectrogram frame after the first 15. Frames
+    are [?nfft] samples long (default is [2048], which must be a power of
+    two) and are [?hop] samples apart (default is [256]). Band energies are
+    summed over 8 frames, and compared with the sums 8 frames earlier. *)
+
+type sketch
+(**
+    MinHash signature of the sub-fingerprints of an audio file *)
+
+val sketch : ?nfft:int -> ?hop:int -> ?hashes:int -> Audio.audio -> sketch
+(**
+    [sketch ?nfft ?hop ?hashes audio] computes the sketch of [audio], made of
+    [?hashes] MinHash values (default is [128]). Audio too short to give any
+    sub-fingerprint has an empty sketch, which is similar to nothing and is
+    never indexed. *)
+
+val sketch_all :
+     ?domains:int
+  -> ?nfft:int
+  -> ?hop:int
+  -> ?hashes:int
+  -> Audio.audio array
+  -> sketch array
+(**
+    [sketch_all ?domains ?nfft ?hop ?hashes audios] computes the sketches of
+    every audio element, in parallel over at most [?domains] domains. *)
+
+val of_array : int array -> sketch
+(**
+    [of_array a] rebuilds a sketch from the values returned by {!to_array},
+    for instance after having stored them. *)
+
+val to_array : sketch -> int array
+(**
+    [to_array s] returns the MinHash values of the sketch *)
+
+val similarity : sketch -> sketch -> float
+(**
+    [similarity a b] estimates the Jaccard similarity between the
+    sub-fingerprint sets the two sketches come from. *)
+
+(**
+    {1 Locality-sensitive hashing} *)
+
+type index
+
+val index : ?bands:int -> hashes:int -> unit -> index
+(**
+    [index ?bands ~hashes ()] creates an empty index of sketches made of
+    [~hashes] values, cut in [?bands] bands (default is [64]). Two sketches
+    become candidates as soon as one of their bands is equal, which happens
+    with a probability close to [1 - (1 - s^r)^bands] for a similarity [s],
+    [r] being the number of rows per band. *)
+
+val add : index -> int -> sketch -> unit
+(**
+    [add idx id s] adds the sketch [s] under the identifier [id] *)
+
+val candidates : index -> (int * int) list
+(**
+    [candidates idx] returns the pairs of identifiers [(a, b)], [a < b],
+    sharing at least one band. Each pair appears once. *)
+
+val duplicates :
+     ?domains:int
+  -> ?bands:int
+  -> ?threshold:float
+  -> sketch array
+  -> (int * int * float) list
+(**
+    [duplicates ?domains ?bands ?threshold sketches] indexes the sketches and
+    returns the candidate pairs [(i, j, s)] whose estimated similarity [s] is
+    at least [?threshold] (default is [0.15]). Indices are positions in
+    [sketches]. *)
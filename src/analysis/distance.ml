@@ -0,0 +1,173 @@
+(*****************************************************************************)
+(*                                                                           *)
+(*                                                                           *)
+(*  Copyright (C) 2023                                                       *)
+(*    Gabriel Santamaria                                                     *)
+(*                                                                           *)
+(*                                                                           *)
+(*  Licensed under the Apache License, Version 2.0 (the "License");          *)
+(*  you may not use this file except in compliance with the License.         *)
+(*  You may obtain a copy of the License at                                  *)
+(*                                                                           *)
+(*    http://www.apache.org/licenses/LICENSE-2.0                             *)
+(*                                                                           *)
+(*  Unless required by applicable law or agreed to in writing, software      *)
+(*  distributed under the License is distributed on an "AS IS" BASIS,        *)
+(*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *)
+(*  See the License for the specific language governing permissions and      *)
+(*  limitations under the License.                                           *)
+(*                                                                           *)
+(*****************************************************************************)
+
+type spectrogram = (float, Bigarray.float32_elt) Audio.G.t
+
+type complex_spectrogram = (Complex.t, Bigarray.complex32_elt) Audio.G.t
+
+(* the matrix [m] seen as a two dimensional bigarray, without any copy *)
+let matrix (m : ('a, 'b) Audio.G.t) :
+    ('a, 'b, Bigarray.c_layout) Bigarray.Array2.t =
+  match Audio.G.shape m with
+  | [|rows; count|] ->
+      Bigarray.reshape_2 m rows count
+  | _ ->
+      raise (Invalid_argument "Analysis.Distance: expected a matrix")
+
+(* mean of [kernel i j] over the paired frames [i] of the reference and [j]
+   of the other input, along the warping path if [align]. Both inputs have
+   [n] and [m] frames. *)
+let average ~(align : bool) ~(band : int option)
+    ~(kernel : int -> int -> float) (n : int) (m : int) : float =
+  if n = 0 || m = 0 then Float.nan
+  else if not align then (
+    let count = min n m in
+    let s = ref 0. in
+    for t = 0 to count - 1 do
+      s := !s +. kernel t t
+    done ;
+    !s /. float_of_int count )
+  else
+    (* the band is widened enough to always reach the last cell *)
+    let band =
+      match band with Some b -> max b (abs (n - m)) | None -> max n m
+    in
+    (* two rows of accumulated cost and of path length *)
+    let cost = Array.make (m + 1) Float.infinity
+    and len = Array.make (m + 1) 0 in
+    let prev_cost = Array.make (m + 1) Float.infinity
+    and prev_len = Array.make (m + 1) 0 in
+    prev_cost.(0) <- 0. ;
+    for i = 1 to n do
+      Array.fill cost 0 (m + 1) Float.infinity ;
+      let lo = max 1 (i - band) and hi = min m (i + band) in
+      for j = lo to hi do
+        let d = kernel (i - 1) (j - 1) in
+        let c, l =
+          let diag = prev_cost.(j - 1) and up = prev_cost.(j)
+          and left = cost.(j - 1) in
+          if diag <= up && diag <= left then (diag, prev_len.(j - 1))
+          else if up <= left then (up, prev_len.(j))
+          else (left, len.(j - 1))
+        in
+        cost.(j) <- c +. d ;
+        len.(j) <- l + 1
+      done ;
+      Array.blit cost 0 prev_cost 0 (m + 1) ;
+      Array.blit len 0 prev_len 0 (m + 1) ;
+      prev_cost.(0) <- Float.infinity
+    done ;
+    prev_cost.(m) /. float_of_int prev_len.(m)
+
+let same_rows (rows : int) (rows' : int) : unit =
+  if rows <> rows' then
+    raise (Invalid_argument "Analysis.Distance: inputs have different rows")
+
+(* log-spectral distance between the matrices [x] and [y], whose element [r]
+   of frame [t] has the power [px r t] and [py r t]. The levels of the
+   current reference frame are kept, as the warping path pairs it with
+   several frames of [y] in a row. *)
+let lsd ~(align : bool) ~(band : int option) ~(floor : float) ~(rows : int)
+    ~(px : int -> int -> float) ~(py : int -> int -> float) (n : int) (m : int)
+    : float =
+  let level v = 10. *. Float.log10 (Float.max v floor) in
+  let current = Array.make rows 0. and cached = ref (-1) in
+  let kernel i j =
+    if i <> !cached then (
+      for r = 0 to rows - 1 do
+        Array.unsafe_set current r (level (px r i))
+      done ;
+      cached := i ) ;
+    let s = ref 0. in
+    for r = 0 to rows - 1 do
+      let d = Array.unsafe_get current r -. level (py r j) in
+      s := !s +. (d *. d)
+    done ;
+    Float.sqrt (!s /. float_of_int rows)
+  in
+  average ~align ~band ~kernel n m
+
+let log_spectral ?(align : bool = false) ?band ?(floor : float = 1e-10)
+    ~(reference : spectrogram) (power : spectrogram) : float =
+  let x = matrix reference and y = matrix power in
+  let rows = Bigarray.Array2.dim1 x in
+  same_rows rows (Bigarray.Array2.dim1 y) ;
+  lsd ~align ~band ~floor ~rows
+    ~px:(fun r t -> Bigarray.Array2.unsafe_get x r t)
+    ~py:(fun r t -> Bigarray.Array2.unsafe_get y r t)
+    (Bigarray.Array2.dim2 x) (Bigarray.Array2.dim2 y)
+
+(* [Feature.Spectral.specgram] returns the power spectral density as complex
+   values with a null imaginary part, so the modulus of each element is its
+   power *)
+let log_spectral_complex ?(align : bool = false) ?band
+    ?(floor : float = 1e-10) ~(reference : complex_spectrogram)
+    (power : complex_spectrogram) : float =
+  let x = matrix reference and y = matrix power in
+  let rows = Bigarray.Array2.dim1 x in
+  same_rows rows (Bigarray.Array2.dim1 y) ;
+  lsd ~align ~band ~floor ~rows
+    ~px:(fun r t -> Complex.norm (Bigarray.Array2.unsafe_get x r t))
+    ~py:(fun r t -> Complex.norm (Bigarray.Array2.unsafe_get y r t))
+    (Bigarray.Array2.dim2 x) (Bigarray.Array2.dim2 y)
+
+(* 10 / ln 10 * sqrt 2 *)
+let mcd_scale = 10. /. Float.log 10. *. Float.sqrt 2.
+
+let mcd ?(align : bool = false) ?band ~(reference : spectrogram)
+    (cepstra : spectrogram) : float =
+  let x = matrix reference and y = matrix cepstra in
+  let rows = Bigarray.Array2.dim1 x in
+  same_rows rows (Bigarray.Array2.dim1 y) ;
+  let kernel i j =
+    let s = ref 0. in
+    for k = 1 to rows - 1 do
+      let d =
+        Bigarray.Array2.unsafe_get x k i -. Bigarray.Array2.unsafe_get y k j
+      in
+      s := !s +. (d *. d)
+    done ;
+    mcd_scale *. Float.sqrt !s
+  in
+  average ~align ~band ~kernel (Bigarray.Array2.dim2 x)
+    (Bigarray.Array2.dim2 y)
+
+let log_spectral_all ?(domains : int = Parallel.default_domains ()) ?align
+    ?band ?floor (pairs : (spectrogram * spectrogram) array) : float array =
+  Parallel.map ~domains
+    (fun (reference, power) ->
+      log_spectral ?align ?band ?floor ~reference power )
+    pairs
+
+let log_spectral_complex_all ?(domains : int = Parallel.default_domains ())
+    ?align ?band ?floor
+    (pairs : (complex_spectrogram * complex_spectrogram) array) : float array
+    =
+  Parallel.map ~domains
+    (fun (reference, power) ->
+      log_spectral_complex ?align ?band ?floor ~reference power )
+    pairs
+
+let mcd_all ?(domains : int = Parallel.default_domains ()) ?align ?band
+    (pairs : (spectrogram * spectrogram) array) : float array =
+  Parallel.map ~domains
+    (fun (reference, cepstra) -> mcd ?align ?band ~reference cepstra)
+    pairs
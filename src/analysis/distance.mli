@@ -0,0 +1,106 @@
+(*****************************************************************************)
+(*                                                                           *)
+(*                                                                           *)
+(*  Copyright (C) 2023                                                       *)
+(*    Gabriel Santamaria                                                     *)
+(*                                                                           *)
+(*                                                                           *)
+(*  Licensed under the Apache License, Version 2.0 (the "License");          *)
+(*  you may not use this file except in compliance with the License.         *)
+(*  You may obtain a copy of the License at                                  *)
+(*                                                                           *)
+(*    http://www.apache.org/licenses/LICENSE-2.0                             *)
+(*                                                                           *)
+(*  Unless required by applicable law or agreed to in writing, software      *)
+(*  distributed under the License is distributed on an "AS IS" BASIS,        *)
+(*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *)
+(*  See the License for the specific language governing permissions and      *)
+(*  limitations under the License.                                           *)
+(*                                                                           *)
+(*****************************************************************************)
+
+(**
+    The {!Analysis.Distance} module compares spectral representations of a
+    reference and a synthesized or decoded signal, frame by frame. Inputs are
+    matrices of shape [\[|rows; frames|\]], such as the power spectra
+    obtained from {!Feature.Mel.spectrogram}, the complex power spectral
+    densities returned by {!Feature.Spectral.specgram}, and the cepstra from
+    {!Feature.Mel.mfcc}.
+
+    Distances are computed by per-frame kernels reading the columns of both
+    inputs in place, levels being computed on the fly, so neither a copy of
+    the inputs nor a difference spectrogram is ever built. When [~align] is
+    set, frames are paired along the dynamic time warping path minimizing the
+    total distance, optionally restricted to a Sakoe-Chiba band of [?band]
+    frames, and the distance is averaged along that path. Otherwise the first
+    frames of both inputs are paired, up to the shortest one. *)
+
+type spectrogram = (float, Bigarray.float32_elt) Audio.G.t
+
+type complex_spectrogram = (Complex.t, Bigarray.complex32_elt) Audio.G.t
+
+val log_spectral :
+     ?align:bool
+  -> ?band:int
+  -> ?floor:float
+  -> reference:spectrogram
+  -> spectrogram
+  -> float
+(**
+    [log_spectral ?align ?band ?floor ~reference power] returns the
+    log-spectral distance, in dB, between two power spectrograms: the root
+    mean square difference of their levels, floored at [?floor] (default is
+    [1e-10]), averaged over frames. *)
+
+val log_spectral_complex :
+     ?align:bool
+  -> ?band:int
+  -> ?floor:float
+  -> reference:complex_spectrogram
+  -> complex_spectrogram
+  -> float
+(**
+    [log_spectral_complex ?align ?band ?floor ~reference power] works like
+    {!log_spectral} on the output of {!Feature.Spectral.specgram}, taking the
+    modulus of each element as its power. *)
+
+val mcd :
+  ?align:bool -> ?band:int -> reference:spectrogram -> spectrogram -> float
+(**
+    [mcd ?align ?band ~reference cepstra] returns the mel-cepstral distortion,
+    in dB, between two sequences of cepstra, excluding the energy coefficient
+    [c0]. *)
+
+val log_spectral_all :
+     ?domains:int
+  -> ?align:bool
+  -> ?band:int
+  -> ?floor:float
+  -> (spectrogram * spectrogram) array
+  -> float array
+(**
+    [log_spectral_all ?domains ?align ?band ?floor pairs] computes the
+    log-spectral distance of each pair [(reference, power)], in parallel over
+    at most [?domains] domains. *)
+
+val log_spectral_complex_all :
+     ?domains:int
+  -> ?align:bool
+  -> ?band:int
+  -> ?floor:float
+  -> (complex_spectrogram * complex_spectrogram) array
+  -> float array
+(**
+    [log_spectral_complex_all ?domains ?align ?band ?floor pairs] is the
+    batch version of {!log_spectral_complex}. *)
+
+val mcd_all :
+     ?domains:int
+  -> ?align:bool
+  -> ?band:int
+  -> (spectrogram * spectrogram) array
+  -> float array
+(**
+    [mcd_all ?domains ?align ?band pairs] computes the mel-cepstral
+    distortion of each pair [(reference, cepstra)], in parallel over at most
+    [?domains] domains. *)
@@ -0,0 +1,237 @@
+(*****************************************************************************)
+(*                                                                           *)
+(*                                                                           *)
+(*  Copyright (C) 2023                                                       *)
+(*    Gabriel Santamaria                                                     *)
+(*                                                                           *)
+(*                                                                           *)
+(*  Licensed under the Apache License, Version 2.0 (the "License");          *)
+(*  you may not use this file except in compliance with the License.         *)
+(*  You may obtain a copy of the License at                                  *)
+(*                                                                           *)
+(*    http://www.apache.org/licenses/LICENSE-2.0                             *)
+(*                                                                           *)
+(*  Unless required by applicable law or agreed to in writing, software      *)
+(*  distributed under the License is distributed on an "AS IS" BASIS,        *)
+(*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *)
+(*  See the License for the specific language governing permissions and      *)
+(*  limitations under the License.                                           *)
+(*                                                                           *)
+(*****************************************************************************)
+
+type quality = Major | Minor
+
+type chord = No_chord | Chord of {root: int; quality: quality}
+
+let vocabulary : chord array =
+  Array.append [|No_chord|]
+    (Array.init 24 (fun i ->
+         Chord {root= i mod 12; quality= (if i < 12 then Major else Minor)} ) )
+
+let names =
+  [|"C"; "C#"; "D"; "D#"; "E"; "F"; "F#"; "G"; "G#"; "A"; "A#"; "B"|]
+
+let chord_name (c : chord) : string =
+  match c with
+  | No_chord ->
+      "N"
+  | Chord {root; quality= Major} ->
+      names.(root) ^ ":maj"
+  | Chord {root; quality= Minor} ->
+      names.(root) ^ ":min"
+
+type chroma = (float, Bigarray.float32_elt) Audio.G.t
+
+let dimensions (m : chroma) : int * int =
+  match Audio.G.shape m with
+  | [|rows; frames|] ->
+      (rows, frames)
+  | _ ->
+      raise (Invalid_argument "Analysis.Harmony: expected a matrix")
+
+(* unit templates of the vocabulary, one per row *)
+let templates : chroma =
+  let notes = function
+    | No_chord ->
+        List.init 12 Fun.id
+    | Chord {root; quality= Major} ->
+        [root; (root + 4) mod 12; (root + 7) mod 12]
+    | Chord {root; quality= Minor} ->
+        [root; (root + 3) mod 12; (root + 7) mod 12]
+  in
+  let t = Audio.G.zeros Bigarray.Float32 [|Array.length vocabulary; 12|] in
+  Array.iteri
+    (fun i c ->
+      let notes = notes c in
+      let v = 1. /. Float.sqrt (float_of_int (List.length notes)) in
+      List.iter (fun n -> Audio.G.set t [|i; n|] v) notes )
+    vocabulary ;
+  t
+
+let emissions ?(sharpness : float = 20.) (chroma : chroma) : chroma =
+  let rows, frames = dimensions chroma in
+  if rows <> 12 then
+    raise (Invalid_argument "Analysis.Harmony.emissions: expected 12 classes") ;
+  (* frames scaled to unit norm, silent ones replaced by flat chroma *)
+  let src = Bigarray.reshape_2 chroma 12 frames in
+  let unit = Audio.G.zeros Bigarray.Float32 [|12; frames|] in
+  let dst = Bigarray.reshape_2 unit 12 frames in
+  for t = 0 to frames - 1 do
+    let s = ref 0. in
+    for c = 0 to 11 do
+      let v = Bigarray.Array2.unsafe_get src c t in
+      s := !s +. (v *. v)
+    done ;
+    let norm = Float.sqrt !s in
+    for c = 0 to 11 do
+      let v =
+        if norm > 1e-8 then Bigarray.Array2.unsafe_get src c t /. norm
+        else 1. /. Float.sqrt 12.
+      in
+      Bigarray.Array2.unsafe_set dst c t v
+    done
+  done ;
+  let scores = Audio.G.dot templates unit in
+  Audio.G.mul_scalar_ scores sharpness ;
+  scores
+
+let viterbi ~(initial : float array) ~(transition : float array array)
+    (emissions : (float, Bigarray.float32_elt) Audio.G.t) : int array =
+  let states, frames = dimensions emissions in
+  if
+    states > 32767
+    || Array.length initial <> states
+    || Array.length transition <> states
+    || Array.exists (fun r -> Array.length r <> states) transition
+  then raise (Invalid_argument "Analysis.Harmony.viterbi: invalid dimensions") ;
+  if frames = 0 then [||]
+  else
+    let e = Bigarray.reshape_2 emissions states frames in
+    (* column [j] holds the log probabilities of reaching the state [j], so
+       the inner loop runs over contiguous memory *)
+    let into =
+      Array.init states (fun j ->
+          Array.init states (fun i -> transition.(i).(j)) )
+    in
+    let back =
+      Bigarray.Array2.create Bigarray.int16_signed Bigarray.c_layout frames
+        states
+    in
+    let delta =
+      ref
+        (Array.init states (fun s -> initial.(s) +. Bigarray.Array2.get e s 0))
+    in
+    let next = ref (Array.make states 0.) in
+    for t = 1 to frames - 1 do
+      let d = !delta and nd = !next in
+      for j = 0 to states - 1 do
+        let col = into.(j) in
+        let best = ref Float.neg_infinity and arg = ref 0 in
+        for i = 0 to states - 1 do
+          let v = Array.unsafe_get d i +. Array.unsafe_get col i in
+          if v > !best then (
+            best := v ;
+            arg := i )
+        done ;
+        nd.(j) <- !best +. Bigarray.Array2.unsafe_get e j t ;
+        Bigarray.Array2.unsafe_set back t j !arg
+      done ;
+      delta := nd ;
+      next := d
+    done ;
+    let path = Array.make frames 0 in
+    let d = !delta and last = ref 0 in
+    Array.iteri (fun s v -> if v > d.(!last) then last := s) d ;
+    path.(frames - 1) <- !last ;
+    for t = frames - 1 downto 1 do
+      path.(t - 1) <- Bigarray.Array2.unsafe_get back t path.(t)
+    done ;
+    path
+
+type segment = {chord: chord; start: int; stop: int}
+
+let chords ?(self : float = 0.9) ?sharpness (chroma : chroma) : segment array
+    =
+  if self <= 0. || self >= 1. then
+    raise (Invalid_argument "Analysis.Harmony.chords: invalid self") ;
+  let states = Array.length vocabulary in
+  let stay = Float.log self
+  and move = Float.log ((1. -. self) /. float_of_int (states - 1)) in
+  let transition =
+    Array.init states (fun i ->
+        Array.init states (fun j -> if i = j then stay else move) )
+  in
+  let initial = Array.make states (-.Float.log (float_of_int states)) in
+  let path = viterbi ~initial ~transition (emissions ?sharpness chroma) in
+  (* runs of the same state *)
+  let segments = ref [] and start = ref 0 in
+  Array.iteri
+    (fun t s ->
+      if t = Array.length path - 1 || path.(t + 1) <> s then (
+        let segment = {chord= vocabulary.(s); start= !start; stop= t + 1} in
+        segments := segment :: !segments ;
+        start := t + 1 ) )
+    path ;
+  Array.of_list (List.rev !segments)
+
+type key = {tonic: int; mode: quality}
+
+let key_name (k : key) : string =
+  names.(k.tonic) ^ match k.mode with Major -> " major" | Minor -> " minor"
+
+let major_profile =
+  [|6.35; 2.23; 3.48; 2.33; 4.38; 4.09; 2.52; 5.19; 2.39; 3.66; 2.29; 2.88|]
+
+let minor_profile =
+  [|6.33; 2.68; 3.52; 5.38; 2.60; 3.53; 2.54; 4.75; 3.98; 2.69; 3.34; 3.17|]
+
+(* centered and scaled to unit norm, so that a dot product is a correlation *)
+let standardize (v : float array) : float array =
+  let mean = Array.fold_left ( +. ) 0. v /. float_of_int (Array.length v) in
+  let v = Array.map (fun x -> x -. mean) v in
+  let norm = Float.sqrt (Array.fold_left (fun s x -> s +. (x *. x)) 0. v) in
+  if norm > 0. then Array.map (fun x -> x /. norm) v else v
+
+let profiles : (key * float array) array =
+  Array.init 24 (fun i ->
+      let tonic = i mod 12 in
+      let mode, p =
+        if i < 12 then (Major, major_profile) else (Minor, minor_profile)
+      in
+      let rotated = Array.init 12 (fun c -> p.((c - tonic + 12) mod 12)) in
+      ({tonic; mode}, standardize rotated) )
+
+let key (chroma : chroma) : key =
+  let rows, frames = dimensions chroma in
+  if rows <> 12 then
+    raise (Invalid_argument "Analysis.Harmony.key: expected 12 classes") ;
+  let m = Bigarray.reshape_2 chroma 12 frames in
+  let mean =
+    Array.init 12 (fun c ->
+        let s = ref 0. in
+        for t = 0 to frames - 1 do
+          s := !s +. Bigarray.Array2.unsafe_get m c t
+        done ;
+        !s )
+    |> standardize
+  in
+  let score p =
+    let s = ref 0. in
+    Array.iteri (fun c v -> s := !s +. (v *. mean.(c))) p ;
+    !s
+  in
+  let best, _ =
+    Array.fold_left
+      (fun (best, top) (k, p) ->
+        let s = score p in
+        if s > top then (k, s) else (best, top) )
+      ({tonic= 0; mode= Major}, Float.neg_infinity)
+      profiles
+  in
+  best
+
+let analyze_all ?(domains : int = Parallel.default_domains ()) ?self
+    ?sharpness (chromas : chroma array) : (segment array * key) array =
+  Parallel.map ~domains
+    (fun chroma -> (chords ?self ?sharpness chroma, key chroma))
+    chromas
@@ -0,0 +1,97 @@
+(*****************************************************************************)
+(*                                                                           *)
+(*                                                                           *)
+(*  Copyright (C) 2023                                                       *)
+(*    Gabriel Santamaria                                                     *)
+(*                                                                           *)
+(*                                                                           *)
+(*  Licensed under the Apache License, Version 2.0 (the "License");          *)
+(*  you may not use this file except in compliance with the License.         *)
+(*  You may obtain a copy of the License at                                  *)
+(*                                                                           *)
+(*    http://www.apache.org/licenses/LICENSE-2.0                             *)
+(*                                                                           *)
+(*  Unless required by applicable law or agreed to in writing, software      *)
+(*  distributed under the License is distributed on an "AS IS" BASIS,        *)
+(*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *)
+(*  See the License for the specific language governing permissions and      *)
+(*  limitations under the License.                                           *)
+(*                                                                           *)
+(*****************************************************************************)
+
+(**
+    The {!Analysis.Harmony} module estimates the chords and the key of a
+    piece from its chromagram, as computed by {!Feature.Chroma.chromagram}.
+
+    Every frame is scored against the templates of the vocabulary with a
+    single matrix product, and the chord sequence is smoothed by an HMM
+    decoded with the Viterbi algorithm. *)
+
+type quality = Major | Minor
+
+type chord = No_chord | Chord of {root: int; quality: quality}
+(**
+    Chords are triads, [root] being a pitch class ([0] is [C]) *)
+
+val vocabulary : chord array
+(**
+    The chords recognized: [No_chord], then the major and minor triads on
+    every root. *)
+
+val chord_name : chord -> string
+(** [chord_name chord] returns the usual name of [chord], like ["C#:min"] *)
+
+type chroma = (float, Bigarray.float32_elt) Audio.G.t
+
+val emissions : ?sharpness:float -> chroma -> chroma
+(**
+    [emissions ?sharpness chroma] returns the log emission scores of each
+    chord of {!vocabulary} at each frame of [chroma], as a matrix of shape
+    [\[|chords; frames|\]]. The score is the cosine similarity between the
+    frame and the chord template, multiplied by [?sharpness] (default is
+    [20.]). Silent frames are scored as flat chroma. *)
+
+val viterbi :
+     initial:float array
+  -> transition:float array array
+  -> (float, Bigarray.float32_elt) Audio.G.t
+  -> int array
+(**
+    [viterbi ~initial ~transition emissions] returns the most likely state at
+    each frame of [emissions], a matrix of shape [\[|states; frames|\]]. All
+    arguments are log probabilities: [initial.(s)] for the first state and
+    [transition.(i).(j)] for moving from state [i] to state [j].
+
+    Backpointers are stored as 16-bit integers, so there may be at most
+    [32767] states.
+
+    @raise Invalid_argument if the dimensions of the arguments disagree. *)
+
+type segment = {chord: chord; start: int; stop: int}
+(**
+    A chord spanning the frames [start] (inclusive) to [stop] (exclusive) *)
+
+val chords : ?self:float -> ?sharpness:float -> chroma -> segment array
+(**
+    [chords ?self ?sharpness chroma] recognizes the chords of [chroma], the
+    probability of staying on the same chord from a frame to the next being
+    [?self] (default is [0.9]). *)
+
+type key = {tonic: int; mode: quality}
+
+val key_name : key -> string
+
+val key : chroma -> key
+(**
+    [key chroma] estimates the key of [chroma] by correlating its average
+    with the Krumhansl-Kessler profiles of the 24 major and minor keys. *)
+
+val analyze_all :
+     ?domains:int
+  -> ?self:float
+  -> ?sharpness:float
+  -> chroma array
+  -> (segment array * key) array
+(**
+    [analyze_all ?domains ?self ?sharpness chromas] recognizes the chords and
+    the key of each track, in parallel over at most [?domains] domains. *)
@@ -0,0 +1,222 @@
+(*****************************************************************************)
+(*                                                                           *)
+(*                                                                           *)
+(*  Copyright (C) 2023                                                       *)
+(*    Gabriel Santamaria                                                     *)
+(*                                                                           *)
+(*                                                                           *)
+(*  Licensed under the Apache License, Version 2.0 (the "License");          *)
+(*  you may not use this file except in compliance with the License.         *)
+(*  You may obtain a copy of the License at                                  *)
+(*                                                                           *)
+(*    http://www.apache.org/licenses/LICENSE-2.0                             *)
+(*                                                                           *)
+(*  Unless required by applicable law or agreed to in writing, software      *)
+(*  distributed under the License is distributed on an "AS IS" BASIS,        *)
+(*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *)
+(*  See the License for the specific language governing permissions and      *)
+(*  limitations under the License.                                           *)
+(*                                                                           *)
+(*****************************************************************************)
+
+type hit = {position: int; time: float; score: float}
+
+(* Normalized cross-correlation of a template of [m] frames of [bands] values,
+   given as [template.(band).(k)], against a sequence of [n] frames whose
+   values are returned by [get band i]. The template is made zero-mean so the
+   mean of the sequence under it doesn't contribute to the correlation, and
+   its energy is computed from running sums over each block.
+
+   Returns, for each block, the local maxima whose score is at least
+   [threshold] as [(position, score)]. *)
+let ncc ~domains ~block ~threshold (template : float array array) (m : int)
+    (n : int) (get : int -> int -> float) : (int * float) list array =
+  let bands = Array.length template in
+  let size = Dsp.Fft.next_pow2 (max block (2 * m)) in
+  let plan = Dsp.Fft.plan size in
+  let valid = size - m + 1 in
+  let count = float_of_int (m * bands) in
+  let mean =
+    Array.fold_left (Array.fold_left ( +. )) 0. template /. count
+  in
+  let norm = ref 0. in
+  (* conjugated spectra of the zero-mean template *)
+  let spectra =
+    Array.map
+      (fun h ->
+        let re = Array.make size 0. and im = Array.make size 0. in
+        for k = 0 to m - 1 do
+          re.(k) <- h.(k) -. mean ;
+          norm := !norm +. (re.(k) *. re.(k))
+        done ;
+        Dsp.Fft.forward plan re im ;
+        (re, Array.map Float.neg im) )
+      template
+  in
+  let norm = Float.sqrt !norm in
+  let positions = max 0 (n - m + 1) in
+  let blocks = (positions + valid - 1) / valid in
+  let hits = Array.make blocks [] in
+  Parallel.parallel_for ~domains blocks (fun b ->
+      let start = b * valid in
+      let len = min size (n - start) in
+      let re = Array.make size 0. and im = Array.make size 0. in
+      let acc_re = Array.make size 0. and acc_im = Array.make size 0. in
+      let s1 = Array.make (len + 1) 0. and s2 = Array.make (len + 1) 0. in
+      Array.iteri
+        (fun band (h_re, h_im) ->
+          for k = 0 to size - 1 do
+            let x = if k < len then get band (start + k) else 0. in
+            re.(k) <- x ;
+            im.(k) <- 0. ;
+            if k < len then (
+              s1.(k + 1) <- s1.(k + 1) +. x ;
+              s2.(k + 1) <- s2.(k + 1) +. (x *. x) )
+          done ;
+          Dsp.Fft.forward plan re im ;
+          for k = 0 to size - 1 do
+            let xr = re.(k) and xi = im.(k) in
+            acc_re.(k) <- acc_re.(k) +. (xr *. h_re.(k)) -. (xi *. h_im.(k)) ;
+            acc_im.(k) <- acc_im.(k) +. (xr *. h_im.(k)) +. (xi *. h_re.(k))
+          done )
+        spectra ;
+      Dsp.Fft.inverse plan acc_re acc_im ;
+      for k = 1 to len do
+        s1.(k) <- s1.(k) +. s1.(k - 1) ;
+        s2.(k) <- s2.(k) +. s2.(k - 1)
+      done ;
+      let last = min valid (positions - start) in
+      let score t =
+        let sum = s1.(t + m) -. s1.(t) and sq = s2.(t + m) -. s2.(t) in
+        let energy = sq -. (sum *. sum /. count) in
+        if energy <= 1e-12 then 0.
+        else acc_re.(t) /. (norm *. Float.sqrt energy)
+      in
+      let scores = Array.init last score in
+      let found = ref [] in
+      for t = last - 1 downto 0 do
+        let s = scores.(t) in
+        if
+          s >= threshold
+          && (t = 0 || s >= scores.(t - 1))
+          && (t = last - 1 || s > scores.(t + 1))
+        then found := (start + t, s) :: !found
+      done ;
+      hits.(b) <- !found ) ;
+  hits
+
+(* keeps the best candidates that are at least [min_distance] apart *)
+let select (min_distance : int) (candidates : (int * float) list array) :
+    (int * float) list =
+  let sorted =
+    List.sort
+      (fun (_, a) (_, b) -> Float.compare b a)
+      (List.concat (Array.to_list candidates))
+  in
+  List.fold_left
+    (fun kept (p, s) ->
+      if List.exists (fun (q, _) -> abs (p - q) < min_distance) kept then kept
+      else (p, s) :: kept )
+    [] sorted
+  |> List.sort (fun (a, _) (b, _) -> Int.compare a b)
+
+let check_rates (fname : string) (template : Audio.audio) (a : Audio.audio) =
+  let rate x = Audio.Metadata.sample_rate (Audio.meta x) in
+  if rate template <> rate a then
+    raise
+      (Invalid_argument
+         (fname ^ ": the template and the audio have different sample rates") )
+
+let find ?(domains : int = Parallel.default_domains ())
+    ?(block : int = 65536) ?(threshold : float = 0.7) ?min_distance
+    ~(template : Audio.audio) (a : Audio.audio) : hit list =
+  check_rates "Analysis.Matching.find" template a ;
+  let t = Audio.View.of_data (Audio.mixdown template)
+  and x = Audio.View.of_data (Audio.mixdown a) in
+  let m = Audio.View.length t and n = Audio.View.length x in
+  if m = 0 then
+    raise (Invalid_argument "Analysis.Matching.find: empty template") ;
+  let min_distance = Option.value ~default:m min_distance in
+  let sample_rate = float_of_int (Audio.Metadata.sample_rate (Audio.meta a)) in
+  ncc ~domains ~block ~threshold
+    [|Array.init m (Audio.View.get t)|]
+    m n
+    (fun _ i -> Audio.View.get x i)
+  |> select min_distance
+  |> List.map (fun (position, score) ->
+         {position; time= float_of_int position /. sample_rate; score} )
+
+(* log band energies of the frames of a mono signal, as [bands] rows of
+   [frames] values *)
+let band_energies ~domains ~nfft ~hop ~bands ~sample_rate (x : Audio.View.t)
+    : float array array * int =
+  let stft = Dsp.Stft.create nfft in
+  let frames = Dsp.Stft.frames stft ~hop (Audio.View.length x) in
+  (* log-spaced edges from 50 Hz to the Nyquist frequency *)
+  let half = nfft / 2 in
+  let fmin = 50. *. float_of_int nfft /. float_of_int sample_rate in
+  let edges =
+    Array.init (bands + 1) (fun b ->
+        let r = float_of_int b /. float_of_int bands in
+        let f = fmin *. Float.pow (float_of_int half /. fmin) r in
+        min half (int_of_float f) )
+  in
+  for b = 1 to bands do
+    if edges.(b) <= edges.(b - 1) then edges.(b) <- edges.(b - 1) + 1
+  done ;
+  if edges.(bands) > half + 1 then
+    raise
+      (Invalid_argument
+         "Analysis.Matching.find_spectral: too many bands for nfft" ) ;
+  let out = Array.init bands (fun _ -> Array.make frames 0.) in
+  Parallel.chunks ~domains ~chunk:256 frames (fun first stop ->
+      let re = Array.make nfft 0. and im = Array.make nfft 0. in
+      let power = Array.make (half + 1) 0. in
+      for f = first to stop - 1 do
+        Dsp.Stft.power stft ~re ~im
+          (fun i -> Audio.View.get x ((f * hop) + i))
+          power ;
+        for b = 0 to bands - 1 do
+          let e = ref 1e-10 in
+          for k = edges.(b) to min half (edges.(b + 1) - 1) do
+            e := !e +. power.(k)
+          done ;
+          out.(b).(f) <- Float.log !e
+        done
+      done ) ;
+  (out, frames)
+
+(* frame to frame differences of the rows of [e] *)
+let deltas (e : float array array) : float array array =
+  Array.map
+    (fun row ->
+      Array.init
+        (max 0 (Array.length row - 1))
+        (fun i -> row.(i + 1) -. row.(i)) )
+    e
+
+let find_spectral ?(domains : int = Parallel.default_domains ())
+    ?(nfft : int = 1024) ?(hop : int = 256) ?(bands : int = 32)
+    ?(threshold : float = 0.5) ?min_distance ~(template : Audio.audio)
+    (a : Audio.audio) : hit list =
+  if hop <= 0 then
+    raise (Invalid_argument "Analysis.Matching.find_spectral: invalid hop") ;
+  check_rates "Analysis.Matching.find_spectral" template a ;
+  let sample_rate = Audio.Metadata.sample_rate (Audio.meta a) in
+  let features audio =
+    let x = Audio.View.of_data (Audio.mixdown audio) in
+    let e, frames = band_energies ~domains ~nfft ~hop ~bands ~sample_rate x in
+    (deltas e, max 0 (frames - 1))
+  in
+  let h, m = features template in
+  let x, n = features a in
+  if m = 0 then
+    raise
+      (Invalid_argument "Analysis.Matching.find_spectral: template too short") ;
+  let min_distance = Option.value ~default:m min_distance in
+  ncc ~domains ~block:1024 ~threshold h m n (fun band i -> x.(band).(i))
+  |> select min_distance
+  |> List.map (fun (position, score) ->
+         { position
+         ; time= float_of_int (position * hop) /. float_of_int sample_rate
+         ; score } )
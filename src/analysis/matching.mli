@@ -0,0 +1,76 @@
+(*****************************************************************************)
+(*                                                                           *)
+(*                                                                           *)
+(*  Copyright (C) 2023                                                       *)
+(*    Gabriel Santamaria                                                     *)
+(*                                                                           *)
+(*                                                                           *)
+(*  Licensed under the Apache License, Version 2.0 (the "License");          *)
+(*  you may not use this file except in compliance with the License.         *)
+(*  You may obtain a copy of the License at                                  *)
+(*                                                                           *)
+(*    http://www.apache.org/licenses/LICENSE-2.0                             *)
+(*                                                                           *)
+(*  Unless required by applicable law or agreed to in writing, software      *)
+(*  distributed under the License is distributed on an "AS IS" BASIS,        *)
+(*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *)
+(*  See the License for the specific language governing permissions and      *)
+(*  limitations under the License.                                           *)
+(*                                                                           *)
+(*****************************************************************************)
+
+(**
+    The {!Analysis.Matching} module looks for the occurrences of a known sound,
+    the template, in long recordings.
+
+    The template is compared to every position of the recording with a
+    normalized cross-correlation. Correlations are computed block by block
+    with FFTs (overlap-save), blocks being processed in parallel, and the
+    energy of the recording under the template is obtained from running
+    sums, so the cost per sample does not depend on the length of the
+    template. *)
+
+type hit =
+  { position: int  (** first frame of the occurrence in the recording *)
+  ; time: float  (** same position, in seconds *)
+  ; score: float  (** normalized correlation, between [-1] and [1] *) }
+
+val find :
+     ?domains:int
+  -> ?block:int
+  -> ?threshold:float
+  -> ?min_distance:int
+  -> template:Audio.audio
+  -> Audio.audio
+  -> hit list
+(**
+    [find ?domains ?block ?threshold ?min_distance ~template audio] returns
+    the occurrences of [~template] in [audio], sorted by position. Channels
+    are mixed down before matching.
+
+    Hits are the positions whose score is at least [?threshold] (default is
+    [0.7]) and is the highest within [?min_distance] frames (default is the
+    length of the template). [?block] is the minimal FFT size (default is
+    [65536]), and blocks are processed over at most [?domains] domains. *)
+
+val find_spectral :
+     ?domains:int
+  -> ?nfft:int
+  -> ?hop:int
+  -> ?bands:int
+  -> ?threshold:float
+  -> ?min_distance:int
+  -> template:Audio.audio
+  -> Audio.audio
+  -> hit list
+(**
+    [find_spectral ?domains ?nfft ?hop ?bands ?threshold ?min_distance
+    ~template audio] works like {!find} but matches spectrogram frames
+    instead of samples, which is robust to equalization and to phase changes.
+
+    Frames of [?nfft] samples (default is [1024]) taken every [?hop] samples
+    (default is [256]) are reduced to [?bands] log-spaced bands (default is
+    [32]). Matching is done on the frame to frame differences of the log band
+    energies, from which any fixed equalization cancels out. [?threshold]
+    defaults to [0.5] and [?min_distance] is expressed in frames of the
+    recording, as are the positions of the hits. *)
@@ -0,0 +1,288 @@
+(*****************************************************************************)
+(*                                                                           *)
+(*                                                                           *)
+(*  Copyright (C) 2023                                                       *)
+(*    Gabriel Santamaria                                                     *)
+(*                                                                           *)
+(*                                                                           *)
+(*  Licensed under the Apache License, Version 2.0 (the "License");          *)
+(*  you may not use this file except in compliance with the License.         *)
+(*  You may obtain a copy of the License at                                  *)
+(*                                                                           *)
+(*    http://www.apache.org/licenses/LICENSE-2.0                             *)
+(*                                                                           *)
+(*  Unless required by applicable law or agreed to in writing, software      *)
+(*  distributed under the License is distributed on an "AS IS" BASIS,        *)
+(*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *)
+(*  See the License for the specific language governing permissions and      *)
+(*  limitations under the License.                                           *)
+(*                                                                           *)
+(*****************************************************************************)
+
+(* FFT buffers, grown when a larger size is needed. [evaluate] gives one to
+   each chunk of pairs, which reuses it from one pair to the next; it is
+   released with the chunk. *)
+type workspace =
+  { mutable ar: float array
+  ; mutable ai: float array
+  ; mutable br: float array
+  ; mutable bi: float array }
+
+let workspace () : workspace = {ar= [||]; ai= [||]; br= [||]; bi= [||]}
+
+let reserve (w : workspace) (size : int) : unit =
+  if Array.length w.ar < size then (
+    w.ar <- Array.make size 0. ;
+    w.ai <- Array.make size 0. ;
+    w.br <- Array.make size 0. ;
+    w.bi <- Array.make size 0. )
+
+(* zero-mean mixdowns of both signals, truncated to the same length *)
+let signals (reference : Audio.audio) (estimate : Audio.audio) :
+    float array * float array =
+  let rate x = Audio.Metadata.sample_rate (Audio.meta x) in
+  if rate reference <> rate estimate then
+    raise
+      (Invalid_argument
+         "Analysis.Metrics: signals have different sample rates" ) ;
+  let r = Audio.View.of_data (Audio.mixdown reference)
+  and e = Audio.View.of_data (Audio.mixdown estimate) in
+  let n = min (Audio.View.length r) (Audio.View.length e) in
+  let centered v =
+    let x = Array.init n (Audio.View.get v) in
+    let mean = Array.fold_left ( +. ) 0. x /. float_of_int (max 1 n) in
+    Array.map (fun v -> v -. mean) x
+  in
+  (centered r, centered e)
+
+let dot (a : float array) (b : float array) : float =
+  let s = ref 0. in
+  for i = 0 to Array.length a - 1 do
+    s := !s +. (a.(i) *. b.(i))
+  done ;
+  !s
+
+let ratio (signal : float) (noise : float) : float =
+  10. *. Float.log10 (Float.max signal 1e-20 /. Float.max noise 1e-20)
+
+let si_sdr_of (s : float array) (e : float array) : float =
+  let ss = dot s s and se = dot s e and ee = dot e e in
+  if ss = 0. then Float.nan
+  else
+    (* the target is [alpha s], [alpha = se / ss] *)
+    let target = se *. se /. ss in
+    ratio target (ee -. target)
+
+let si_sdr ~(reference : Audio.audio) (estimate : Audio.audio) : float =
+  let s, e = signals reference estimate in
+  si_sdr_of s e
+
+(* solves [T x = b] for the symmetric Toeplitz matrix [T] whose first row is
+   [r], with the Levinson recursion (Golub and Van Loan, algorithm 4.7.3) *)
+let levinson (r : float array) (b : float array) : float array =
+  let n = Array.length b in
+  let r0 = r.(0) in
+  let t i = r.(i) /. r0 in
+  let b = Array.map (fun v -> v /. r0) b in
+  let x = Array.make n 0. and y = Array.make n 0. and tmp = Array.make n 0. in
+  x.(0) <- b.(0) ;
+  if n > 1 then (
+    y.(0) <- -.t 1 ;
+    let alpha = ref (-.t 1) and beta = ref 1. in
+    for k = 1 to n - 1 do
+      beta := (1. -. (!alpha *. !alpha)) *. !beta ;
+      let acc = ref b.(k) in
+      for i = 1 to k do
+        acc := !acc -. (t i *. x.(k - i))
+      done ;
+      let mu = !acc /. !beta in
+      for i = 0 to k - 1 do
+        tmp.(i) <- x.(i) +. (mu *. y.(k - 1 - i))
+      done ;
+      Array.blit tmp 0 x 0 k ;
+      x.(k) <- mu ;
+      if k < n - 1 then (
+        let acc = ref (-.t (k + 1)) in
+        for i = 1 to k do
+          acc := !acc -. (t i *. y.(k - i))
+        done ;
+        alpha := !acc /. !beta ;
+        for i = 0 to k - 1 do
+          tmp.(i) <- y.(i) +. (!alpha *. y.(k - 1 - i))
+        done ;
+        Array.blit tmp 0 y 0 k ;
+        y.(k) <- !alpha )
+    done ) ;
+  x
+
+let sdr_of (w : workspace) ~(filter : int) (s : float array)
+    (e : float array) : float =
+  let n = Array.length s in
+  let size = Dsp.Fft.next_pow2 (max 2 (n + filter)) in
+  let plan = Dsp.Fft.plan size in
+  reserve w size ;
+  Array.fill w.ar 0 size 0. ;
+  Array.fill w.ai 0 size 0. ;
+  Array.fill w.br 0 size 0. ;
+  Array.fill w.bi 0 size 0. ;
+  Array.blit s 0 w.ar 0 n ;
+  Array.blit e 0 w.br 0 n ;
+  Dsp.Fft.forward plan w.ar w.ai ;
+  Dsp.Fft.forward plan w.br w.bi ;
+  (* conj(S) S and conj(S) E, whose inverses are the autocorrelation of the
+     reference and its cross-correlation with the estimate *)
+  for k = 0 to size - 1 do
+    let sr = w.ar.(k) and si = w.ai.(k) in
+    let er = w.br.(k) and ei = w.bi.(k) in
+    w.ar.(k) <- (sr *. sr) +. (si *. si) ;
+    w.ai.(k) <- 0. ;
+    w.br.(k) <- (sr *. er) +. (si *. ei) ;
+    w.bi.(k) <- (sr *. ei) -. (si *. er)
+  done ;
+  Dsp.Fft.inverse plan w.ar w.ai ;
+  Dsp.Fft.inverse plan w.br w.bi ;
+  let filter = min filter n in
+  let r = Array.sub w.ar 0 filter and c = Array.sub w.br 0 filter in
+  if r.(0) = 0. then Float.nan
+  else (
+    (* light diagonal loading keeps the system well conditioned *)
+    r.(0) <- r.(0) *. (1. +. 1e-10) ;
+    let a = levinson r c in
+    (* energy of the projection of the estimate *)
+    let target = dot a c in
+    ratio target (dot e e -. target) )
+
+let sdr ?(filter : int = 512) ~(reference : Audio.audio)
+    (estimate : Audio.audio) : float =
+  if filter <= 0 then
+    raise (Invalid_argument "Analysis.Metrics.sdr: filter must be positive") ;
+  let s, e = signals reference estimate in
+  sdr_of (workspace ()) ~filter s e
+
+(* parameters of STOI, defined at 10 kHz *)
+let stoi_bands = 15
+
+let stoi_segment = 30
+
+let stoi_range = 40.
+
+let stoi_clip = 1. +. Float.pow 10. (15. /. 20.)
+
+let stoi_of (w : workspace) ~(sample_rate : int) (s : float array)
+    (e : float array) : float =
+  let fs = float_of_int sample_rate in
+  let frame = max 16 (int_of_float (Float.round (0.0256 *. fs))) in
+  let hop = frame / 2 in
+  let nfft = Dsp.Fft.next_pow2 (2 * frame) in
+  let window =
+    Array.init frame (fun i ->
+        let t = float_of_int (i + 1) /. float_of_int (frame + 1) in
+        0.5 -. (0.5 *. Float.cos (2. *. Float.pi *. t)) )
+  in
+  let stft = Dsp.Stft.create ~window nfft in
+  let frames = Dsp.Stft.frames stft ~hop (Array.length s) in
+  (* frames of the reference within [stoi_range] dB of the loudest one *)
+  let energy x f =
+    let acc = ref 0. in
+    for i = 0 to frame - 1 do
+      let v = window.(i) *. x.((f * hop) + i) in
+      acc := !acc +. (v *. v)
+    done ;
+    10. *. Float.log10 (!acc +. 1e-20)
+  in
+  let energies = Array.init frames (energy s) in
+  let top = Array.fold_left Float.max Float.neg_infinity energies in
+  let kept =
+    List.filter
+      (fun f -> energies.(f) > top -. stoi_range)
+      (List.init frames Fun.id)
+    |> Array.of_list
+  in
+  let m = Array.length kept in
+  (* third octave bands from 150 Hz, as bin ranges *)
+  let bin f = int_of_float (Float.round (f *. float_of_int nfft /. fs)) in
+  let edges =
+    Array.init stoi_bands (fun j ->
+        let cf = 150. *. Float.pow 2. (float_of_int j /. 3.) in
+        let hi = min (nfft / 2) (bin (cf *. Float.pow 2. (1. /. 6.))) in
+        (min hi (bin (cf *. Float.pow 2. (-1. /. 6.))), hi) )
+  in
+  reserve w nfft ;
+  (* band magnitudes of the kept frames, [stoi_bands] rows of [m] values *)
+  let bands x =
+    let out = Array.make_matrix stoi_bands m 0. in
+    (* the powers go to [w.br], which is only used by the SDR *)
+    Array.iteri
+      (fun k f ->
+        Dsp.Stft.power stft ~re:w.ar ~im:w.ai
+          (fun i -> x.((f * hop) + i))
+          w.br ;
+        Array.iteri
+          (fun j (lo, hi) ->
+            let acc = ref 0. in
+            for b = lo to hi - 1 do
+              acc := !acc +. w.br.(b)
+            done ;
+            out.(j).(k) <- Float.sqrt !acc )
+          edges )
+      kept ;
+    out
+  in
+  let xs = bands s and ys = bands e in
+  if m < stoi_segment then Float.nan
+  else
+    let x = Array.make stoi_segment 0. and y = Array.make stoi_segment 0. in
+    let total = ref 0. and count = ref 0 in
+    for j = 0 to stoi_bands - 1 do
+      for last = stoi_segment - 1 to m - 1 do
+        let first = last - stoi_segment + 1 in
+        Array.blit xs.(j) first x 0 stoi_segment ;
+        Array.blit ys.(j) first y 0 stoi_segment ;
+        (* normalization and clipping of the estimate *)
+        let alpha = Float.sqrt (dot x x /. Float.max (dot y y) 1e-20) in
+        for i = 0 to stoi_segment - 1 do
+          y.(i) <- Float.min (alpha *. y.(i)) (stoi_clip *. x.(i))
+        done ;
+        let mean a = Array.fold_left ( +. ) 0. a /. float_of_int stoi_segment in
+        let mx = mean x and my = mean y in
+        let sxy = ref 0. and sxx = ref 0. and syy = ref 0. in
+        for i = 0 to stoi_segment - 1 do
+          let dx = x.(i) -. mx and dy = y.(i) -. my in
+          sxy := !sxy +. (dx *. dy) ;
+          sxx := !sxx +. (dx *. dx) ;
+          syy := !syy +. (dy *. dy)
+        done ;
+        let norm = Float.sqrt (Float.max (!sxx *. !syy) 1e-20) in
+        total := !total +. (!sxy /. norm) ;
+        incr count
+      done
+    done ;
+    !total /. float_of_int !count
+
+let stoi ~(reference : Audio.audio) (estimate : Audio.audio) : float =
+  let s, e = signals reference estimate in
+  let sample_rate = Audio.Metadata.sample_rate (Audio.meta reference) in
+  stoi_of (workspace ()) ~sample_rate s e
+
+type scores = {si_sdr: float; sdr: float; stoi: float}
+
+let evaluate ?(domains : int = Parallel.default_domains ())
+    ?(filter : int = 512) (pairs : (Audio.audio * Audio.audio) array) :
+    scores array =
+  let n = Array.length pairs in
+  let out = Array.make n {si_sdr= Float.nan; sdr= Float.nan; stoi= Float.nan} in
+  (* a few chunks per domain balance the load while keeping the number of
+     workspaces small *)
+  let chunk = max 1 (n / (4 * max 1 domains)) in
+  Parallel.chunks ~domains ~chunk n (fun start stop ->
+      let w = workspace () in
+      for i = start to stop - 1 do
+        let reference, estimate = pairs.(i) in
+        let s, e = signals reference estimate in
+        let sample_rate = Audio.Metadata.sample_rate (Audio.meta reference) in
+        out.(i) <-
+          { si_sdr= si_sdr_of s e
+          ; sdr= sdr_of w ~filter s e
+          ; stoi= stoi_of w ~sample_rate s e }
+      done ) ;
+  out
@@ -0,0 +1,63 @@
+(*****************************************************************************)
+(*                                                                           *)
+(*                                                                           *)
+(*  Copyright (C) 2023                                                       *)
+(*    Gabriel Santamaria                                                     *)
+(*                                                                           *)
+(*                                                                           *)
+(*  Licensed under the Apache License, Version 2.0 (the "License");          *)
+(*  you may not use this file except in compliance with the License.         *)
+(*  You may obtain a copy of the License at                                  *)
+(*                                                                           *)
+(*    http://www.apache.org/licenses/LICENSE-2.0                             *)
+(*                                                                           *)
+(*  Unless required by applicable law or agreed to in writing, software      *)
+(*  distributed under the License is distributed on an "AS IS" BASIS,        *)
+(*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *)
+(*  See the License for the specific language governing permissions and      *)
+(*  limitations under the License.                                           *)
+(*                                                                           *)
+(*****************************************************************************)
+
+(**
+    The {!Analysis.Metrics} module implements the usual objective measures of
+    source separation and speech enhancement systems. Every measure compares
+    an estimate to its clean reference; channels are mixed down and the
+    signals are truncated to the shortest of both.
+
+    Batches of pairs are evaluated in parallel by chunks of consecutive
+    pairs, each chunk reusing its FFT buffers from one pair to the next. *)
+
+val si_sdr : reference:Audio.audio -> Audio.audio -> float
+(**
+    [si_sdr ~reference estimate] returns the scale-invariant signal to
+    distortion ratio, in dB, of [estimate]. *)
+
+val sdr : ?filter:int -> reference:Audio.audio -> Audio.audio -> float
+(**
+    [sdr ?filter ~reference estimate] returns the signal to distortion ratio,
+    in dB, of [estimate] as defined by BSS Eval: the target is the projection
+    of [estimate] on the reference filtered by any filter of [?filter] taps
+    (default is [512]). The correlations are computed with FFTs and the
+    projection is solved with the Levinson recursion, so the filtered
+    reference is never materialized. *)
+
+val stoi : reference:Audio.audio -> Audio.audio -> float
+(**
+    [stoi ~reference estimate] returns the short-time objective
+    intelligibility (Taal et al., 2011) of [estimate], between [0] and [1].
+
+    The measure is defined at 10 kHz. Rather than resampling, the frames are
+    scaled to the sample rate of the signals to keep their 25.6 ms duration,
+    which gives close but not identical values at other rates. *)
+
+type scores = {si_sdr: float; sdr: float; stoi: float}
+
+val evaluate :
+     ?domains:int
+  -> ?filter:int
+  -> (Audio.audio * Audio.audio) array
+  -> scores array
+(**
+    [evaluate ?domains ?filter pairs] computes every measure for each pair
+    [(reference, estimate)], in parallel over at most [?domains] domains. *)
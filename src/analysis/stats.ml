@@ -0,0 +1,379 @@
+(*****************************************************************************)
+(*                                                                           *)
+(*                                                                           *)
+(*  Copyright (C) 2023                                                       *)
+(*    Gabriel Santamaria                                                     *)
+(*                                                                           *)
+(*                                                                           *)
+(*  Licensed under the Apache License, Version 2.0 (the "License");          *)
+(*  you may not use this file except in compliance with the License.         *)
+(*  You may obtain a copy of the License at                                  *)
+(*                                                                           *)
+(*    http://www.apache.org/licenses/LICENSE-2.0                             *)
+(*                                                                           *)
+(*  Unless required by applicable law or agreed to in writing, software      *)
+(*  distributed under the License is distributed on an "AS IS" BASIS,        *)
+(*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *)
+(*  See the License for the specific language governing permissions and      *)
+(*  limitations under the License.                                           *)
+(*                                                                           *)
+(*****************************************************************************)
+
+let view_iter (f : float -> unit) (v : Audio.View.t) : unit =
+  let buf = Audio.View.buffer v in
+  let off = Audio.View.offset v and stride = Audio.View.stride v in
+  for i = 0 to Audio.View.length v - 1 do
+    f (Bigarray.Array1.unsafe_get buf (off + (i * stride)))
+  done
+
+module Moments = struct
+  type t =
+    { mutable n: float
+    ; mutable lo: float
+    ; mutable hi: float
+    ; mutable mean: float
+    ; mutable m2: float
+    ; mutable m3: float
+    ; mutable m4: float }
+
+  let create () =
+    { n= 0.
+    ; lo= Float.infinity
+    ; hi= Float.neg_infinity
+    ; mean= 0.
+    ; m2= 0.
+    ; m3= 0.
+    ; m4= 0. }
+
+  (* see Pébay, Formulas for Robust, One-Pass Parallel Computation of
+     Covariances and Arbitrary-Order Statistical Moments, 2008 *)
+  let add (m : t) (x : float) : unit =
+    let n = m.n +. 1. in
+    let delta = x -. m.mean in
+    let dn = delta /. n in
+    let dn2 = dn *. dn in
+    let term = delta *. dn *. m.n in
+    m.mean <- m.mean +. dn ;
+    m.m4 <-
+      m.m4
+      +. (term *. dn2 *. ((n *. n) -. (3. *. n) +. 3.))
+      +. (6. *. dn2 *. m.m2)
+      -. (4. *. dn *. m.m3) ;
+    m.m3 <- m.m3 +. (term *. dn *. (n -. 2.)) -. (3. *. dn *. m.m2) ;
+    m.m2 <- m.m2 +. term ;
+    m.n <- n ;
+    if x < m.lo then m.lo <- x ;
+    if x > m.hi then m.hi <- x
+
+  let add_view (m : t) (v : Audio.View.t) : unit = view_iter (add m) v
+
+  let merge (a : t) (b : t) : t =
+    if a.n = 0. then {b with n= b.n}
+    else if b.n = 0. then {a with n= a.n}
+    else
+      let n = a.n +. b.n in
+      let delta = b.mean -. a.mean in
+      let d2 = delta *. delta in
+      { n
+      ; lo= Float.min a.lo b.lo
+      ; hi= Float.max a.hi b.hi
+      ; mean= a.mean +. (delta *. b.n /. n)
+      ; m2= a.m2 +. b.m2 +. (d2 *. a.n *. b.n /. n)
+      ; m3=
+          a.m3 +. b.m3
+          +. (d2 *. delta *. a.n *. b.n *. (a.n -. b.n) /. (n *. n))
+          +. (3. *. delta *. ((a.n *. b.m2) -. (b.n *. a.m2)) /. n)
+      ; m4=
+          a.m4 +. b.m4
+          +. ( d2 *. d2 *. a.n *. b.n
+               *. ((a.n *. a.n) -. (a.n *. b.n) +. (b.n *. b.n))
+               /. (n *. n *. n) )
+          +. ( 6. *. d2
+               *. ((a.n *. a.n *. b.m2) +. (b.n *. b.n *. a.m2))
+               /. (n *. n) )
+          +. (4. *. delta *. ((a.n *. b.m3) -. (b.n *. a.m3)) /. n) }
+
+  let count (m : t) = int_of_float m.n
+
+  let min (m : t) = m.lo
+
+  let max (m : t) = m.hi
+
+  let mean (m : t) = if m.n = 0. then Float.nan else m.mean
+
+  let variance (m : t) = if m.n = 0. then Float.nan else m.m2 /. m.n
+
+  let skewness (m : t) =
+    if m.m2 = 0. then Float.nan
+    else Float.sqrt m.n *. m.m3 /. Float.pow m.m2 1.5
+
+  let kurtosis (m : t) =
+    if m.m2 = 0. then Float.nan else (m.n *. m.m4 /. (m.m2 *. m.m2)) -. 3.
+end
+
+module Histogram = struct
+  type t =
+    { lo: float
+    ; hi: float
+    ; counts: int array
+    ; mutable underflow: int
+    ; mutable overflow: int }
+
+  let create ~(lo : float) ~(hi : float) ~(bins : int) : t =
+    if bins <= 0 || not (lo < hi) then
+      raise (Invalid_argument "Analysis.Stats.Histogram.create: invalid bins") ;
+    {lo; hi; counts= Array.make bins 0; underflow= 0; overflow= 0}
+
+  let add (h : t) (x : float) : unit =
+    if x < h.lo then h.underflow <- h.underflow + 1
+    else if x >= h.hi then h.overflow <- h.overflow + 1
+    else
+      let bins = Array.length h.counts in
+      let r = (x -. h.lo) /. (h.hi -. h.lo) in
+      let b = int_of_float (r *. float_of_int bins) in
+      let b = Int.min b (bins - 1) in
+      h.counts.(b) <- h.counts.(b) + 1
+
+  let add_view (h : t) (v : Audio.View.t) : unit = view_iter (add h) v
+
+  let merge (a : t) (b : t) : t =
+    if
+      a.lo <> b.lo || a.hi <> b.hi
+      || Array.length a.counts <> Array.length b.counts
+    then
+      raise
+        (Invalid_argument "Analysis.Stats.Histogram.merge: different bins") ;
+    { a with
+      counts= Array.map2 ( + ) a.counts b.counts
+    ; underflow= a.underflow + b.underflow
+    ; overflow= a.overflow + b.overflow }
+
+  let counts (h : t) = Array.copy h.counts
+
+  let underflow (h : t) = h.underflow
+
+  let overflow (h : t) = h.overflow
+
+  let edges (h : t) =
+    let bins = Array.length h.counts in
+    Array.init (bins + 1) (fun i ->
+        h.lo +. ((h.hi -. h.lo) *. float_of_int i /. float_of_int bins) )
+end
+
+module Digest = struct
+  type t =
+    { compression: float
+    ; mutable means: float array (* sorted centroids *)
+    ; mutable weights: float array
+    ; buffer: float array (* values not yet merged in the centroids *)
+    ; buffer_weights: float array
+    ; mutable buffered: int
+    ; mutable total: float
+    ; mutable lo: float
+    ; mutable hi: float }
+
+  let create ?(compression : float = 100.) () : t =
+    if compression < 10. then
+      raise
+        (Invalid_argument
+           "Analysis.Stats.Digest.create: compression must be at least 10" ) ;
+    let size = 5 * int_of_float compression in
+    { compression
+    ; means= [||]
+    ; weights= [||]
+    ; buffer= Array.make size 0.
+    ; buffer_weights= Array.make size 0.
+    ; buffered= 0
+    ; total= 0.
+    ; lo= Float.infinity
+    ; hi= Float.neg_infinity }
+
+  (* scale function k1 and its inverse, which keep centroids small near the
+     tails of the distribution *)
+  let k (d : t) (q : float) =
+    d.compression /. (2. *. Float.pi) *. Float.asin ((2. *. q) -. 1.)
+
+  let k_inv (d : t) (k : float) =
+    let a = Float.min (Float.pi /. 2.) (k *. 2. *. Float.pi /. d.compression) in
+    (Float.sin a +. 1.) /. 2.
+
+  (* merges the sorted centroids [(means, weights)] into as few centroids as
+     the scale function allows *)
+  let compress (d : t) (means : float array) (weights : float array) : unit =
+    let n = Array.length means in
+    let total = Array.fold_left ( +. ) 0. weights in
+    let out_m = Array.make n 0. and out_w = Array.make n 0. in
+    let count = ref 0 in
+    if n > 0 then (
+      let cur_m = ref means.(0) and cur_w = ref weights.(0) in
+      let before = ref 0. in
+      let limit = ref (total *. k_inv d (k d 0. +. 1.)) in
+      for i = 1 to n - 1 do
+        if !before +. !cur_w +. weights.(i) <= !limit then (
+          let w = !cur_w +. weights.(i) in
+          cur_m := !cur_m +. ((means.(i) -. !cur_m) *. weights.(i) /. w) ;
+          cur_w := w )
+        else (
+          out_m.(!count) <- !cur_m ;
+          out_w.(!count) <- !cur_w ;
+          incr count ;
+          before := !before +. !cur_w ;
+          limit := total *. k_inv d (k d (!before /. total) +. 1.) ;
+          cur_m := means.(i) ;
+          cur_w := weights.(i) )
+      done ;
+      out_m.(!count) <- !cur_m ;
+      out_w.(!count) <- !cur_w ;
+      incr count ) ;
+    d.means <- Array.sub out_m 0 !count ;
+    d.weights <- Array.sub out_w 0 !count
+
+  (* sorts the centroids and the buffered values together and compresses
+     them *)
+  let flush (d : t) : unit =
+    if d.buffered > 0 then (
+      let all =
+        Array.append
+          (Array.map2 (fun m w -> (m, w)) d.means d.weights)
+          (Array.init d.buffered (fun i ->
+               (d.buffer.(i), d.buffer_weights.(i)) ) )
+      in
+      Array.stable_sort (fun (a, _) (b, _) -> Float.compare a b) all ;
+      compress d (Array.map fst all) (Array.map snd all) ;
+      d.buffered <- 0 )
+
+  let add ?(weight : float = 1.) (d : t) (x : float) : unit =
+    if d.buffered = Array.length d.buffer then flush d ;
+    d.buffer.(d.buffered) <- x ;
+    d.buffer_weights.(d.buffered) <- weight ;
+    d.buffered <- d.buffered + 1 ;
+    d.total <- d.total +. weight ;
+    if x < d.lo then d.lo <- x ;
+    if x > d.hi then d.hi <- x
+
+  let add_view (d : t) (v : Audio.View.t) : unit = view_iter (add d) v
+
+  let merge (a : t) (b : t) : t =
+    flush a ;
+    flush b ;
+    let d = create ~compression:(Float.max a.compression b.compression) () in
+    let all =
+      Array.append
+        (Array.map2 (fun m w -> (m, w)) a.means a.weights)
+        (Array.map2 (fun m w -> (m, w)) b.means b.weights)
+    in
+    Array.stable_sort (fun (x, _) (y, _) -> Float.compare x y) all ;
+    compress d (Array.map fst all) (Array.map snd all) ;
+    d.total <- a.total +. b.total ;
+    d.lo <- Float.min a.lo b.lo ;
+    d.hi <- Float.max a.hi b.hi ;
+    d
+
+  let count (d : t) = d.total
+
+  let quantile (d : t) (q : float) : float =
+    flush d ;
+    let n = Array.length d.means in
+    if n = 0 then Float.nan
+    else if n = 1 then d.means.(0)
+    else
+      let target = Float.max 0. (Float.min 1. q) *. d.total in
+      (* centroids are seen as points located at the middle of their weight,
+         and the quantile is interpolated between them *)
+      let rec find i before =
+        let center = before +. (d.weights.(i) /. 2.) in
+        if target < center then
+          if i = 0 then
+            d.lo +. ((d.means.(0) -. d.lo) *. target /. center)
+          else
+            let prev = before -. (d.weights.(i - 1) /. 2.) in
+            d.means.(i - 1)
+            +. (d.means.(i) -. d.means.(i - 1))
+               *. (target -. prev)
+               /. (center -. prev)
+        else if i = n - 1 then
+          let rest = d.total -. center in
+          if rest <= 0. then d.hi
+          else
+            d.means.(i) +. ((d.hi -. d.means.(i)) *. (target -. center) /. rest)
+        else find (i + 1) (before +. d.weights.(i))
+      in
+      find 0 0.
+
+  let cdf (d : t) (x : float) : float =
+    flush d ;
+    let n = Array.length d.means in
+    if n = 0 then Float.nan
+    else if x < d.lo then 0.
+    else if x >= d.hi then 1.
+    else
+      let rec find i before =
+        let center = before +. (d.weights.(i) /. 2.) in
+        if x < d.means.(i) then
+          if i = 0 then
+            center *. (x -. d.lo)
+            /. Float.max Float.epsilon (d.means.(0) -. d.lo)
+          else
+            let prev = before -. (d.weights.(i - 1) /. 2.) in
+            prev
+            +. (center -. prev)
+               *. (x -. d.means.(i - 1))
+               /. (d.means.(i) -. d.means.(i - 1))
+        else if i = n - 1 then
+          center
+          +. (d.total -. center)
+             *. (x -. d.means.(i))
+             /. Float.max Float.epsilon (d.hi -. d.means.(i))
+        else find (i + 1) (before +. d.weights.(i))
+      in
+      find 0 0. /. d.total
+end
+
+module Noise_floor = struct
+  type t = Digest.t array
+
+  let create ?(compression : float = 100.) (bins : int) : t =
+    Array.init bins (fun _ -> Digest.create ~compression ())
+
+  let to_db (p : float) = 10. *. Float.log10 (Float.max p 1e-20)
+
+  let add_spectrum (nf : t) (power : float array) : unit =
+    if Array.length power <> Array.length nf then
+      raise
+        (Invalid_argument
+           "Analysis.Stats.Noise_floor.add_spectrum: wrong number of bins" ) ;
+    Array.iteri (fun k d -> Digest.add d (to_db power.(k))) nf
+
+  let add_specgram (nf : t)
+      (psd : (Complex.t, Bigarray.complex32_elt) Audio.G.t) : unit =
+    match Audio.G.shape psd with
+    | [|bins; frames|] when bins = Array.length nf ->
+        let psd = Bigarray.reshape_2 psd bins frames in
+        for n = 0 to frames - 1 do
+          for k = 0 to bins - 1 do
+            Digest.add nf.(k) (to_db (Bigarray.Array2.get psd k n).Complex.re)
+          done
+        done
+    | _ ->
+        raise
+          (Invalid_argument
+             "Analysis.Stats.Noise_floor.add_specgram: wrong number of bins" )
+
+  let merge (a : t) (b : t) : t =
+    if Array.length a <> Array.length b then
+      raise
+        (Invalid_argument "Analysis.Stats.Noise_floor.merge: different bins") ;
+    Array.map2 Digest.merge a b
+
+  let floor ?(q : float = 0.1) (nf : t) : float array =
+    Array.map (fun d -> Digest.quantile d q) nf
+end
+
+let reduce ?(domains : int = Parallel.default_domains ()) (f : 'a -> 'b)
+    (merge : 'b -> 'b -> 'b) (items : 'a array) : 'b option =
+  let summaries = Parallel.map ~domains f items in
+  if Array.length summaries = 0 then None
+  else
+    Some
+      (Array.fold_left merge summaries.(0)
+         (Array.sub summaries 1 (Array.length summaries - 1)) )
@@ -0,0 +1,177 @@
+(*****************************************************************************)
+(*                                                                           *)
+(*                                                                           *)
+(*  Copyright (C) 2023                                                       *)
+(*    Gabriel Santamaria                                                     *)
+(*                                                                           *)
+(*                                                                           *)
+(*  Licensed under the Apache License, Version 2.0 (the "License");          *)
+(*  you may not use this file except in compliance with the License.         *)
+(*  You may obtain a copy of the License at                                  *)
+(*                                                                           *)
+(*    http://www.apache.org/licenses/LICENSE-2.0                             *)
+(*                                                                           *)
+(*  Unless required by applicable law or agreed to in writing, software      *)
+(*  distributed under the License is distributed on an "AS IS" BASIS,        *)
+(*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *)
+(*  See the License for the specific language governing permissions and      *)
+(*  limitations under the License.                                           *)
+(*                                                                           *)
+(*****************************************************************************)
+
+(**
+    The {!Analysis.Stats} module provides streaming summaries of large amounts
+    of values, such as the samples or the framewise features of a whole
+    catalog.
+
+    Every summary can be updated one value at a time and merged with another
+    summary of the same kind. Merging is associative, so summaries can be
+    computed per file or per chunk on separate domains and combined in any
+    order with {!reduce}. *)
+
+(**
+    Count, extrema and the first four central moments *)
+module Moments : sig
+  type t
+
+  val create : unit -> t
+
+  val add : t -> float -> unit
+  (**
+      [add m x] accounts for the value [x] *)
+
+  val add_view : t -> Audio.View.t -> unit
+  (**
+      [add_view m v] accounts for every element of the view [v] *)
+
+  val merge : t -> t -> t
+  (**
+      [merge a b] returns the moments of the union of the values summarized by
+      [a] and [b], which are left untouched. *)
+
+  val count : t -> int
+
+  val min : t -> float
+
+  val max : t -> float
+
+  val mean : t -> float
+
+  val variance : t -> float
+  (**
+      [variance m] returns the population variance *)
+
+  val skewness : t -> float
+
+  val kurtosis : t -> float
+  (**
+      [kurtosis m] returns the excess kurtosis *)
+end
+
+(**
+    Histograms with fixed, evenly spaced bins *)
+module Histogram : sig
+  type t
+
+  val create : lo:float -> hi:float -> bins:int -> t
+  (**
+      [create ~lo ~hi ~bins] creates an empty histogram of [~bins] bins
+      covering [\[lo; hi\[]. Values outside of this range are counted apart. *)
+
+  val add : t -> float -> unit
+
+  val add_view : t -> Audio.View.t -> unit
+
+  val merge : t -> t -> t
+  (**
+      [merge a b] returns the sum of two histograms having the same bins *)
+
+  val counts : t -> int array
+  (**
+      [counts h] returns the number of values of each bin *)
+
+  val underflow : t -> int
+
+  val overflow : t -> int
+
+  val edges : t -> float array
+  (**
+      [edges h] returns the [bins + 1] edges of the bins *)
+end
+
+(**
+    Quantile sketches based on the merging t-digest of Ted Dunning. The
+    accuracy is best on extreme quantiles, and the size of a digest is
+    bounded by its compression parameter whatever the number of values. *)
+module Digest : sig
+  type t
+
+  val create : ?compression:float -> unit -> t
+  (**
+      [create ?compression ()] creates an empty digest. Higher [?compression]
+      (default is [100.]) means more centroids and more accurate quantiles. *)
+
+  val add : ?weight:float -> t -> float -> unit
+
+  val add_view : t -> Audio.View.t -> unit
+
+  val merge : t -> t -> t
+
+  val count : t -> float
+  (**
+      [count d] returns the total weight of the values added to [d] *)
+
+  val quantile : t -> float -> float
+  (**
+      [quantile d q] estimates the [q]-quantile, [q] being in [\[0; 1\]].
+      Returns [nan] on an empty digest. *)
+
+  val cdf : t -> float -> float
+  (**
+      [cdf d x] estimates the fraction of the values lower or equal to [x] *)
+end
+
+(**
+    Per-frequency-bin noise floor estimation from streaming spectra *)
+module Noise_floor : sig
+  type t
+
+  val create : ?compression:float -> int -> t
+  (**
+      [create ?compression bins] creates an estimator for spectra of [bins]
+      bins, keeping one {!Digest} per bin. *)
+
+  val add_spectrum : t -> float array -> unit
+  (**
+      [add_spectrum nf power] accounts for one power spectrum *)
+
+  val add_specgram :
+    t -> (Complex.t, Bigarray.complex32_elt) Audio.G.t -> unit
+  (**
+      [add_specgram nf psd] accounts for every frame of a PSD spectrogram as
+      returned by {!Feature.Spectral.specgram} *)
+
+  val merge : t -> t -> t
+
+  val floor : ?q:float -> t -> float array
+  (**
+      [floor ?q nf] returns the noise floor of each bin, in dB, estimated as
+      the [?q]-quantile (default is [0.1]) of its levels. *)
+end
+
+val reduce :
+  ?domains:int -> ('a -> 'b) -> ('b -> 'b -> 'b) -> 'a array -> 'b option
+(**
+    [reduce ?domains f merge items] computes the summaries [f item] in
+    parallel over at most [?domains] domains and merges them. Returns [None]
+    when there are no items.
+
+    Example:
+
+    {[
+        let levels =
+            reduce (fun a ->
+                let d = Digest.create () in
+                Digest.add_view d (Audio.View.of_audio a) ; d)
+              Digest.merge audios
+    ]} *)
@@ -0,0 +1,131 @@
+(*****************************************************************************)
+(*                                                                           *)
+(*                                                                           *)
+(*  Copyright (C) 2023                                                       *)
+(*    Gabriel Santamaria                                                     *)
+(*                                                                           *)
+(*                                                                           *)
+(*  Licensed under the Apache License, Version 2.0 (the "License");          *)
+(*  you may not use this file except in compliance with the License.         *)
+(*  You may obtain a copy of the License at                                  *)
+(*                                                                           *)
+(*    http://www.apache.org/licenses/LICENSE-2.0                             *)
+(*                                                                           *)
+(*  Unless required by applicable law or agreed to in writing, software      *)
+(*  distributed under the License is distributed on an "AS IS" BASIS,        *)
+(*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *)
+(*  See the License for the specific language governing permissions and      *)
+(*  limitations under the License.                                           *)
+(*                                                                           *)
+(*****************************************************************************)
+
+type features = (float, Bigarray.float32_elt) Audio.G.t
+
+let dims_frames (fname : string) (f : features) : int * int =
+  match Audio.G.shape f with
+  | [|dims; frames|] ->
+      (dims, frames)
+  | _ ->
+      raise (Invalid_argument (fname ^ ": features must be a matrix"))
+
+(* copy of the frames [\[j0; j1\[] scaled to unit norm, silent frames being
+   left to zero *)
+let normalized (f : features) (j0 : int) (j1 : int) : features =
+  let cols = Audio.G.get_slice [[]; [j0; j1 - 1]] f in
+  let norms = Audio.G.(sqrt (sum ~axis:0 (sqr cols))) in
+  let inv = Audio.G.map (fun n -> if n > 1e-12 then 1. /. n else 0.) norms in
+  Audio.G.(cols * inv)
+
+let block (f : features) ((i0, i1) : int * int) ((j0, j1) : int * int) :
+    features =
+  let _, frames = dims_frames "Analysis.Structure.block" f in
+  if i0 < 0 || i1 > frames || i0 >= i1 || j0 < 0 || j1 > frames || j0 >= j1
+  then raise (Invalid_argument "Analysis.Structure.block: invalid ranges") ;
+  Audio.G.dot (Audio.G.transpose (normalized f i0 i1)) (normalized f j0 j1)
+
+type band =
+  { frames: int
+  ; width: int
+  ; data: float array (* [frames * (2 * width + 1)], one row per frame *) }
+
+let band ?(domains : int = Parallel.default_domains ()) ?(width : int = 64)
+    ?(tile : int = 256) (f : features) : band =
+  let _, frames = dims_frames "Analysis.Structure.band" f in
+  if width < 0 || tile <= 0 then
+    raise (Invalid_argument "Analysis.Structure.band: invalid width or tile") ;
+  let row = (2 * width) + 1 in
+  let data = Array.make (frames * row) 0. in
+  Parallel.chunks ~domains ~chunk:tile frames (fun i0 i1 ->
+      let j0 = max 0 (i0 - width) and j1 = min frames (i1 + width) in
+      let m = block f (i0, i1) (j0, j1) in
+      let m = Bigarray.reshape_2 m (i1 - i0) (j1 - j0) in
+      for i = i0 to i1 - 1 do
+        for j = max j0 (i - width) to min (j1 - 1) (i + width) do
+          data.((i * row) + (j - i + width)) <-
+            Bigarray.Array2.unsafe_get m (i - i0) (j - j0)
+        done
+      done ) ;
+  {frames; width; data}
+
+let frames (b : band) = b.frames
+
+let width (b : band) = b.width
+
+let get (b : band) (i : int) (j : int) : float =
+  if i < 0 || j < 0 || i >= b.frames || j >= b.frames || abs (i - j) > b.width
+  then raise (Invalid_argument "Analysis.Structure.get: outside of the band") ;
+  b.data.((i * ((2 * b.width) + 1)) + (j - i + b.width))
+
+let novelty ?(domains : int = Parallel.default_domains ()) ?kernel (b : band)
+    : float array =
+  let half = min (b.width / 2) (Option.value ~default:(b.width / 2) kernel) in
+  if half <= 0 then
+    raise (Invalid_argument "Analysis.Structure.novelty: band is too narrow") ;
+  (* gaussian tapered checkerboard, [k.(a + half).(c + half)] for offsets in
+     [\[-half; half\[] *)
+  let sigma = 0.5 *. float_of_int half in
+  let taper x =
+    let x = (float_of_int x +. 0.5) /. sigma in
+    Float.exp (-0.5 *. x *. x)
+  in
+  let k =
+    Array.init (2 * half) (fun a ->
+        Array.init (2 * half) (fun c ->
+            let a = a - half and c = c - half in
+            let sign = if (a < 0) = (c < 0) then 1. else -1. in
+            sign *. taper a *. taper c ) )
+  in
+  let row = (2 * b.width) + 1 in
+  let nov = Array.make b.frames 0. in
+  Parallel.chunks ~domains ~chunk:1024 b.frames (fun start stop ->
+      for i = start to stop - 1 do
+        let s = ref 0. in
+        for a = max (-half) (-i) to min (half - 1) (b.frames - 1 - i) do
+          for c = max (-half) (-i) to min (half - 1) (b.frames - 1 - i) do
+            (* |a - c| < 2 * half <= width, so the pair is inside the band *)
+            s :=
+              !s
+              +. k.(a + half).(c + half)
+                 *. b.data.(((i + a) * row) + (c - a + b.width))
+          done
+        done ;
+        nov.(i) <- Float.max 0. !s
+      done ) ;
+  nov
+
+let boundaries ?(threshold : float = 0.3) ?(distance : int = 16)
+    (nov : float array) : int list =
+  let n = Array.length nov in
+  let top = Array.fold_left Float.max 0. nov in
+  let limit = threshold *. top in
+  let is_peak i =
+    nov.(i) > 0.
+    && nov.(i) >= limit
+    &&
+    let ok = ref true in
+    for j = max 0 (i - distance) to min (n - 1) (i + distance) do
+      if nov.(j) > nov.(i) || (nov.(j) = nov.(i) && j < i) then ok := false
+    done ;
+    !ok
+  in
+  List.filter is_peak (List.init n Fun.id)
@@ -0,0 +1,75 @@
+(*****************************************************************************)
+(*                                                                           *)
+(*                                                                           *)
+(*  Copyright (C) 2023                                                       *)
+(*    Gabriel Santamaria                                                     *)
+(*                                                                           *)
+(*                                                                           *)
+(*  Licensed under the Apache License, Version 2.0 (the "License");          *)
+(*  you may not use this file except in compliance with the License.         *)
+(*  You may obtain a copy of the License at                                  *)
+(*                                                                           *)
+(*    http://www.apache.org/licenses/LICENSE-2.0                             *)
+(*                                                                           *)
+(*  Unless required by applicable law or agreed to in writing, software      *)
+(*  distributed under the License is distributed on an "AS IS" BASIS,        *)
+(*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *)
+(*  See the License for the specific language governing permissions and      *)
+(*  limitations under the License.                                           *)
+(*                                                                           *)
+(*****************************************************************************)
+
+(**
+    The {!Analysis.Structure} module computes self-similarity matrices of
+    feature sequences, such as chromagrams or MFCCs, and segments them using
+    novelty curves.
+
+    A dense self-similarity matrix of a long track does not fit in memory:
+    an hour of frames at 10 ms is more than a hundred gigabytes of floats.
+    Most structural analyses only need similarities between frames that are
+    close in time, so the matrix is computed as a diagonal band, tile by tile,
+    each tile being a matrix product of unit-norm feature frames. Tiles are
+    computed in parallel. *)
+
+type features = (float, Bigarray.float32_elt) Audio.G.t
+(**
+    Feature sequences are matrices of shape [\[|dims; frames|\]], one frame
+    per column. *)
+
+val block : features -> int * int -> int * int -> features
+(**
+    [block f (i0, i1) (j0, j1)] returns the dense cosine similarities between
+    the frames [\[i0; i1\[] and the frames [\[j0; j1\[] of [f], as a matrix of
+    shape [\[|i1 - i0; j1 - j0|\]]. *)
+
+type band
+
+val band : ?domains:int -> ?width:int -> ?tile:int -> features -> band
+(**
+    [band ?domains ?width ?tile f] computes the cosine similarities between
+    every frame of [f] and the frames located at most [?width] frames away
+    (default is [64]). Tiles of [?tile] frames (default is [256]) are computed
+    over at most [?domains] domains. *)
+
+val frames : band -> int
+
+val width : band -> int
+
+val get : band -> int -> int -> float
+(**
+    [get b i j] returns the similarity between the frames [i] and [j], which
+    must be at most [width b] frames apart. *)
+
+val novelty : ?domains:int -> ?kernel:int -> band -> float array
+(**
+    [novelty ?domains ?kernel b] computes Foote's novelty curve by sliding
+    along the diagonal a Gaussian-tapered checkerboard kernel spanning
+    [?kernel] frames on each side (default is [width b / 2], and at most that
+    value). Frames near the edges see a truncated kernel. *)
+
+val boundaries : ?threshold:float -> ?distance:int -> float array -> int list
+(**
+    [boundaries ?threshold ?distance nov] returns the frames where the novelty
+    curve has a peak higher than [?threshold] times its maximum (default is
+    [0.3]) and higher than every other value within [?distance] frames
+    (default is [16]). *)
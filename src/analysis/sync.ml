@@ -0,0 +1,165 @@
+(*****************************************************************************)
+(*                                                                           *)
+(*                                                                           *)
+(*  Copyright (C) 2023                                                       *)
+(*    Gabriel Santamaria                                                     *)
+(*                                                                           *)
+(*                                                                           *)
+(*  Licensed under the Apache License, Version 2.0 (the "License");          *)
+(*  you may not use this file except in compliance with the License.         *)
+(*  You may obtain a copy of the License at                                  *)
+(*                                                                           *)
+(*    http://www.apache.org/licenses/LICENSE-2.0                             *)
+(*                                                                           *)
+(*  Unless required by applicable law or agreed to in writing, software      *)
+(*  distributed under the License is distributed on an "AS IS" BASIS,        *)
+(*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *)
+(*  See the License for the specific language governing permissions and      *)
+(*  limitations under the License.                                           *)
+(*                                                                           *)
+(*****************************************************************************)
+
+type t = {offset: float; drift: float; points: (int * float) array}
+
+(* half-wave rectified derivative of the log energy of frames of [hop]
+   samples, made zero-mean *)
+let envelope (hop : int) (x : Audio.View.t) : float array =
+  let frames = Audio.View.length x / hop in
+  let energy = Array.make frames 0. in
+  for f = 0 to frames - 1 do
+    let e = ref 1e-10 in
+    for i = f * hop to ((f + 1) * hop) - 1 do
+      let v = Audio.View.get x i in
+      e := !e +. (v *. v)
+    done ;
+    energy.(f) <- Float.log !e
+  done ;
+  let env =
+    Array.init frames (fun f ->
+        if f = 0 then 0. else Float.max 0. (energy.(f) -. energy.(f - 1)) )
+  in
+  let mean = Array.fold_left ( +. ) 0. env /. float_of_int (max 1 frames) in
+  Array.map (fun x -> x -. mean) env
+
+(* index of the maximum of [c], refined with a parabola through its
+   neighbours *)
+let peak (c : float array) : float =
+  let best = ref 0 in
+  Array.iteri (fun i x -> if x > c.(!best) then best := i) c ;
+  let i = !best in
+  if i = 0 || i = Array.length c - 1 then float_of_int i
+  else
+    let a = c.(i - 1) and b = c.(i) and d = c.(i + 1) in
+    let denom = a -. (2. *. b) +. d in
+    if denom >= 0. then float_of_int i
+    else float_of_int i +. (0.5 *. (a -. d) /. denom)
+
+(* segment [\[start; start + len\[] of a signal, zero outside of it *)
+let segment (x : Audio.View.t) (start : int) (len : int) : float array =
+  let n = Audio.View.length x in
+  Array.init len (fun i ->
+      let j = start + i in
+      if j < 0 || j >= n then 0. else Audio.View.get x j )
+
+(* offset of [b] relatively to [a] around the frame [pos] of [a], searched
+   within [radius] frames of [guess] by a full-rate correlation of [len]
+   frames *)
+let refine (a : Audio.View.t) (b : Audio.View.t) ~pos ~len ~guess ~radius :
+    float =
+  let sa = segment a pos len in
+  let sb = segment b (pos + guess - radius) (len + (2 * radius)) in
+  let c = Dsp.correlate sa sb ~lo:0 ~hi:(2 * radius) in
+  float_of_int (guess - radius) +. peak c
+
+(* coarse offset, in frames, of [eb] relatively to [ea] for lags between
+   [lo] and [hi] envelope frames *)
+let coarse (hop : int) (ea : float array) (eb : float array) ~lo ~hi : int =
+  let c = Dsp.correlate ea eb ~lo ~hi in
+  let best = ref 0 in
+  Array.iteri (fun i x -> if x > c.(!best) then best := i) c ;
+  (lo + !best) * hop
+
+(* checks the recordings and returns their mixdowns, the maximal lag in
+   envelope frames and the length of the refinement windows *)
+let prepare ~(hop : int) ~(max_offset : float) ~(window : float)
+    ~(reference : Audio.audio) (a : Audio.audio) =
+  let rate x = Audio.Metadata.sample_rate (Audio.meta x) in
+  if rate reference <> rate a then
+    raise
+      (Invalid_argument
+         "Analysis.Sync: the recordings have different sample rates" ) ;
+  if hop <= 0 then raise (Invalid_argument "Analysis.Sync: invalid hop") ;
+  let sample_rate = float_of_int (rate a) in
+  let ra = Audio.View.of_data (Audio.mixdown reference)
+  and rb = Audio.View.of_data (Audio.mixdown a) in
+  let max_lag = int_of_float (max_offset *. sample_rate) / hop in
+  let len = max hop (int_of_float (window *. sample_rate)) in
+  (ra, rb, max_lag, len)
+
+let offset ?(hop : int = 512) ?(max_offset : float = 60.)
+    ?(window : float = 2.) ~(reference : Audio.audio) (a : Audio.audio) :
+    float =
+  let ra, rb, max_lag, len = prepare ~hop ~max_offset ~window ~reference a in
+  let ea = envelope hop ra and eb = envelope hop rb in
+  let guess = coarse hop ea eb ~lo:(-max_lag) ~hi:max_lag in
+  (* the refinement window is taken where the reference is the loudest *)
+  let pos =
+    let best = ref 0 in
+    Array.iteri (fun i x -> if x > ea.(!best) then best := i) ea ;
+    max 0 ((!best * hop) - (len / 2))
+  in
+  refine ra rb ~pos ~len ~guess ~radius:(2 * hop)
+
+let estimate ?(domains : int = Parallel.default_domains ()) ?(hop : int = 512)
+    ?(max_offset : float = 60.) ?(window : float = 2.) ?(windows : int = 16)
+    ~(reference : Audio.audio) (a : Audio.audio) : t =
+  let ra, rb, max_lag, len = prepare ~hop ~max_offset ~window ~reference a in
+  let ea = envelope hop ra and eb = envelope hop rb in
+  let guess = coarse hop ea eb ~lo:(-max_lag) ~hi:max_lag in
+  (* common part of the recordings, in frames of the reference *)
+  let first = max 0 (-guess)
+  and last =
+    min (Audio.View.length ra) (Audio.View.length rb - guess) - len
+  in
+  let windows = if last <= first then 1 else max 1 windows in
+  let positions =
+    Array.init windows (fun k ->
+        if windows = 1 then first
+        else first + ((last - first) * k / (windows - 1)) )
+  in
+  (* each window gets its own coarse estimate on a few seconds of envelope,
+     the drift being possibly larger than the refinement radius *)
+  let span = max 1 (4 * len / hop) and radius = max 2 (len / hop) in
+  let measure pos =
+    let p = pos / hop in
+    let sub e start =
+      Array.init span (fun i ->
+          let j = start + i in
+          if j < 0 || j >= Array.length e then 0. else e.(j) )
+    in
+    let local =
+      coarse hop
+        (sub ea p)
+        (sub eb (p + (guess / hop)))
+        ~lo:(-radius) ~hi:radius
+    in
+    let guess = guess + local in
+    (pos, refine ra rb ~pos ~len ~guess ~radius:(2 * hop))
+  in
+  let points = Parallel.map ~domains measure positions in
+  (* least squares fit of the offsets against the positions *)
+  let n = float_of_int (Array.length points) in
+  let mx = Array.fold_left (fun s (p, _) -> s +. float_of_int p) 0. points /. n
+  and my = Array.fold_left (fun s (_, o) -> s +. o) 0. points /. n in
+  let sxx, sxy =
+    Array.fold_left
+      (fun (sxx, sxy) (p, o) ->
+        let dx = float_of_int p -. mx in
+        (sxx +. (dx *. dx), sxy +. (dx *. (o -. my))) )
+      (0., 0.) points
+  in
+  let drift = if sxx = 0. then 0. else sxy /. sxx in
+  {offset= my -. (drift *. mx); drift; points}
+
+let position (s : t) (i : int) : float =
+  s.offset +. (float_of_int i *. (1. +. s.drift))
@@ -0,0 +1,81 @@
+(*****************************************************************************)
+(*                                                                           *)
+(*                                                                           *)
+(*  Copyright (C) 2023                                                       *)
+(*    Gabriel Santamaria                                                     *)
+(*                                                                           *)
+(*                                                                           *)
+(*  Licensed under the Apache License, Version 2.0 (the "License");          *)
+(*  you may not use this file except in compliance with the License.         *)
+(*  You may obtain a copy of the License at                                  *)
+(*                                                                           *)
+(*    http://www.apache.org/licenses/LICENSE-2.0                             *)
+(*                                                                           *)
+(*  Unless required by applicable law or agreed to in writing, software      *)
+(*  distributed under the License is distributed on an "AS IS" BASIS,        *)
+(*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *)
+(*  See the License for the specific language governing permissions and      *)
+(*  limitations under the License.                                           *)
+(*                                                                           *)
+(*****************************************************************************)
+
+(**
+    The {!Analysis.Sync} module aligns several recordings of the same event,
+    made by devices whose clocks are neither started together nor running at
+    exactly the same rate.
+
+    Offsets are first estimated coarsely by correlating onset envelopes,
+    which are decimated by the hop size, then refined by a full-rate
+    correlation restricted to a small window around the coarse estimate.
+    Repeating the estimation on windows spread across the recordings gives
+    the clock drift. *)
+
+type t =
+  { offset: float
+        (** position, in frames of the audio, matching the first frame of the
+            reference *)
+  ; drift: float
+        (** number of extra frames of the audio per frame of the reference,
+            [1e-6] being one ppm *)
+  ; points: (int * float) array
+        (** windowed offsets [(position, offset)], positions being expressed
+            in frames of the reference *) }
+
+val offset :
+     ?hop:int
+  -> ?max_offset:float
+  -> ?window:float
+  -> reference:Audio.audio
+  -> Audio.audio
+  -> float
+(**
+    [offset ?hop ?max_offset ?window ~reference audio] returns the position,
+    in frames of [audio], matching the first frame of [~reference], with a
+    sub-sample precision.
+
+    Envelopes have one value every [?hop] frames (default is [512]) and
+    offsets are searched within [?max_offset] seconds (default is [60.]).
+    The refinement correlates [?window] seconds (default is [2.]) of both
+    recordings at full rate. *)
+
+val estimate :
+     ?domains:int
+  -> ?hop:int
+  -> ?max_offset:float
+  -> ?window:float
+  -> ?windows:int
+  -> reference:Audio.audio
+  -> Audio.audio
+  -> t
+(**
+    [estimate ?domains ?hop ?max_offset ?window ?windows ~reference audio]
+    estimates the offset and the drift of [audio] relatively to
+    [~reference]. The offset is measured on [?windows] windows (default is
+    [16]) spread over the common part of the recordings, in parallel over at
+    most [?domains] domains, and the drift is the slope of the line fitted
+    through them. Other arguments are the ones of {!offset}. *)
+
+val position : t -> int -> float
+(**
+    [position s i] returns the position in the audio matching the frame [i]
+    of the reference *)
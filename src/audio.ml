@@ -49,10 +49,12 @@ end
 
 type audio =
   { meta: Metadata.t
-  ; icodec: Avutil.audio Avcodec.params
+  ; icodec: Avutil.audio Avcodec.params option
   ; data: (float, Bigarray.float32_elt) G.t }
 
-let create (meta : Metadata.t) icodec data = {meta; icodec; data}
+let create (meta : Metadata.t) icodec data = {meta; icodec= Some icodec; data}
+
+let of_generated (meta : Metadata.t) data = {meta; icodec= None; data}
 
 let meta (a : audio) = a.meta
 
@@ -70,38 +72,64 @@ let data (a : audio) = a.data
 let set_data (a : audio) (d : (float, Bigarray.float32_elt) G.t) =
   {a with data= d}
 
-let codec (a : audio) = a.icodec
+let mixdown (a : audio) : (float, Bigarray.float32_elt) G.t =
+  let channels = Metadata.channels a.meta in
+  let frames = rawsize a / channels in
+  let m = G.mean ~axis:1 (G.reshape a.data [|frames; channels|]) in
+  G.reshape m [|frames|]
 
-let sample_pos (a : audio) (x : int) =
-  Int.of_float
-    ( float_of_int x /. 1000.
-    *. float_of_int (Metadata.sample_rate (meta a))
-    *. float_of_int (Metadata.channels (meta a)) )
+let codec (a : audio) =
+  match a.icodec with
+  | Some icodec ->
+      icodec
+  | None ->
+      raise (Invalid_argument "Audio.codec: audio not attached to a codec")
 
-let get_slice (slice : int * int) (a : audio) : audio =
+let codec_opt (a : audio) = a.icodec
+
+let planar (a : audio) : (float, Bigarray.float32_elt) G.t =
+  let channels = Metadata.channels a.meta in
+  G.reshape a.data [|rawsize a / channels; channels|] |> G.transpose
+
+let of_planar (a : audio) (p : (float, Bigarray.float32_elt) G.t) : audio =
+  let data = G.transpose p in
+  {a with data= G.reshape data [|G.numel data|]}
+
+(* converts the slice [(x, y)] expressed in milliseconds to the positions of
+   the first and last samples of the slice *)
+let slice_bounds (fname : string) (meta : Metadata.t) (size : int)
+    (slice : int * int) : int * int =
+  let sample_pos (x : int) =
+    Int.of_float
+      ( float_of_int x /. 1000.
+      *. float_of_int (Metadata.sample_rate meta)
+      *. float_of_int (Metadata.channels meta) )
+  in
   let x, y = slice in
   let x, y =
-    match (sample_pos a x, sample_pos a y) with
+    match (sample_pos x, sample_pos y) with
     | x, y when x < 0 ->
-        (rawsize a + x, y)
+        (size + x, y)
     | x, y when y < 0 ->
-        (x, rawsize a + y)
+        (x, size + y)
     | x, y when x < 0 && y < 0 ->
-        (rawsize a + x, rawsize a + y)
+        (size + x, size + y)
     | x, y ->
         (x, y)
   in
   let x, y = if x < y then (x, y) else (y, x) in
   if x < 0 || y < 0 then
-    raise
-      (Invalid_argument "Audio.get_slice: slice out of bounds, negative values")
-  else if x >= rawsize a || y >= rawsize a then
+    raise (Invalid_argument (fname ^ ": slice out of bounds, negative values"))
+  else if x >= size || y >= size then
     raise
       (Invalid_argument
-         "Audio.get_slice: slice out of bounds, values greater than rawsize" )
-  else
-    let data = G.get_slice [[x; y]] a.data in
-    {a with data}
+         (fname ^ ": slice out of bounds, values greater than rawsize") )
+  else (x, y)
+
+let get_slice (slice : int * int) (a : audio) : audio =
+  let x, y = slice_bounds "Audio.get_slice" a.meta (rawsize a) slice in
+  let data = G.get_slice [[x; y]] a.data in
+  {a with data}
 
 let get (x : int) (a : audio) : float =
   let slice = get_slice (x, x) a |> data in
@@ -117,3 +145,618 @@ let ( .%{} ) i x = get x i
 let ( $/ ) x f = normalize ~factor:f x
 
 let ( /$ ) f x = normalize ~factor:f x
+
+module View = struct
+  type buffer =
+    (float, Bigarray.float32_elt, Bigarray.c_layout) Bigarray.Array1.t
+
+  type t = {buf: buffer; offset: int; stride: int; length: int}
+
+  let of_data ?(offset : int = 0) ?(stride : int = 1) ?length
+      (d : (float, Bigarray.float32_elt) G.t) : t =
+    let size = G.numel d in
+    if stride <= 0 then
+      raise (Invalid_argument "Audio.View.of_data: stride must be positive") ;
+    let max_length =
+      if offset >= size then 0 else ((size - offset - 1) / stride) + 1
+    in
+    let length = Option.value length ~default:max_length in
+    if offset < 0 || length < 0 || length > max_length then
+      raise (Invalid_argument "Audio.View.of_data: view out of bounds") ;
+    {buf= Bigarray.reshape_1 d size; offset; stride; length}
+
+  let of_audio (a : audio) : t = of_data a.data
+
+  let channel (a : audio) (c : int) : t =
+    let channels = Metadata.channels a.meta in
+    if c < 0 || c >= channels then
+      raise (Invalid_argument "Audio.View.channel: no such channel") ;
+    of_data ~offset:c ~stride:channels a.data
+
+  let buffer (v : t) = v.buf
+
+  let offset (v : t) = v.offset
+
+  let stride (v : t) = v.stride
+
+  let length (v : t) = v.length
+
+  let get (v : t) (i : int) : float =
+    if i < 0 || i >= v.length then
+      raise (Invalid_argument "Audio.View.get: index out of bounds") ;
+    Bigarray.Array1.unsafe_get v.buf (v.offset + (i * v.stride))
+
+  let set (v : t) (i : int) (x : float) : unit =
+    if i < 0 || i >= v.length then
+      raise (Invalid_argument "Audio.View.set: index out of bounds") ;
+    Bigarray.Array1.unsafe_set v.buf (v.offset + (i * v.stride)) x
+
+  let sub (v : t) (start : int) (length : int) : t =
+    if start < 0 || length < 0 || start + length > v.length then
+      raise (Invalid_argument "Audio.View.sub: view out of bounds") ;
+    {v with offset= v.offset + (start * v.stride); length}
+
+  let iteri (f : int -> float -> unit) (v : t) : unit =
+    for i = 0 to v.length - 1 do
+      f i (Bigarray.Array1.unsafe_get v.buf (v.offset + (i * v.stride)))
+    done
+
+  let iter (f : float -> unit) (v : t) : unit = iteri (fun _ x -> f x) v
+
+  let fold (f : 'a -> float -> 'a) (acc : 'a) (v : t) : 'a =
+    let acc = ref acc in
+    iter (fun x -> acc := f !acc x) v ;
+    !acc
+
+  let map_inplace (f : float -> float) (v : t) : unit =
+    for i = 0 to v.length - 1 do
+      let j = v.offset + (i * v.stride) in
+      Bigarray.Array1.(unsafe_set v.buf j (f (unsafe_get v.buf j)))
+    done
+
+  let blit (v : t) (dst : float array) (pos : int) : unit =
+    if pos < 0 || pos + v.length > Array.length dst then
+      raise (Invalid_argument "Audio.View.blit: destination is too small") ;
+    for i = 0 to v.length - 1 do
+      Array.unsafe_set dst (pos + i)
+        (Bigarray.Array1.unsafe_get v.buf (v.offset + (i * v.stride)))
+    done
+
+  let copy (v : t) : (float, Bigarray.float32_elt) G.t =
+    let out =
+      Bigarray.Array1.create Bigarray.Float32 Bigarray.c_layout v.length
+    in
+    for i = 0 to v.length - 1 do
+      Bigarray.Array1.unsafe_set out i
+        (Bigarray.Array1.unsafe_get v.buf (v.offset + (i * v.stride)))
+    done ;
+    Bigarray.genarray_of_array1 out
+
+  type frames = {base: t; hop: int; size: int; count: int}
+
+  let frames ?hop ~(length : int) (v : t) : frames =
+    let hop = Option.value hop ~default:length in
+    if length <= 0 || hop <= 0 then
+      raise
+        (Invalid_argument "Audio.View.frames: length and hop must be positive") ;
+    let count =
+      if v.length < length then 0 else ((v.length - length) / hop) + 1
+    in
+    {base= v; hop; size= length; count}
+
+  let count (f : frames) = f.count
+
+  let frame_length (f : frames) = f.size
+
+  let hop (f : frames) = f.hop
+
+  let frame (f : frames) (i : int) : t =
+    if i < 0 || i >= f.count then
+      raise (Invalid_argument "Audio.View.frame: frame out of bounds") ;
+    sub f.base (i * f.hop) f.size
+
+  let to_matrix (f : frames) : (float, Bigarray.float32_elt) G.t =
+    let out = G.empty Bigarray.Float32 [|f.size; f.count|] in
+    let m = Bigarray.reshape_1 out (f.size * f.count) in
+    let step = f.base.stride in
+    for i = 0 to f.count - 1 do
+      let start = f.base.offset + (i * f.hop * step) in
+      for j = 0 to f.size - 1 do
+        Bigarray.Array1.unsafe_set m
+          ((j * f.count) + i)
+          (Bigarray.Array1.unsafe_get f.base.buf (start + (j * step)))
+      done
+    done ;
+    out
+end
+
+module Compressed = struct
+  type t =
+    { cmeta: Metadata.t
+    ; cicodec: Avutil.audio Avcodec.params option
+    ; bits: int
+    ; scale: float
+    ; block_size: int (* number of frames per block *)
+    ; frames: int
+    ; blocks: string array array (* one encoded string per channel *) }
+
+  let compress ?(bits : int = 16) ?(block_size : int = 4096) ?scale ?domains
+      (a : audio) : t =
+    if bits < 2 || bits > 32 then
+      raise
+        (Invalid_argument "Audio.Compressed.compress: bits must be in [2; 32]") ;
+    if block_size <= 0 then
+      raise
+        (Invalid_argument
+           "Audio.Compressed.compress: block_size must be positive" ) ;
+    let scale =
+      match scale with
+      | Some s ->
+          s
+      | None ->
+          Float.pow 2. (float_of_int (bits - 1))
+    in
+    let channels = Metadata.channels a.meta in
+    let raw = Bigarray.reshape_1 a.data (rawsize a) in
+    let frames = rawsize a / channels in
+    let lo = -(1 lsl (bits - 1)) and hi = (1 lsl (bits - 1)) - 1 in
+    let encode (b : int) =
+      let start = b * block_size in
+      let n = min block_size (frames - start) in
+      let x = Array.make n 0 in
+      Array.init channels (fun c ->
+          for i = 0 to n - 1 do
+            let v = Bigarray.Array1.get raw (((start + i) * channels) + c) in
+            let q = int_of_float (Float.round (v *. scale)) in
+            x.(i) <- max lo (min hi q)
+          done ;
+          Lossless.encode_block ~bits x 0 n )
+    in
+    let nblocks = (frames + block_size - 1) / block_size in
+    let blocks = Parallel.map ?domains encode (Array.init nblocks Fun.id) in
+    {cmeta= a.meta; cicodec= a.icodec; bits; scale; block_size; frames; blocks}
+
+  let meta (t : t) = t.cmeta
+
+  let rawsize (t : t) = t.frames * Metadata.channels t.cmeta
+
+  let size (t : t) =
+    Array.fold_left
+      (Array.fold_left (fun acc s -> acc + String.length s))
+      0 t.blocks
+
+  (* decodes the blocks [b0] to [b1] (included) into a fresh buffer starting at
+     the first frame of [b0] *)
+  let decode ?domains (t : t) (b0 : int) (b1 : int) =
+    let channels = Metadata.channels t.cmeta in
+    let first = b0 * t.block_size in
+    let last = min t.frames ((b1 + 1) * t.block_size) in
+    let out =
+      Bigarray.Array1.create Bigarray.Float32 Bigarray.c_layout
+        ((last - first) * channels)
+    in
+    let inv = 1. /. t.scale in
+    Parallel.parallel_for ?domains (b1 - b0 + 1) (fun i ->
+        let b = b0 + i in
+        let start = b * t.block_size in
+        let n = min t.block_size (t.frames - start) in
+        let x = Array.make n 0 in
+        let base = (start - first) * channels in
+        Array.iteri
+          (fun c s ->
+            Lossless.decode_block ~bits:t.bits s x n ;
+            for i = 0 to n - 1 do
+              Bigarray.Array1.unsafe_set out
+                (base + (i * channels) + c)
+                (float_of_int (Array.unsafe_get x i) *. inv)
+            done )
+          t.blocks.(b) ) ;
+    out
+
+  let to_audio ?domains (t : t) : audio =
+    let data =
+      if t.frames = 0 then G.empty Bigarray.Float32 [|0|]
+      else
+        decode ?domains t 0 (Array.length t.blocks - 1)
+        |> Bigarray.genarray_of_array1
+    in
+    {meta= t.cmeta; icodec= t.cicodec; data}
+
+  let get_slice (slice : int * int) (t : t) : audio =
+    let channels = Metadata.channels t.cmeta in
+    let x, y =
+      slice_bounds "Audio.Compressed.get_slice" t.cmeta (rawsize t) slice
+    in
+    let b0 = x / channels / t.block_size in
+    let b1 = y / channels / t.block_size in
+    let out = decode t b0 b1 in
+    let offset = x - (b0 * t.block_size * channels) in
+    let data =
+      Bigarray.Array1.sub out offset (y - x + 1) |> Bigarray.genarray_of_array1
+    in
+    {meta= t.cmeta; icodec= t.cicodec; data}
+
+  let get (x : int) (t : t) : float =
+    let slice = get_slice (x, x) t |> data in
+    G.get slice [|0|]
+end
+
+module Gen = struct
+  (* size of the chunks signals are computed by, which must not depend on the
+     number of domains for the output to be reproducible *)
+  let chunk = 65536
+
+  let frames_of (fname : string) (sample_rate : int) (duration : float) : int
+      =
+    if duration < 0. || sample_rate <= 0 then
+      raise (Invalid_argument (fname ^ ": invalid duration or sample rate")) ;
+    int_of_float (Float.round (duration *. float_of_int sample_rate))
+
+  (* interleaves the [channels] signals returned by [channel c] *)
+  let make ~(sample_rate : int) ~(channels : int) (n : int)
+      (channel : int -> float array) : audio =
+    if channels <= 0 then
+      raise (Invalid_argument "Audio.Gen: channels must be positive") ;
+    let meta =
+      Metadata.create ~name:"Generated" channels 32 sample_rate
+        (32 * sample_rate * channels)
+    in
+    let data = G.zeros Bigarray.Float32 [|n * channels|] in
+    let raw = Bigarray.reshape_1 data (n * channels) in
+    for c = 0 to channels - 1 do
+      let x = channel c in
+      for i = 0 to n - 1 do
+        Bigarray.Array1.unsafe_set raw ((i * channels) + c) x.(i)
+      done
+    done ;
+    of_generated meta data
+
+  (* same signal on every channel *)
+  let replicate ~(sample_rate : int) ~(channels : int) (n : int)
+      (x : float array) : audio =
+    make ~sample_rate ~channels n (fun _ -> x)
+
+  (* adds to [x] a sine whose phase at frame [i] is [phase + w i + d i (i -
+     1) / 2]. Each chunk starts from the exact phase and then follows a
+     recursive phasor whose rotation is itself rotated by [d]. *)
+  let oscillator (x : float array) ~(amplitude : float) ~(phase : float)
+      ~(w : float) ~(d : float) : unit =
+    let n = Array.length x in
+    Parallel.chunks ~chunk n (fun start stop ->
+        let t = float_of_int start in
+        let p = phase +. (w *. t) +. (d *. t *. (t -. 1.) /. 2.) in
+        let r = w +. (d *. t) in
+        let pr = ref (amplitude *. Float.cos p)
+        and pi = ref (amplitude *. Float.sin p) in
+        let rr = ref (Float.cos r) and ri = ref (Float.sin r) in
+        let qr = Float.cos d and qi = Float.sin d in
+        for i = start to stop - 1 do
+          Array.unsafe_set x i (Array.unsafe_get x i +. !pi) ;
+          let v = (!pr *. !rr) -. (!pi *. !ri) in
+          pi := (!pr *. !ri) +. (!pi *. !rr) ;
+          pr := v ;
+          if d <> 0. then (
+            let v = (!rr *. qr) -. (!ri *. qi) in
+            ri := (!rr *. qi) +. (!ri *. qr) ;
+            rr := v )
+        done )
+
+  let silence ?(sample_rate : int = 44100) ?(channels : int = 1)
+      (duration : float) : audio =
+    let n = frames_of "Audio.Gen.silence" sample_rate duration in
+    replicate ~sample_rate ~channels n (Array.make n 0.)
+
+  let multitone ?(sample_rate : int = 44100) ?(channels : int = 1)
+      (tones : (float * float) list) (duration : float) : audio =
+    let n = frames_of "Audio.Gen.multitone" sample_rate duration in
+    let x = Array.make n 0. in
+    List.iter
+      (fun (freq, amplitude) ->
+        let w = 2. *. Float.pi *. freq /. float_of_int sample_rate in
+        oscillator x ~amplitude ~phase:0. ~w ~d:0. )
+      tones ;
+    replicate ~sample_rate ~channels n x
+
+  let sine ?(sample_rate : int = 44100) ?(channels : int = 1)
+      ?(amplitude : float = 1.) ?(phase : float = 0.) (freq : float)
+      (duration : float) : audio =
+    let n = frames_of "Audio.Gen.sine" sample_rate duration in
+    let x = Array.make n 0. in
+    let w = 2. *. Float.pi *. freq /. float_of_int sample_rate in
+    oscillator x ~amplitude ~phase ~w ~d:0. ;
+    replicate ~sample_rate ~channels n x
+
+  type chirp = Linear | Logarithmic
+
+  (* samples of a chirp from [f0] to [f1] over [n] frames *)
+  let chirp_samples ~(sample_rate : int) ~(amplitude : float) (kind : chirp)
+      (f0 : float) (f1 : float) (n : int) : float array =
+    let fs = float_of_int sample_rate in
+    let x = Array.make n 0. in
+    ( match kind with
+    | Linear ->
+        let w = 2. *. Float.pi *. f0 /. fs in
+        let d =
+          2. *. Float.pi *. (f1 -. f0) /. fs /. float_of_int (max 1 (n - 1))
+        in
+        oscillator x ~amplitude ~phase:0. ~w ~d
+    | Logarithmic ->
+        if f0 <= 0. || f1 <= 0. then
+          raise
+            (Invalid_argument
+               "Audio.Gen.chirp: logarithmic chirps need positive frequencies" ) ;
+        (* the frequency is multiplied by a constant ratio at each sample,
+           which a phasor recursion can't follow, so the phase is computed *)
+        let duration = float_of_int n /. fs in
+        let k = Float.log (f1 /. f0) in
+        let c = 2. *. Float.pi *. f0 *. duration /. k in
+        Parallel.chunks ~chunk n (fun start stop ->
+            for i = start to stop - 1 do
+              let t = float_of_int i /. fs in
+              let phase = c *. Float.expm1 (k *. t /. duration) in
+              x.(i) <- amplitude *. Float.sin phase
+            done ) ) ;
+    x
+
+  let chirp ?(sample_rate : int = 44100) ?(channels : int = 1)
+      ?(amplitude : float = 1.) ?(kind : chirp = Linear) (f0 : float)
+      (f1 : float) (duration : float) : audio =
+    let n = frames_of "Audio.Gen.chirp" sample_rate duration in
+    replicate ~sample_rate ~channels n
+      (chirp_samples ~sample_rate ~amplitude kind f0 f1 n)
+
+  (* raised cosine fades at both ends of [x] *)
+  let fade_in_out (x : float array) (len : int) : unit =
+    let n = Array.length x in
+    let len = min len (n / 2) in
+    for i = 0 to len - 1 do
+      let t = Float.pi *. float_of_int i /. float_of_int len in
+      let g = 0.5 -. (0.5 *. Float.cos t) in
+      x.(i) <- x.(i) *. g ;
+      x.(n - 1 - i) <- x.(n - 1 - i) *. g
+    done
+
+  let sweep ?(sample_rate : int = 44100) ?(channels : int = 1)
+      ?(amplitude : float = 1.) ?(fade : float = 0.01) (f0 : float) (f1 : float)
+      (duration : float) : audio =
+    let n = frames_of "Audio.Gen.sweep" sample_rate duration in
+    let x = chirp_samples ~sample_rate ~amplitude Logarithmic f0 f1 n in
+    fade_in_out x (int_of_float (fade *. float_of_int sample_rate)) ;
+    replicate ~sample_rate ~channels n x
+
+  let inverse_sweep ?(sample_rate : int = 44100) ?(fade : float = 0.01)
+      (f0 : float) (f1 : float) (duration : float) : audio =
+    let n = frames_of "Audio.Gen.inverse_sweep" sample_rate duration in
+    let x = chirp_samples ~sample_rate ~amplitude:1. Logarithmic f0 f1 n in
+    fade_in_out x (int_of_float (fade *. float_of_int sample_rate)) ;
+    (* time reversal, with a 6 dB per octave decay compensating the energy
+       the sweep spends at low frequencies *)
+    let k = Float.log (f1 /. f0) in
+    let norm = 2. *. k /. (float_of_int n *. (1. -. (f0 /. f1))) in
+    let y =
+      Array.init n (fun i ->
+          let t = float_of_int i /. float_of_int n in
+          norm *. x.(n - 1 - i) *. Float.exp (-.k *. t) )
+    in
+    replicate ~sample_rate ~channels:1 n y
+
+  type noise = White | Pink | Brown
+
+  (* uniform float in [-1; 1[ depending only on [seed] and [counter] *)
+  let uniform (seed : int) (counter : int) : float =
+    (2. *. Dsp.Rng.uniform seed counter) -. 1.
+
+  (* number of octaves of the Voss-McCartney pink noise generator *)
+  let rows = 16
+
+  (* leak of the brown noise integrator, which keeps it from drifting *)
+  let leak = 0.999
+
+  let noise_samples ~(amplitude : float) ~(seed : int) (kind : noise)
+      (n : int) : float array =
+    let x = Array.make n 0. in
+    ( match kind with
+    | White ->
+        Parallel.chunks ~chunk n (fun start stop ->
+            for i = start to stop - 1 do
+              x.(i) <- amplitude *. uniform seed i
+            done )
+    | Pink ->
+        (* the row [k] holds a value drawn again every [2^k] frames, which is
+           a function of [i lsr k] and can be evaluated at any frame *)
+        let scale = amplitude /. Float.sqrt (float_of_int (rows + 1)) in
+        Parallel.chunks ~chunk n (fun start stop ->
+            for i = start to stop - 1 do
+              let s = ref (uniform seed (i * (rows + 1))) in
+              for k = 0 to rows - 1 do
+                s := !s +. uniform (seed + k + 1) (i lsr k)
+              done ;
+              x.(i) <- scale *. !s
+            done )
+    | Brown ->
+        (* leaky integration, computed in two passes: each chunk is first
+           integrated from zero, then the states at the chunk boundaries are
+           propagated and each chunk is integrated again from its own *)
+        let gain = amplitude *. Float.sqrt (1. -. (leak *. leak)) in
+        let chunks = (n + chunk - 1) / chunk in
+        let integrate start stop y0 =
+          let y = ref y0 in
+          for i = start to stop - 1 do
+            y := (leak *. !y) +. (gain *. uniform seed i) ;
+            x.(i) <- !y
+          done ;
+          !y
+        in
+        let ends = Array.make chunks 0. in
+        Parallel.parallel_for chunks (fun c ->
+            let start = c * chunk in
+            ends.(c) <- integrate start (min n (start + chunk)) 0. ) ;
+        let starts = Array.make chunks 0. in
+        for c = 1 to chunks - 1 do
+          let len = float_of_int (min chunk (n - ((c - 1) * chunk))) in
+          starts.(c) <- (Float.pow leak len *. starts.(c - 1)) +. ends.(c - 1)
+        done ;
+        Parallel.parallel_for chunks (fun c ->
+            let start = c * chunk in
+            ignore (integrate start (min n (start + chunk)) starts.(c)) ) ) ;
+    x
+
+  let noise ?(sample_rate : int = 44100) ?(channels : int = 1)
+      ?(amplitude : float = 1.) ?(seed : int = 0) (kind : noise)
+      (duration : float) : audio =
+    let n = frames_of "Audio.Gen.noise" sample_rate duration in
+    make ~sample_rate ~channels n (fun c ->
+        let seed = Dsp.Rng.mix (seed + (c * 7919)) in
+        noise_samples ~amplitude ~seed kind n )
+
+  let impulse ?(sample_rate : int = 44100) ?(channels : int = 1)
+      ?(amplitude : float = 1.) ?(at : float = 0.) ?period (duration : float) :
+      audio =
+    let n = frames_of "Audio.Gen.impulse" sample_rate duration in
+    let fs = float_of_int sample_rate in
+    let x = Array.make n 0. in
+    let first = int_of_float (Float.round (at *. fs)) in
+    ( match period with
+    | None ->
+        if first >= 0 && first < n then x.(first) <- amplitude
+    | Some p ->
+        if p <= 0. then
+          raise
+            (Invalid_argument "Audio.Gen.impulse: period must be positive") ;
+        let pos k =
+          first + int_of_float (Float.round (float_of_int k *. p *. fs))
+        in
+        let k = ref 0 in
+        while pos !k < n do
+          if pos !k >= 0 then x.(pos !k) <- amplitude ;
+          incr k
+        done ) ;
+    replicate ~sample_rate ~channels n x
+end
+
+type channel_qc =
+  { peak: float
+  ; true_peak: float
+  ; rms: float
+  ; dc: float
+  ; clipped: int
+  ; clipped_runs: int
+  ; silence: float
+  ; bandwidth: float }
+
+type qc = {duration: float; channels: channel_qc array}
+
+(* number of samples on each side of the interpolated positions used by the
+   true peak oversampling filter *)
+let tp_half = 6
+
+(* windowed sinc interpolation taps for the positions [p / 4], [p] in [1; 3],
+   between the samples [tp_half - 1] and [tp_half] of the history *)
+let tp_taps =
+  Array.init 3 (fun p ->
+      let frac = float_of_int (p + 1) /. 4. in
+      Array.init (2 * tp_half) (fun k ->
+          let t = float_of_int (k - tp_half + 1) -. frac in
+          let sinc =
+            if t = 0. then 1. else Float.sin (Float.pi *. t) /. (Float.pi *. t)
+          in
+          let w =
+            0.5 *. (1. +. Float.cos (Float.pi *. t /. float_of_int tp_half))
+          in
+          sinc *. w ) )
+
+let channel_qc ~clip ~min_run ~silence ~floor ~nfft (a : audio) (c : int) :
+    channel_qc =
+  let channels = Metadata.channels a.meta in
+  let raw = Bigarray.reshape_1 a.data (rawsize a) in
+  let n = rawsize a / channels in
+  let stft = Dsp.Stft.create nfft in
+  let re = Array.make nfft 0. and im = Array.make nfft 0. in
+  let spectrum = Array.make ((nfft / 2) + 1) 0. in
+  let power = Array.make ((nfft / 2) + 1) 0. in
+  let frame = Array.make nfft 0. and pos = ref 0 in
+  let frames = ref 0 and silent = ref 0 and voiced = ref 0 in
+  let silence = Float.pow 10. (silence /. 20.) in
+  let end_frame (len : int) =
+    let e = ref 0. in
+    for i = 0 to len - 1 do
+      e := !e +. (frame.(i) *. frame.(i))
+    done ;
+    incr frames ;
+    if Float.sqrt (!e /. float_of_int len) < silence then incr silent
+    else if len = nfft then (
+      incr voiced ;
+      Dsp.Stft.power stft ~re ~im (Array.get frame) spectrum ;
+      for k = 0 to nfft / 2 do
+        power.(k) <- power.(k) +. spectrum.(k)
+      done )
+  in
+  let history = Array.make (2 * tp_half) 0. and h = ref 0 in
+  let sum = ref 0. and sumsq = ref 0. and peak = ref 0. and tpeak = ref 0. in
+  let run = ref 0 and clipped = ref 0 and runs = ref 0 in
+  let end_run () =
+    if !run >= min_run then (incr runs ; clipped := !clipped + !run) ;
+    run := 0
+  in
+  for i = 0 to n - 1 do
+    let x = Bigarray.Array1.unsafe_get raw ((i * channels) + c) in
+    let ax = Float.abs x in
+    sum := !sum +. x ;
+    sumsq := !sumsq +. (x *. x) ;
+    if ax > !peak then peak := ax ;
+    if ax >= clip then incr run else end_run () ;
+    (* true peak, the history being a ring whose oldest sample is at [!h] *)
+    history.(!h) <- x ;
+    h := (!h + 1) mod (2 * tp_half) ;
+    Array.iter
+      (fun taps ->
+        let y = ref 0. in
+        for k = 0 to (2 * tp_half) - 1 do
+          y := !y +. (taps.(k) *. history.((!h + k) mod (2 * tp_half)))
+        done ;
+        if Float.abs !y > !tpeak then tpeak := Float.abs !y )
+      tp_taps ;
+    frame.(!pos) <- x ;
+    incr pos ;
+    if !pos = nfft then (end_frame nfft ; pos := 0)
+  done ;
+  end_run () ;
+  if !pos > 0 then end_frame !pos ;
+  let bandwidth =
+    if !voiced = 0 then 0.
+    else
+      let top = Array.fold_left Float.max 0. power in
+      let limit = top *. Float.pow 10. (floor /. 10.) in
+      let k = ref (nfft / 2) in
+      while !k > 0 && power.(!k) < limit do
+        decr k
+      done ;
+      float_of_int !k *. float_of_int (Metadata.sample_rate a.meta)
+      /. float_of_int nfft
+  in
+  let count = float_of_int (max 1 n) in
+  { peak= !peak
+  ; true_peak= Float.max !peak !tpeak
+  ; rms= Float.sqrt (!sumsq /. count)
+  ; dc= !sum /. count
+  ; clipped= !clipped
+  ; clipped_runs= !runs
+  ; silence=
+      (if !frames = 0 then 1. else float_of_int !silent /. float_of_int !frames)
+  ; bandwidth }
+
+let qc ?(clip : float = 0.999) ?(min_run : int = 3) ?(silence : float = -60.)
+    ?(floor : float = -70.) ?(nfft : int = 2048) (a : audio) : qc =
+  if nfft <= 0 || nfft land (nfft - 1) <> 0 then
+    raise (Invalid_argument "Audio.qc: nfft must be a power of two") ;
+  let channels = Metadata.channels a.meta in
+  { duration=
+      float_of_int (rawsize a / channels)
+      /. float_of_int (Metadata.sample_rate a.meta)
+  ; channels=
+      Array.init channels (channel_qc ~clip ~min_run ~silence ~floor ~nfft a)
+  }
+
+let qc_batch ?(domains : int = Parallel.default_domains ()) ?clip ?min_run
+    ?silence ?floor ?nfft (audios : audio array) : qc array =
+  Parallel.map ~domains (qc ?clip ?min_run ?silence ?floor ?nfft) audios
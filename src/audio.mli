@@ -88,6 +88,11 @@ val create :
 (**
     [create metadata icodec data] creates a new audio with the given name and metadata *)
 
+val of_generated : Metadata.t -> (float, Bigarray.float32_elt) G.t -> audio
+(**
+    [of_generated metadata data] creates a new audio that is not attached to
+    any codec, such as a synthesized signal. See {!codec_opt}. *)
+
 val meta : audio -> Metadata.t
 (**
     [meta audio] returns the metadata attached to the given audio element *)
@@ -109,9 +114,32 @@ val set_data :
 (**
     [set_data audio data] sets the data of the given audio element *)
 
+val planar : audio -> (float, Bigarray.float32_elt) G.t
+(**
+    [planar audio] returns a copy of the data of the given audio element as a
+    planar matrix of shape [\[|channels; frames|\]], one channel per row *)
+
+val of_planar : audio -> (float, Bigarray.float32_elt) G.t -> audio
+(**
+    [of_planar audio p] returns a copy of [audio] whose data is the planar
+    matrix [p], interleaved back *)
+
+val mixdown : audio -> (float, Bigarray.float32_elt) G.t
+(**
+    [mixdown audio] returns the average of the channels of the given audio
+    element, as a one dimensional array of its frames *)
+
 val codec : audio -> Avutil.audio Avcodec.params
 (**
-    [codec audio] returns the codec of the given audio element *)
+    [codec audio] returns the parameters of the codec the given audio element
+    was decoded with.
+
+    @raise Invalid_argument if [audio] was built by {!of_generated}. *)
+
+val codec_opt : audio -> Avutil.audio Avcodec.params option
+(**
+    [codec_opt audio] returns the parameters of the codec the given audio
+    element was decoded with, or [None] if it was built by {!of_generated} *)
 
 val get : int -> audio -> float
 (**
@@ -183,3 +211,340 @@ val ( $/ ) : audio -> float -> unit
 
 val ( /$ ) : float -> audio -> unit
 (** Operator of {!Audio.normalize} *)
+
+(**
+    {1 Views}
+
+    Selecting a channel of interleaved audio data or cutting it in overlapping
+    frames with Owl's slicing functions copies the data. The {!View} module
+    describes these selections without copying anything: a view is a strided
+    window over the underlying buffer of an audio data. *)
+
+module View : sig
+  type buffer =
+    (float, Bigarray.float32_elt, Bigarray.c_layout) Bigarray.Array1.t
+
+  type t
+
+  val of_data :
+       ?offset:int
+    -> ?stride:int
+    -> ?length:int
+    -> (float, Bigarray.float32_elt) G.t
+    -> t
+  (**
+      [of_data ?offset ?stride ?length data] creates a view over [data]
+      containing the [?length] elements located at [?offset + i * ?stride].
+      By default, [?offset] is [0], [?stride] is [1] and [?length] is the
+      largest possible one. *)
+
+  val of_audio : audio -> t
+  (**
+      [of_audio audio] creates a view over the whole (interleaved) data of
+      [audio] *)
+
+  val channel : audio -> int -> t
+  (**
+      [channel audio c] creates a view over the samples of the channel [c] of
+      [audio] *)
+
+  val buffer : t -> buffer
+  (**
+      [buffer v] returns the underlying buffer of [v]. Together with {!offset}
+      and {!stride}, this is meant to write tight loops over views. *)
+
+  val offset : t -> int
+  (**
+      [offset v] returns the index of the first element of [v] in its buffer *)
+
+  val stride : t -> int
+  (**
+      [stride v] returns the distance in the buffer between two consecutive
+      elements of [v] *)
+
+  val length : t -> int
+  (**
+      [length v] returns the number of elements of [v] *)
+
+  val get : t -> int -> float
+  (**
+      [get v i] returns the [i]-th element of [v] *)
+
+  val set : t -> int -> float -> unit
+  (**
+      [set v i x] sets the [i]-th element of [v], and thus of the underlying
+      data, to [x] *)
+
+  val sub : t -> int -> int -> t
+  (**
+      [sub v start length] returns the view of the [length] elements of [v]
+      starting at [start] *)
+
+  val iter : (float -> unit) -> t -> unit
+
+  val iteri : (int -> float -> unit) -> t -> unit
+
+  val fold : ('a -> float -> 'a) -> 'a -> t -> 'a
+
+  val map_inplace : (float -> float) -> t -> unit
+  (**
+      [map_inplace f v] replaces every element [x] of [v] by [f x] inside the
+      underlying data *)
+
+  val blit : t -> float array -> int -> unit
+  (**
+      [blit v dst pos] copies the elements of [v] into [dst] starting at
+      [pos] *)
+
+  val copy : t -> (float, Bigarray.float32_elt) G.t
+  (**
+      [copy v] returns a fresh contiguous array with the elements of [v] *)
+
+  (**
+      {2 Frames} *)
+
+  type frames
+
+  val frames : ?hop:int -> length:int -> t -> frames
+  (**
+      [frames ?hop ~length v] describes the frames of [~length] elements of
+      [v], each one starting [?hop] elements after the previous one (by
+      default, frames don't overlap). Only complete frames are described. *)
+
+  val count : frames -> int
+  (**
+      [count f] returns the number of frames *)
+
+  val frame_length : frames -> int
+  (**
+      [frame_length f] returns the number of elements of each frame *)
+
+  val hop : frames -> int
+  (**
+      [hop f] returns the distance between the beginnings of two frames *)
+
+  val frame : frames -> int -> t
+  (**
+      [frame f i] returns a view over the [i]-th frame *)
+
+  val to_matrix : frames -> (float, Bigarray.float32_elt) G.t
+  (**
+      [to_matrix f] copies the frames into a matrix of shape
+      [\[|frame_length f; count f|\]], one frame per column *)
+end
+
+(**
+    {1 Compressed audio}
+
+    Keeping large amounts of audio in memory as [float32] data takes twice the
+    size of the 16 bits sources it usually comes from. The {!Compressed} module
+    stores audio losslessly compressed in memory, as independently decodable
+    blocks encoded with FLAC-like linear predictors and Rice coded residuals.
+    Accessing a slice of the audio only decompresses the blocks it touches. *)
+
+module Compressed : sig
+  type t
+
+  val compress :
+    ?bits:int -> ?block_size:int -> ?scale:float -> ?domains:int -> audio -> t
+  (**
+      [compress ?bits ?block_size ?scale ?domains audio] compresses the given
+      audio element.
+
+      Each sample is first quantized as [round (sample *. scale)] on [?bits]
+      bits (default is [16]), [?scale] being [2^(bits - 1)] by default. The
+      compression is lossless for data that was quantized this way, which is
+      the case of normalized audio decoded from a [?bits] bits source.
+
+      [?block_size] is the number of frames per block (default is [4096]).
+      Blocks are compressed in parallel over [?domains] domains. *)
+
+  val meta : t -> Metadata.t
+  (**
+      [meta c] returns the metadata attached to the compressed audio *)
+
+  val rawsize : t -> int
+  (**
+      [rawsize c] returns the number of samples of the compressed audio *)
+
+  val size : t -> int
+  (**
+      [size c] returns the size in bytes of the compressed blocks *)
+
+  val to_audio : ?domains:int -> t -> audio
+  (**
+      [to_audio ?domains c] decompresses the whole audio element, decoding
+      blocks in parallel over [?domains] domains. *)
+
+  val get_slice : int * int -> t -> audio
+  (**
+      [get_slice (start, stop) c] works like {!Audio.get_slice} but only
+      decompresses the blocks containing the requested slice. *)
+
+  val get : int -> t -> float
+  (**
+      [get x c] works like {!Audio.get} but only decompresses the block
+      containing the requested sample. *)
+end
+
+(**
+    {1 Signal generators}
+
+    The {!Gen} module synthesizes test signals directly in memory. Generators
+    are deterministic: long signals are computed by chunks in parallel, and
+    noises use a counter-based random generator, so that the same arguments
+    always give the same samples whatever the number of domains. Generated
+    audio elements are built by {!of_generated}, and are written by
+    {!Io.write} using their metadata. *)
+
+module Gen : sig
+  val silence : ?sample_rate:int -> ?channels:int -> float -> audio
+  (**
+      [silence ?sample_rate ?channels duration] returns [duration] seconds of
+      silence. The sample rate defaults to [44100] and the number of channels
+      to [1], for every generator. *)
+
+  val sine :
+       ?sample_rate:int
+    -> ?channels:int
+    -> ?amplitude:float
+    -> ?phase:float
+    -> float
+    -> float
+    -> audio
+  (**
+      [sine ?sample_rate ?channels ?amplitude ?phase freq duration] returns a
+      sine wave of [freq] Hz. [?amplitude] defaults to [1.] and [?phase],
+      in radians, to [0.]. *)
+
+  val multitone :
+    ?sample_rate:int -> ?channels:int -> (float * float) list -> float -> audio
+  (**
+      [multitone ?sample_rate ?channels tones duration] returns the sum of the
+      sine waves [(freq, amplitude)] of [tones]. *)
+
+  type chirp = Linear | Logarithmic
+
+  val chirp :
+       ?sample_rate:int
+    -> ?channels:int
+    -> ?amplitude:float
+    -> ?kind:chirp
+    -> float
+    -> float
+    -> float
+    -> audio
+  (**
+      [chirp ?sample_rate ?channels ?amplitude ?kind f0 f1 duration] returns a
+      sine wave whose frequency goes from [f0] to [f1] Hz, linearly (the
+      default) or exponentially. *)
+
+  val sweep :
+       ?sample_rate:int
+    -> ?channels:int
+    -> ?amplitude:float
+    -> ?fade:float
+    -> float
+    -> float
+    -> float
+    -> audio
+  (**
+      [sweep ?sample_rate ?channels ?amplitude ?fade f0 f1 duration] returns
+      an exponential sine sweep faded in and out over [?fade] seconds
+      (default is [0.01]), as used to measure impulse responses. *)
+
+  val inverse_sweep :
+    ?sample_rate:int -> ?fade:float -> float -> float -> float -> audio
+  (**
+      [inverse_sweep ?sample_rate ?fade f0 f1 duration] returns the mono
+      inverse filter of {!sweep}: convolving the recording of a sweep with it
+      gives the impulse response of the system, delayed by [duration]. *)
+
+  type noise = White | Pink | Brown
+
+  val noise :
+       ?sample_rate:int
+    -> ?channels:int
+    -> ?amplitude:float
+    -> ?seed:int
+    -> noise
+    -> float
+    -> audio
+  (**
+      [noise ?sample_rate ?channels ?amplitude ?seed kind duration]
+      returns a noise whose power decreases by 0, 3 (pink) or 6 (brown) dB per
+      octave. Every noise has the standard deviation of a uniform white noise
+      in [\[-amplitude; amplitude\[]. Channels are independent, and [?seed]
+      (default is [0]) selects the realization. *)
+
+  val impulse :
+       ?sample_rate:int
+    -> ?channels:int
+    -> ?amplitude:float
+    -> ?at:float
+    -> ?period:float
+    -> float
+    -> audio
+  (**
+      [impulse ?sample_rate ?channels ?amplitude ?at ?period duration] returns
+      a unit impulse located at [?at] seconds (default is [0.]), repeated
+      every [?period] seconds if given. *)
+end
+
+(**
+    {1 Quality control}
+
+    {!qc} gathers the usual ingestion checks of an audio element in a single
+    pass over each of its channels. *)
+
+type channel_qc =
+  { peak: float  (** highest absolute sample value *)
+  ; true_peak: float
+        (** highest absolute value of the signal oversampled 4 times *)
+  ; rms: float  (** root mean square of the samples *)
+  ; dc: float  (** mean of the samples *)
+  ; clipped: int  (** number of samples belonging to clipped runs *)
+  ; clipped_runs: int  (** number of clipped runs *)
+  ; silence: float  (** ratio of silent frames, between [0] and [1] *)
+  ; bandwidth: float
+        (** estimated effective bandwidth, in Hz, of the non-silent frames *)
+  }
+
+type qc =
+  { duration: float  (** in seconds *)
+  ; channels: channel_qc array  (** one report per channel *) }
+
+val qc :
+     ?clip:float
+  -> ?min_run:int
+  -> ?silence:float
+  -> ?floor:float
+  -> ?nfft:int
+  -> audio
+  -> qc
+(**
+    [qc ?clip ?min_run ?silence ?floor ?nfft audio] computes the quality report
+    of [audio].
+
+    A clipped run is a sequence of at least [?min_run] (default is [3])
+    consecutive samples whose absolute value is at least [?clip] (default is
+    [0.999]). Frames of [?nfft] samples (default is [2048]) are silent when
+    their RMS level is below [?silence] dBFS (default is [-60.]). The
+    bandwidth is the highest frequency at which the averaged power spectrum of
+    the non-silent frames is above [?floor] dB (default is [-70.]) relative to
+    its maximum; upsampled material shows a bandwidth well below the Nyquist
+    frequency. *)
+
+val qc_batch :
+     ?domains:int
+  -> ?clip:float
+  -> ?min_run:int
+  -> ?silence:float
+  -> ?floor:float
+  -> ?nfft:int
+  -> audio array
+  -> qc array
+(**
+    [qc_batch ?domains audios] computes the reports of several audio elements
+    in parallel, over at most [?domains] domains. Other arguments are the ones
+    of {!qc}. *)
@@ -0,0 +1,189 @@
+(*****************************************************************************)
+(*                                                                           *)
+(*                                                                           *)
+(*  Copyright (C) 2023                                                       *)
+(*    Gabriel Santamaria                                                     *)
+(*                                                                           *)
+(*                                                                           *)
+(*  Licensed under the Apache License, Version 2.0 (the "License");          *)
+(*  you may not use this file except in compliance with the License.         *)
+(*  You may obtain a copy of the License at                                  *)
+(*                                                                           *)
+(*    http://www.apache.org/licenses/LICENSE-2.0                             *)
+(*                                                                           *)
+(*  Unless required by applicable law or agreed to in writing, software      *)
+(*  distributed under the License is distributed on an "AS IS" BASIS,        *)
+(*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *)
+(*  See the License for the specific language governing permissions and      *)
+(*  limitations under the License.                                           *)
+(*                                                                           *)
+(*****************************************************************************)
+
+module Fft = struct
+  type plan = {n: int; cos: float array; sin: float array; rev: int array}
+
+  let next_pow2 (n : int) : int =
+    let rec go p = if p >= n then p else go (2 * p) in
+    go 1
+
+  let create (n : int) : plan =
+    if n <= 0 || n land (n - 1) <> 0 then
+      raise (Invalid_argument "Dsp.Fft.plan: size must be a power of two") ;
+    let step = 2. *. Float.pi /. float_of_int n in
+    let twiddle f =
+      Array.init (max 1 (n / 2)) (fun k -> f (step *. float_of_int k))
+    in
+    let cos = twiddle Float.cos and sin = twiddle Float.sin in
+    let bits =
+      let rec log2 k acc = if k <= 1 then acc else log2 (k / 2) (acc + 1) in
+      log2 n 0
+    in
+    let rev =
+      Array.init n (fun i ->
+          let r = ref 0 in
+          for b = 0 to bits - 1 do
+            if i land (1 lsl b) <> 0 then r := !r lor (1 lsl (bits - 1 - b))
+          done ;
+          !r )
+    in
+    {n; cos; sin; rev}
+
+  let cache : (int, plan) Hashtbl.t = Hashtbl.create 16
+
+  let lock = Mutex.create ()
+
+  let plan (n : int) : plan =
+    Mutex.protect lock (fun () ->
+        match Hashtbl.find_opt cache n with
+        | Some p ->
+            p
+        | None ->
+            let p = create n in
+            Hashtbl.replace cache n p ; p )
+
+  let size (p : plan) : int = p.n
+
+  (* iterative radix-2 decimation in time, [sign] being the sign of the
+     exponent of the twiddle factors *)
+  let transform (p : plan) (sign : float) (re : float array)
+      (im : float array) : unit =
+    let n = p.n in
+    if Array.length re < n || Array.length im < n then
+      raise (Invalid_argument "Dsp.Fft: arrays are smaller than the plan") ;
+    for i = 0 to n - 1 do
+      let j = Array.unsafe_get p.rev i in
+      if j > i then (
+        let t = re.(i) in
+        re.(i) <- re.(j) ;
+        re.(j) <- t ;
+        let t = im.(i) in
+        im.(i) <- im.(j) ;
+        im.(j) <- t )
+    done ;
+    let len = ref 2 in
+    while !len <= n do
+      let half = !len / 2 in
+      let step = n / !len in
+      let i = ref 0 in
+      while !i < n do
+        for k = 0 to half - 1 do
+          let wr = Array.unsafe_get p.cos (k * step) in
+          let wi = sign *. Array.unsafe_get p.sin (k * step) in
+          let a = !i + k and b = !i + k + half in
+          let xr = Array.unsafe_get re b and xi = Array.unsafe_get im b in
+          let vr = (xr *. wr) -. (xi *. wi) and vi = (xr *. wi) +. (xi *. wr) in
+          let ur = Array.unsafe_get re a and ui = Array.unsafe_get im a in
+          Array.unsafe_set re a (ur +. vr) ;
+          Array.unsafe_set im a (ui +. vi) ;
+          Array.unsafe_set re b (ur -. vr) ;
+          Array.unsafe_set im b (ui -. vi)
+        done ;
+        i := !i + !len
+      done ;
+      len := !len * 2
+    done
+
+  let forward (p : plan) (re : float array) (im : float array) : unit =
+    transform p (-1.) re im
+
+  let inverse (p : plan) (re : float array) (im : float array) : unit =
+    transform p 1. re im ;
+    let inv = 1. /. float_of_int p.n in
+    for i = 0 to p.n - 1 do
+      Array.unsafe_set re i (Array.unsafe_get re i *. inv) ;
+      Array.unsafe_set im i (Array.unsafe_get im i *. inv)
+    done
+end
+
+module Stft = struct
+  type t = {plan: Fft.plan; window: float array}
+
+  let hann (n : int) : float array =
+    Array.init n (fun i ->
+        let t = 2. *. Float.pi *. float_of_int i /. float_of_int n in
+        0.5 -. (0.5 *. Float.cos t) )
+
+  let create ?window (nfft : int) : t =
+    let window = match window with Some w -> w | None -> hann nfft in
+    if Array.length window > nfft then
+      raise (Invalid_argument "Dsp.Stft.create: window longer than nfft") ;
+    {plan= Fft.plan nfft; window}
+
+  let size (s : t) : int = Fft.size s.plan
+
+  let window (s : t) : float array = s.window
+
+  let frames (s : t) ~(hop : int) (n : int) : int =
+    let length = Array.length s.window in
+    if n < length then 0 else ((n - length) / hop) + 1
+
+  let power (s : t) ~(re : float array) ~(im : float array)
+      (sample : int -> float) (out : float array) : unit =
+    let nfft = Fft.size s.plan and length = Array.length s.window in
+    for i = 0 to length - 1 do
+      Array.unsafe_set re i (sample i *. Array.unsafe_get s.window i) ;
+      Array.unsafe_set im i 0.
+    done ;
+    Array.fill re length (nfft - length) 0. ;
+    Array.fill im length (nfft - length) 0. ;
+    Fft.forward s.plan re im ;
+    for k = 0 to nfft / 2 do
+      let r = Array.unsafe_get re k and i = Array.unsafe_get im k in
+      Array.unsafe_set out k ((r *. r) +. (i *. i))
+    done
+end
+
+let correlate (a : float array) (b : float array) ~(lo : int) ~(hi : int) :
+    float array =
+  let na = Array.length a and nb = Array.length b in
+  let size = Fft.next_pow2 (max 1 (na + nb)) in
+  let plan = Fft.plan size in
+  let ar = Array.make size 0. and ai = Array.make size 0. in
+  let br = Array.make size 0. and bi = Array.make size 0. in
+  Array.blit a 0 ar 0 na ;
+  Array.blit b 0 br 0 nb ;
+  Fft.forward plan ar ai ;
+  Fft.forward plan br bi ;
+  (* conj(A) * B, whose inverse holds the lag [l] at [l mod size] *)
+  for k = 0 to size - 1 do
+    let xr = ar.(k) and xi = ai.(k) in
+    ar.(k) <- (xr *. br.(k)) +. (xi *. bi.(k)) ;
+    ai.(k) <- (xr *. bi.(k)) -. (xi *. br.(k))
+  done ;
+  Fft.inverse plan ar ai ;
+  Array.init
+    (max 0 (hi - lo + 1))
+    (fun i ->
+      let l = lo + i in
+      if l <= -na || l >= nb then 0. else ar.((l + size) mod size) )
+
+module Rng = struct
+  let mix (z : int) : int =
+    let z = (z lxor (z lsr 30)) * 0x3f58476d1ce4e5b9 in
+    let z = (z lxor (z lsr 27)) * 0x14d049bb133111eb in
+    z lxor (z lsr 31)
+
+  let uniform (seed : int) (counter : int) : float =
+    let z = mix ((counter * 0x1e3779b97f4a7c15) + mix seed) in
+    float_of_int ((z land max_int) lsr 9) *. 0x1p-53
+end
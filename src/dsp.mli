@@ -0,0 +1,133 @@
+(*****************************************************************************)
+(*                                                                           *)
+(*                                                                           *)
+(*  Copyright (C) 2023                                                       *)
+(*    Gabriel Santamaria                                                     *)
+(*                                                                           *)
+(*                                                                           *)
+(*  Licensed under the Apache License, Version 2.0 (the "License");          *)
+(*  you may not use this file except in compliance with the License.         *)
+(*  You may obtain a copy of the License at                                  *)
+(*                                                                           *)
+(*    http://www.apache.org/licenses/LICENSE-2.0                             *)
+(*                                                                           *)
+(*  Unless required by applicable law or agreed to in writing, software      *)
+(*  distributed under the License is distributed on an "AS IS" BASIS,        *)
+(*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *)
+(*  See the License for the specific language governing permissions and      *)
+(*  limitations under the License.                                           *)
+(*                                                                           *)
+(*****************************************************************************)
+
+(**
+    The {!Dsp} module contains the low-level signal processing kernels shared
+    by the streaming parts of SoundML. Unlike the Owl based functions, they
+    work in place on preallocated [float array]s so that they can run block
+    after block without allocating. *)
+
+(**
+    {1 Fast Fourier Transform} *)
+
+module Fft : sig
+  type plan
+
+  val plan : int -> plan
+  (**
+      [plan n] returns the plan of the complex FFT of size [n], which must be
+      a power of two. Plans are cached and can be shared between domains. *)
+
+  val size : plan -> int
+  (**
+      [size p] returns the size of the FFTs computed with [p] *)
+
+  val forward : plan -> float array -> float array -> unit
+  (**
+      [forward p re im] computes in place the FFT of the complex signal whose
+      real and imaginary parts are [re] and [im]. *)
+
+  val inverse : plan -> float array -> float array -> unit
+  (**
+      [inverse p re im] computes in place the inverse FFT, normalized by
+      [1 / n], of the spectrum whose real and imaginary parts are [re] and
+      [im]. *)
+
+  val next_pow2 : int -> int
+  (**
+      [next_pow2 n] returns the smallest power of two greater or equal to
+      [n] *)
+end
+
+(**
+    {1 Short-time power spectra}
+
+    The {!Stft} module computes the power spectra of the windowed frames of a
+    signal, for the features and analyses working frame by frame. *)
+
+module Stft : sig
+  type t
+
+  val hann : int -> float array
+  (**
+      [hann n] returns the periodic Hann window of [n] samples *)
+
+  val create : ?window:float array -> int -> t
+  (**
+      [create ?window nfft] prepares the power spectra of size [nfft], which
+      must be a power of two, of frames weighted by [?window]. The window
+      defaults to [hann nfft]; a shorter one gives frames of its length, zero
+      padded to [nfft]. A value of type [t] can be shared between domains. *)
+
+  val size : t -> int
+  (**
+      [size s] returns the size of the FFTs computed by [s] *)
+
+  val window : t -> float array
+  (**
+      [window s] returns the window applied to the frames *)
+
+  val frames : t -> hop:int -> int -> int
+  (**
+      [frames s ~hop n] returns the number of complete frames, [hop] samples
+      apart, of a signal of [n] samples *)
+
+  val power :
+       t
+    -> re:float array
+    -> im:float array
+    -> (int -> float)
+    -> float array
+    -> unit
+  (**
+      [power s ~re ~im sample out] windows the frame whose [i]-th sample is
+      [sample i], and writes the power of its bins [0] to [size s / 2] into
+      [out]. [re] and [im] are scratch buffers of at least [size s]
+      elements, owned by the calling domain. *)
+end
+
+(**
+    {1 Correlation} *)
+
+val correlate : float array -> float array -> lo:int -> hi:int -> float array
+(**
+    [correlate a b ~lo ~hi] returns the cross-correlation
+    [c.(l - lo) = sum_i a.(i) *. b.(i + l)] for every lag [l] in [\[lo; hi\]],
+    samples outside of [b] being zero. It is computed with a single FFT of the
+    size of both signals. *)
+
+(**
+    {1 Deterministic random numbers} *)
+
+(**
+    Counter-based generator: every draw only depends on a seed and a
+    counter, so that noise can be generated in parallel, or restarted at any
+    position, and still be reproducible. *)
+module Rng : sig
+  val mix : int -> int
+  (**
+      [mix z] is the splitmix64 finalizer, truncated to OCaml integers. It is
+      a stateless hash with good avalanche properties. *)
+
+  val uniform : int -> int -> float
+  (**
+      [uniform seed counter] returns a uniform float in [\[0; 1\[] *)
+end
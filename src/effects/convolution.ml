@@ -0,0 +1,186 @@
+(*****************************************************************************)
+(*                                                                           *)
+(*                                                                           *)
+(*  Copyright (C) 2023                                                       *)
+(*    Gabriel Santamaria                                                     *)
+(*                                                                           *)
+(*                                                                           *)
+(*  Licensed under the Apache License, Version 2.0 (the "License");          *)
+(*  you may not use this file except in compliance with the License.         *)
+(*  You may obtain a copy of the License at                                  *)
+(*                                                                           *)
+(*    http://www.apache.org/licenses/LICENSE-2.0                             *)
+(*                                                                           *)
+(*  Unless required by applicable law or agreed to in writing, software      *)
+(*  distributed under the License is distributed on an "AS IS" BASIS,        *)
+(*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *)
+(*  See the License for the specific language governing permissions and      *)
+(*  limitations under the License.                                           *)
+(*                                                                           *)
+(*****************************************************************************)
+
+type ir =
+  { block: int
+  ; length: int
+  ; plan: Dsp.Fft.plan
+  ; (* spectra of the partitions, [block + 1] bins each *)
+    h_re: float array array
+  ; h_im: float array array }
+
+let prepare ?(block : int = 1024) (h : (float, Bigarray.float32_elt) Audio.G.t)
+    : ir =
+  if block <= 0 || block land (block - 1) <> 0 then
+    raise
+      (Invalid_argument
+         "Effects.Convolution.prepare: block must be a power of two" ) ;
+  let length = Audio.G.numel h in
+  let h = Bigarray.reshape_1 h length in
+  let plan = Dsp.Fft.plan (2 * block) in
+  let partitions = max 1 ((length + block - 1) / block) in
+  let spectrum p =
+    let re = Array.make (2 * block) 0. and im = Array.make (2 * block) 0. in
+    for i = 0 to min block (length - (p * block)) - 1 do
+      re.(i) <- Bigarray.Array1.get h ((p * block) + i)
+    done ;
+    Dsp.Fft.forward plan re im ;
+    (Array.sub re 0 (block + 1), Array.sub im 0 (block + 1))
+  in
+  let spectra = Array.init partitions spectrum in
+  { block
+  ; length
+  ; plan
+  ; h_re= Array.map fst spectra
+  ; h_im= Array.map snd spectra }
+
+let ir_length (ir : ir) = ir.length
+
+(* state of a single channel *)
+type channel =
+  { input: float array (* last [2 * block] input samples *)
+  ; output: float array (* last computed [block] output samples *)
+  ; fdl_re: float array array (* frequency-domain delay line *)
+  ; fdl_im: float array array }
+
+type t =
+  { ir: ir
+  ; chans: channel array
+  ; (* work buffers of size [2 * block] *)
+    work_re: float array
+  ; work_im: float array
+  ; mutable fill: int (* number of samples of the current block *)
+  ; mutable head: int (* slot of the most recent spectrum in the FDL *) }
+
+let create (ir : ir) ~(channels : int) : t =
+  let b = ir.block and p = Array.length ir.h_re in
+  let channel _ =
+    { input= Array.make (2 * b) 0.
+    ; output= Array.make b 0.
+    ; fdl_re= Array.init p (fun _ -> Array.make (b + 1) 0.)
+    ; fdl_im= Array.init p (fun _ -> Array.make (b + 1) 0.) }
+  in
+  { ir
+  ; chans= Array.init channels channel
+  ; work_re= Array.make (2 * b) 0.
+  ; work_im= Array.make (2 * b) 0.
+  ; fill= 0
+  ; head= 0 }
+
+let latency (c : t) : int = c.ir.block
+
+let reset (c : t) : unit =
+  let clear a = Array.fill a 0 (Array.length a) 0. in
+  Array.iter
+    (fun ch ->
+      clear ch.input ;
+      clear ch.output ;
+      Array.iter clear ch.fdl_re ;
+      Array.iter clear ch.fdl_im )
+    c.chans ;
+  c.fill <- 0 ;
+  c.head <- 0
+
+(* computes the next [block] output samples of [ch] once its input buffer is
+   full *)
+let compute_block (c : t) (ch : channel) : unit =
+  let b = c.ir.block in
+  let partitions = Array.length c.ir.h_re in
+  let re = c.work_re and im = c.work_im in
+  Array.blit ch.input 0 re 0 (2 * b) ;
+  Array.fill im 0 (2 * b) 0. ;
+  Dsp.Fft.forward c.ir.plan re im ;
+  Array.blit re 0 ch.fdl_re.(c.head) 0 (b + 1) ;
+  Array.blit im 0 ch.fdl_im.(c.head) 0 (b + 1) ;
+  Array.fill re 0 (2 * b) 0. ;
+  Array.fill im 0 (2 * b) 0. ;
+  (* Y = sum_p X_(k - p) * H_p, over the non-redundant half of the spectrum *)
+  for p = 0 to partitions - 1 do
+    let slot = (c.head - p + partitions) mod partitions in
+    let xr = ch.fdl_re.(slot) and xi = ch.fdl_im.(slot) in
+    let hr = c.ir.h_re.(p) and hi = c.ir.h_im.(p) in
+    for k = 0 to b do
+      let ar = Array.unsafe_get xr k and ai = Array.unsafe_get xi k in
+      let br = Array.unsafe_get hr k and bi = Array.unsafe_get hi k in
+      let yr = Array.unsafe_get re k and yi = Array.unsafe_get im k in
+      Array.unsafe_set re k (yr +. ((ar *. br) -. (ai *. bi))) ;
+      Array.unsafe_set im k (yi +. ((ar *. bi) +. (ai *. br)))
+    done
+  done ;
+  (* the spectrum of a real signal is hermitian *)
+  for k = 1 to b - 1 do
+    re.((2 * b) - k) <- re.(k) ;
+    im.((2 * b) - k) <- -.im.(k)
+  done ;
+  Dsp.Fft.inverse c.ir.plan re im ;
+  (* overlap-save: only the last [block] samples are valid *)
+  Array.blit re b ch.output 0 b ;
+  Array.blit ch.input b ch.input 0 b
+
+let process (c : t) (block : (float, Bigarray.float32_elt) Audio.G.t) : unit =
+  let channels, n =
+    match Audio.G.shape block with
+    | [|channels; n|] ->
+        (channels, n)
+    | _ ->
+        raise
+          (Invalid_argument
+             "Effects.Convolution.process: blocks must be planar matrices" )
+  in
+  if channels <> Array.length c.chans then
+    raise
+      (Invalid_argument "Effects.Convolution.process: wrong channel count") ;
+  let buf = Bigarray.reshape_1 block (channels * n) in
+  let b = c.ir.block in
+  for i = 0 to n - 1 do
+    for ch = 0 to channels - 1 do
+      let state = c.chans.(ch) in
+      let j = (ch * n) + i in
+      state.input.(b + c.fill) <- Bigarray.Array1.unsafe_get buf j ;
+      Bigarray.Array1.unsafe_set buf j state.output.(c.fill)
+    done ;
+    c.fill <- c.fill + 1 ;
+    if c.fill = b then (
+      Array.iter (compute_block c) c.chans ;
+      c.head <- (c.head + 1) mod Array.length c.ir.h_re ;
+      c.fill <- 0 )
+  done
+
+let convolve ?(tail : bool = false) (ir : ir) (a : Audio.audio) : Audio.audio
+    =
+  let p = Audio.planar a in
+  let channels, frames =
+    match Audio.G.shape p with [|c; f|] -> (c, f) | _ -> assert false
+  in
+  let c = create ir ~channels in
+  let extra = if tail then ir.length - 1 else 0 in
+  let total = frames + extra in
+  if total = 0 then a
+  else
+    (* padding so that the delayed output, and the tail, get out *)
+    let padded = Audio.G.pad ~v:0. [[0; 0]; [0; extra + latency c]] p in
+    process c padded ;
+    Audio.G.get_slice [[]; [latency c; latency c + total - 1]] padded
+    |> Audio.of_planar a
+
+let convolve_batch ?domains ?tail (irs : ir array) (a : Audio.audio) :
+    Audio.audio array =
+  Parallel.map ?domains (fun ir -> convolve ?tail ir a) irs
@@ -0,0 +1,85 @@
+(*****************************************************************************)
+(*                                                                           *)
+(*                                                                           *)
+(*  Copyright (C) 2023                                                       *)
+(*    Gabriel Santamaria                                                     *)
+(*                                                                           *)
+(*                                                                           *)
+(*  Licensed under the Apache License, Version 2.0 (the "License");          *)
+(*  you may not use this file except in compliance with the License.         *)
+(*  You may obtain a copy of the License at                                  *)
+(*                                                                           *)
+(*    http://www.apache.org/licenses/LICENSE-2.0                             *)
+(*                                                                           *)
+(*  Unless required by applicable law or agreed to in writing, software      *)
+(*  distributed under the License is distributed on an "AS IS" BASIS,        *)
+(*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *)
+(*  See the License for the specific language governing permissions and      *)
+(*  limitations under the License.                                           *)
+(*                                                                           *)
+(*****************************************************************************)
+
+(**
+    The {!Effects.Convolution} module implements a uniformly partitioned
+    overlap-save convolution engine, suited to long impulse responses such as
+    room reverberations.
+
+    The impulse response is cut in partitions of [block] samples whose spectra
+    are computed once. The spectra of the last input blocks are kept in a
+    frequency-domain delay line, so each new block only costs one forward and
+    one inverse FFT of size [2 * block] plus a complex multiply-accumulate per
+    partition. The latency is [block] frames whatever the length of the
+    impulse response. *)
+
+type ir
+(**
+    Impulse response along with the cached spectra of its partitions *)
+
+val prepare : ?block:int -> (float, Bigarray.float32_elt) Audio.G.t -> ir
+(**
+    [prepare ?block h] partitions the mono impulse response [h] in blocks of
+    [?block] samples (default is [1024], must be a power of two) and computes
+    their spectra. *)
+
+val ir_length : ir -> int
+(**
+    [ir_length ir] returns the number of samples of the impulse response *)
+
+(**
+    {1 Streaming} *)
+
+type t
+
+val create : ir -> channels:int -> t
+(**
+    [create ir ~channels] creates a streaming convolver applying [ir] to each
+    of the [~channels] channels. Several convolvers can share the same [ir]. *)
+
+val latency : t -> int
+(**
+    [latency c] returns the delay, in frames, introduced by the convolver *)
+
+val process : t -> (float, Bigarray.float32_elt) Audio.G.t -> unit
+(**
+    [process c block] convolves in place the planar block of shape
+    [\[|channels; frames|\]], which can have any number of frames. The output
+    is late by {!latency} frames. *)
+
+val reset : t -> unit
+(**
+    [reset c] clears the delay line of the convolver *)
+
+(**
+    {1 Whole audio elements} *)
+
+val convolve : ?tail:bool -> ir -> Audio.audio -> Audio.audio
+(**
+    [convolve ?tail ir audio] convolves [audio] with [ir], compensating the
+    latency. The result has the length of [audio], unless [?tail] is [true]
+    (default is [false]) in which case the reverberation tail is kept. *)
+
+val convolve_batch :
+  ?domains:int -> ?tail:bool -> ir array -> Audio.audio -> Audio.audio array
+(**
+    [convolve_batch ?domains ?tail irs audio] convolves [audio] with each
+    impulse response of [irs], in parallel over [?domains] domains. *)
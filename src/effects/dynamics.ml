@@ -0,0 +1,289 @@
+(*****************************************************************************)
+(*                                                                           *)
+(*                                                                           *)
+(*  Copyright (C) 2023                                                       *)
+(*    Gabriel Santamaria                                                     *)
+(*                                                                           *)
+(*                                                                           *)
+(*  Licensed under the Apache License, Version 2.0 (the "License");          *)
+(*  you may not use this file except in compliance with the License.         *)
+(*  You may obtain a copy of the License at                                  *)
+(*                                                                           *)
+(*    http://www.apache.org/licenses/LICENSE-2.0                             *)
+(*                                                                           *)
+(*  Unless required by applicable law or agreed to in writing, software      *)
+(*  distributed under the License is distributed on an "AS IS" BASIS,        *)
+(*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *)
+(*  See the License for the specific language governing permissions and      *)
+(*  limitations under the License.                                           *)
+(*                                                                           *)
+(*****************************************************************************)
+
+type block = (float, Bigarray.float32_elt) Audio.G.t
+
+(* one-pole smoothing coefficient for a time constant of [t] seconds *)
+let coeff (sample_rate : int) (t : float) : float =
+  if t <= 0. then 0. else exp (-1. /. (t *. float_of_int sample_rate))
+
+let db_to_lin (db : float) : float = Float.pow 10. (db /. 20.)
+
+let lin_to_db (x : float) : float = 20. *. log10 (Float.max x 1e-10)
+
+(* number of channels and frames of a block, along with its flat buffer *)
+let unpack (b : block) =
+  match Audio.G.shape b with
+  | [|channels; n|] ->
+      (channels, n, Bigarray.reshape_1 b (channels * n))
+  | _ ->
+      raise
+        (Invalid_argument "Effects.Dynamics: blocks must be planar matrices")
+
+(* highest absolute value of the frame [i] *)
+let peak buf (channels : int) (n : int) (i : int) : float =
+  let p = ref 0. in
+  for c = 0 to channels - 1 do
+    let x = Bigarray.Array1.unsafe_get buf ((c * n) + i) in
+    p := Float.max !p (Float.abs x)
+  done ;
+  !p
+
+(* multiplies the frame [i] by [g] *)
+let apply buf (channels : int) (n : int) (i : int) (g : float) : unit =
+  for c = 0 to channels - 1 do
+    let j = (c * n) + i in
+    Bigarray.Array1.unsafe_set buf j (Bigarray.Array1.unsafe_get buf j *. g)
+  done
+
+module Compressor = struct
+  type t =
+    { threshold: float
+    ; ratio: float
+    ; knee: float
+    ; makeup: float
+    ; att: float
+    ; rel: float
+    ; mutable env: float (* current gain reduction, in dB *) }
+
+  let create ?(threshold : float = -20.) ?(ratio : float = 4.)
+      ?(knee : float = 6.) ?(attack : float = 0.01) ?(release : float = 0.1)
+      ?(makeup : float = 0.) ~(sample_rate : int) () : t =
+    { threshold
+    ; ratio
+    ; knee
+    ; makeup
+    ; att= coeff sample_rate attack
+    ; rel= coeff sample_rate release
+    ; env= 0. }
+
+  (* static gain computer, with a quadratic soft knee *)
+  let gain_reduction (c : t) (level : float) : float =
+    let over = level -. c.threshold in
+    let slope = (1. /. c.ratio) -. 1. in
+    if 2. *. over < -.c.knee then 0.
+    else if c.knee > 0. && 2. *. Float.abs over <= c.knee then
+      slope *. Float.pow (over +. (c.knee /. 2.)) 2. /. (2. *. c.knee)
+    else slope *. over
+
+  let process (c : t) (block : block) : unit =
+    let channels, n, buf = unpack block in
+    for i = 0 to n - 1 do
+      let gr = gain_reduction c (lin_to_db (peak buf channels n i)) in
+      let a = if gr < c.env then c.att else c.rel in
+      c.env <- (a *. c.env) +. ((1. -. a) *. gr) ;
+      apply buf channels n i (db_to_lin (c.env +. c.makeup))
+    done
+
+  let reset (c : t) : unit = c.env <- 0.
+end
+
+module Limiter = struct
+  type t =
+    { ceiling: float
+    ; rel: float
+    ; lookahead: int
+    ; channels: int
+    ; delay: float array (* one delay line of [lookahead] frames per channel *)
+    ; mutable pos: int
+    ; (* monotonic deque holding the candidates for the maximum of the last
+         [lookahead + 1] peaks, as a ring buffer *)
+      dq_val: float array
+    ; dq_idx: int array
+    ; mutable head: int
+    ; mutable size: int
+    ; mutable time: int
+    ; (* last [lookahead + 1] targets, whose mean ramps the gain down *)
+      ramp: float array
+    ; mutable ramp_pos: int
+    ; mutable ramp_sum: float
+    ; mutable gain: float }
+
+  let create ?(ceiling : float = -1.) ?(lookahead : float = 0.005)
+      ?(release : float = 0.05) ~(sample_rate : int) ~(channels : int) () : t
+      =
+    let lookahead =
+      max 0 (int_of_float (Float.round (lookahead *. float_of_int sample_rate)))
+    in
+    { ceiling= db_to_lin ceiling
+    ; rel= coeff sample_rate release
+    ; lookahead
+    ; channels
+    ; delay= Array.make (channels * lookahead) 0.
+    ; pos= 0
+    ; dq_val= Array.make (lookahead + 1) 0.
+    ; dq_idx= Array.make (lookahead + 1) 0
+    ; head= 0
+    ; size= 0
+    ; time= 0
+    ; ramp= Array.make (lookahead + 1) 1.
+    ; ramp_pos= 0
+    ; ramp_sum= float_of_int (lookahead + 1)
+    ; gain= 1. }
+
+  let latency (l : t) : int = l.lookahead
+
+  (* pushes the peak [v] and returns the maximum of the window *)
+  let window_max (l : t) (v : float) : float =
+    let cap = l.lookahead + 1 in
+    (* dropping the peaks that went out of the window *)
+    while l.size > 0 && l.dq_idx.(l.head) <= l.time - cap do
+      l.head <- (l.head + 1) mod cap ;
+      l.size <- l.size - 1
+    done ;
+    (* dropping the peaks that can't be the maximum anymore *)
+    while l.size > 0 && l.dq_val.((l.head + l.size - 1) mod cap) <= v do
+      l.size <- l.size - 1
+    done ;
+    let back = (l.head + l.size) mod cap in
+    l.dq_val.(back) <- v ;
+    l.dq_idx.(back) <- l.time ;
+    l.size <- l.size + 1 ;
+    l.time <- l.time + 1 ;
+    l.dq_val.(l.head)
+
+  let process (l : t) (block : block) : unit =
+    let channels, n, buf = unpack block in
+    if channels <> l.channels then
+      raise (Invalid_argument "Effects.Dynamics.Limiter: wrong channel count") ;
+    for i = 0 to n - 1 do
+      let m = window_max l (peak buf channels n i) in
+      let target = if m > l.ceiling then l.ceiling /. m else 1. in
+      (* the gain follows the mean of the last [lookahead + 1] targets, which
+         goes down linearly over the lookahead. Each of these targets covers
+         the delayed sample, so their mean never lets it go beyond the
+         ceiling. *)
+      l.ramp_sum <- l.ramp_sum -. l.ramp.(l.ramp_pos) +. target ;
+      l.ramp.(l.ramp_pos) <- target ;
+      l.ramp_pos <- (l.ramp_pos + 1) mod (l.lookahead + 1) ;
+      (* the running sum is recomputed once per turn, so that rounding errors
+         don't pile up *)
+      if l.ramp_pos = 0 then l.ramp_sum <- Array.fold_left ( +. ) 0. l.ramp ;
+      let ramped = l.ramp_sum /. float_of_int (l.lookahead + 1) in
+      l.gain <-
+        ( if ramped < l.gain then ramped
+          else ramped +. ((l.gain -. ramped) *. l.rel) ) ;
+      if l.lookahead = 0 then apply buf channels n i l.gain
+      else (
+        for c = 0 to channels - 1 do
+          let j = (c * n) + i in
+          let d = (c * l.lookahead) + l.pos in
+          let delayed = l.delay.(d) in
+          l.delay.(d) <- Bigarray.Array1.unsafe_get buf j ;
+          Bigarray.Array1.unsafe_set buf j (delayed *. l.gain)
+        done ;
+        l.pos <- (l.pos + 1) mod l.lookahead )
+    done
+
+  let reset (l : t) : unit =
+    Array.fill l.delay 0 (Array.length l.delay) 0. ;
+    l.pos <- 0 ;
+    l.head <- 0 ;
+    l.size <- 0 ;
+    l.time <- 0 ;
+    Array.fill l.ramp 0 (l.lookahead + 1) 1. ;
+    l.ramp_pos <- 0 ;
+    l.ramp_sum <- float_of_int (l.lookahead + 1) ;
+    l.gain <- 1.
+end
+
+module Agc = struct
+  type t =
+    { target: float
+    ; max_gain: float
+    ; gate: float (* in power *)
+    ; w: float
+    ; att: float
+    ; rel: float
+    ; mutable power: float
+    ; mutable gain: float (* in dB *) }
+
+  let create ?(target : float = -20.) ?(max_gain : float = 30.)
+      ?(gate : float = -60.) ?(window : float = 0.4) ?(attack : float = 0.05)
+      ?(release : float = 2.) ~(sample_rate : int) () : t =
+    { target
+    ; max_gain
+    ; gate= Float.pow 10. (gate /. 10.)
+    ; w= coeff sample_rate window
+    ; att= coeff sample_rate attack
+    ; rel= coeff sample_rate release
+    ; power= 0.
+    ; gain= 0. }
+
+  let process (agc : t) (block : block) : unit =
+    let channels, n, buf = unpack block in
+    let inv = 1. /. float_of_int channels in
+    for i = 0 to n - 1 do
+      let e = ref 0. in
+      for c = 0 to channels - 1 do
+        let x = Bigarray.Array1.unsafe_get buf ((c * n) + i) in
+        e := !e +. (x *. x)
+      done ;
+      agc.power <- (agc.w *. agc.power) +. ((1. -. agc.w) *. !e *. inv) ;
+      (* the gain is frozen on silences so that noise doesn't get amplified *)
+      ( if agc.power > agc.gate then
+          let desired =
+            Float.min agc.max_gain (agc.target -. (10. *. log10 agc.power))
+          in
+          let a = if desired < agc.gain then agc.att else agc.rel in
+          agc.gain <- (a *. agc.gain) +. ((1. -. a) *. desired) ) ;
+      apply buf channels n i (db_to_lin agc.gain)
+    done
+
+  let reset (agc : t) : unit = agc.power <- 0. ; agc.gain <- 0.
+end
+
+let sample_rate (a : Audio.audio) = Audio.Metadata.sample_rate (Audio.meta a)
+
+let compressor ?threshold ?ratio ?knee ?attack ?release ?makeup
+    (a : Audio.audio) : Audio.audio =
+  let c =
+    Compressor.create ?threshold ?ratio ?knee ?attack ?release ?makeup
+      ~sample_rate:(sample_rate a) ()
+  in
+  let p = Audio.planar a in
+  Compressor.process c p ; Audio.of_planar a p
+
+let limiter ?ceiling ?lookahead ?release (a : Audio.audio) : Audio.audio =
+  let channels = Audio.Metadata.channels (Audio.meta a) in
+  let l =
+    Limiter.create ?ceiling ?lookahead ?release ~sample_rate:(sample_rate a)
+      ~channels ()
+  in
+  let p = Audio.planar a in
+  let frames = (Audio.G.shape p).(1) in
+  let latency = Limiter.latency l in
+  if frames = 0 then a
+  else
+    (* the signal is padded so that its end gets out of the delay line *)
+    let padded = Audio.G.pad ~v:0. [[0; 0]; [0; latency]] p in
+    Limiter.process l padded ;
+    Audio.G.get_slice [[]; [latency; latency + frames - 1]] padded
+    |> Audio.of_planar a
+
+let agc ?target ?max_gain ?gate ?window ?attack ?release (a : Audio.audio) :
+    Audio.audio =
+  let g =
+    Agc.create ?target ?max_gain ?gate ?window ?attack ?release
+      ~sample_rate:(sample_rate a) ()
+  in
+  let p = Audio.planar a in
+  Agc.process g p ; Audio.of_planar a p
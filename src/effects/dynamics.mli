@@ -0,0 +1,175 @@
+(*****************************************************************************)
+(*                                                                           *)
+(*                                                                           *)
+(*  Copyright (C) 2023                                                       *)
+(*    Gabriel Santamaria                                                     *)
+(*                                                                           *)
+(*                                                                           *)
+(*  Licensed under the Apache License, Version 2.0 (the "License");          *)
+(*  you may not use this file except in compliance with the License.         *)
+(*  You may obtain a copy of the License at                                  *)
+(*                                                                           *)
+(*    http://www.apache.org/licenses/LICENSE-2.0                             *)
+(*                                                                           *)
+(*  Unless required by applicable law or agreed to in writing, software      *)
+(*  distributed under the License is distributed on an "AS IS" BASIS,        *)
+(*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *)
+(*  See the License for the specific language governing permissions and      *)
+(*  limitations under the License.                                           *)
+(*                                                                           *)
+(*****************************************************************************)
+
+(**
+    The {!Effects.Dynamics} module contains streaming dynamics processors: a
+    compressor, a lookahead limiter and an automatic gain control.
+
+    Every processor keeps its state between calls, so a signal can be
+    processed block by block. Blocks are planar matrices of shape
+    [\[|channels; frames|\]] (see {!Audio.planar}) processed in place, and no
+    memory is allocated while processing them. The gain is computed from all
+    the channels at once and applied to all of them, which preserves the
+    stereo image. *)
+
+type block = (float, Bigarray.float32_elt) Audio.G.t
+
+(**
+    {1 Compressor} *)
+
+module Compressor : sig
+  type t
+
+  val create :
+       ?threshold:float
+    -> ?ratio:float
+    -> ?knee:float
+    -> ?attack:float
+    -> ?release:float
+    -> ?makeup:float
+    -> sample_rate:int
+    -> unit
+    -> t
+  (**
+      [create ?threshold ?ratio ?knee ?attack ?release ?makeup ~sample_rate ()]
+      creates a feed-forward compressor.
+
+      [?threshold] (default [-20.]), [?knee] (default [6.]) and [?makeup]
+      (default [0.]) are expressed in dB, [?attack] (default [0.01]) and
+      [?release] (default [0.1]) in seconds. [?ratio] defaults to [4.]. *)
+
+  val process : t -> block -> unit
+  (**
+      [process c block] compresses the given block in place *)
+
+  val reset : t -> unit
+  (**
+      [reset c] resets the state of the compressor *)
+end
+
+(**
+    {1 Limiter} *)
+
+module Limiter : sig
+  type t
+
+  val create :
+       ?ceiling:float
+    -> ?lookahead:float
+    -> ?release:float
+    -> sample_rate:int
+    -> channels:int
+    -> unit
+    -> t
+  (**
+      [create ?ceiling ?lookahead ?release ~sample_rate ~channels ()] creates
+      a brickwall limiter whose output never goes beyond [?ceiling] dBFS
+      (default [-1.]).
+
+      The input is delayed by [?lookahead] seconds (default [0.005]) and the
+      gain is computed from the peak of the next [?lookahead] seconds, found
+      with a sliding maximum in constant amortized time. The gain goes down
+      linearly over the lookahead before each peak, rather than in a single
+      step, and goes back up with a [?release] time constant (default
+      [0.05]). *)
+
+  val latency : t -> int
+  (**
+      [latency l] returns the delay, in frames, introduced by the limiter *)
+
+  val process : t -> block -> unit
+  (**
+      [process l block] limits the given block in place. The output is late by
+      {!latency} frames. *)
+
+  val reset : t -> unit
+  (**
+      [reset l] resets the state of the limiter and clears its delay line *)
+end
+
+(**
+    {1 Automatic gain control} *)
+
+module Agc : sig
+  type t
+
+  val create :
+       ?target:float
+    -> ?max_gain:float
+    -> ?gate:float
+    -> ?window:float
+    -> ?attack:float
+    -> ?release:float
+    -> sample_rate:int
+    -> unit
+    -> t
+  (**
+      [create ?target ?max_gain ?gate ?window ?attack ?release ~sample_rate ()]
+      creates an automatic gain control bringing the RMS level of the signal,
+      measured over [?window] seconds (default [0.4]), to [?target] dBFS
+      (default [-20.]).
+
+      The gain never goes beyond [?max_gain] dB (default [30.]) and is frozen
+      while the level is under [?gate] dBFS (default [-60.]). It goes down
+      with the [?attack] time constant (default [0.05]) and up with the
+      [?release] one (default [2.]). *)
+
+  val process : t -> block -> unit
+  (**
+      [process agc block] processes the given block in place *)
+
+  val reset : t -> unit
+  (**
+      [reset agc] resets the state of the automatic gain control *)
+end
+
+(**
+    {1 Processing whole audio elements}
+
+    These functions process a whole {!Audio.audio} with a fresh processor,
+    compensating the latency of the limiter. *)
+
+val compressor :
+     ?threshold:float
+  -> ?ratio:float
+  -> ?knee:float
+  -> ?attack:float
+  -> ?release:float
+  -> ?makeup:float
+  -> Audio.audio
+  -> Audio.audio
+
+val limiter :
+     ?ceiling:float
+  -> ?lookahead:float
+  -> ?release:float
+  -> Audio.audio
+  -> Audio.audio
+
+val agc :
+     ?target:float
+  -> ?max_gain:float
+  -> ?gate:float
+  -> ?window:float
+  -> ?attack:float
+  -> ?release:float
+  -> Audio.audio
+  -> Audio.audio
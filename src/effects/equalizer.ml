@@ -0,0 +1,213 @@
+(*****************************************************************************)
+(*                                                                           *)
+(*                                                                           *)
+(*  Copyright (C) 2023                                                       *)
+(*    Gabriel Santamaria                                                     *)
+(*                                                                           *)
+(*                                                                           *)
+(*  Licensed under the Apache License, Version 2.0 (the "License");          *)
+(*  you may not use this file except in compliance with the License.         *)
+(*  You may obtain a copy of the License at                                  *)
+(*                                                                           *)
+(*    http://www.apache.org/licenses/LICENSE-2.0                             *)
+(*                                                                           *)
+(*  Unless required by applicable law or agreed to in writing, software      *)
+(*  distributed under the License is distributed on an "AS IS" BASIS,        *)
+(*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *)
+(*  See the License for the specific language governing permissions and      *)
+(*  limitations under the License.                                           *)
+(*                                                                           *)
+(*****************************************************************************)
+
+type band =
+  | Peak of {freq: float; gain: float; q: float}
+  | LowShelf of {freq: float; gain: float; q: float}
+  | HighShelf of {freq: float; gain: float; q: float}
+  | LowPass of {freq: float; q: float}
+  | HighPass of {freq: float; q: float}
+
+(* see https://www.w3.org/TR/audio-eq-cookbook/ *)
+let compute (sample_rate : int) (band : band) : float array =
+  let w0 freq = 2. *. Float.pi *. freq /. float_of_int sample_rate in
+  let alpha freq q = Float.sin (w0 freq) /. (2. *. q) in
+  let amp gain = Float.pow 10. (gain /. 40.) in
+  let b0, b1, b2, a0, a1, a2 =
+    match band with
+    | Peak {freq; gain; q} ->
+        let a = amp gain and alpha = alpha freq q in
+        let c = Float.cos (w0 freq) in
+        ( 1. +. (alpha *. a)
+        , -2. *. c
+        , 1. -. (alpha *. a)
+        , 1. +. (alpha /. a)
+        , -2. *. c
+        , 1. -. (alpha /. a) )
+    | LowShelf {freq; gain; q} ->
+        let a = amp gain and alpha = alpha freq q in
+        let c = Float.cos (w0 freq) in
+        let s = 2. *. Float.sqrt a *. alpha in
+        ( a *. (a +. 1. -. ((a -. 1.) *. c) +. s)
+        , 2. *. a *. (a -. 1. -. ((a +. 1.) *. c))
+        , a *. (a +. 1. -. ((a -. 1.) *. c) -. s)
+        , a +. 1. +. ((a -. 1.) *. c) +. s
+        , -2. *. (a -. 1. +. ((a +. 1.) *. c))
+        , a +. 1. +. ((a -. 1.) *. c) -. s )
+    | HighShelf {freq; gain; q} ->
+        let a = amp gain and alpha = alpha freq q in
+        let c = Float.cos (w0 freq) in
+        let s = 2. *. Float.sqrt a *. alpha in
+        ( a *. (a +. 1. +. ((a -. 1.) *. c) +. s)
+        , -2. *. a *. (a -. 1. +. ((a +. 1.) *. c))
+        , a *. (a +. 1. +. ((a -. 1.) *. c) -. s)
+        , a +. 1. -. ((a -. 1.) *. c) +. s
+        , 2. *. (a -. 1. -. ((a +. 1.) *. c))
+        , a +. 1. -. ((a -. 1.) *. c) -. s )
+    | LowPass {freq; q} ->
+        let alpha = alpha freq q and c = Float.cos (w0 freq) in
+        ( (1. -. c) /. 2.
+        , 1. -. c
+        , (1. -. c) /. 2.
+        , 1. +. alpha
+        , -2. *. c
+        , 1. -. alpha )
+    | HighPass {freq; q} ->
+        let alpha = alpha freq q and c = Float.cos (w0 freq) in
+        ( (1. +. c) /. 2.
+        , -.(1. +. c)
+        , (1. +. c) /. 2.
+        , 1. +. alpha
+        , -2. *. c
+        , 1. -. alpha )
+  in
+  [|b0 /. a0; b1 /. a0; b2 /. a0; a1 /. a0; a2 /. a0|]
+
+type bank = {table: (int * band, float array) Hashtbl.t; lock: Mutex.t}
+
+let bank () : bank = {table= Hashtbl.create 64; lock= Mutex.create ()}
+
+let coefficients ?bank ~(sample_rate : int) (band : band) : float array =
+  match bank with
+  | None ->
+      compute sample_rate band
+  | Some {table; lock} ->
+      Mutex.protect lock (fun () ->
+          match Hashtbl.find_opt table (sample_rate, band) with
+          | Some c ->
+              c
+          | None ->
+              let c = compute sample_rate band in
+              Hashtbl.replace table (sample_rate, band) c ;
+              c )
+
+type t =
+  { bank: bank option
+  ; sample_rate: int
+  ; channels: int
+  ; smoothing: int
+  ; settings: band array
+  ; coefs: float array (* current coefficients, 5 per band *)
+  ; targets: float array
+  ; steps: float array (* per-sample increments towards the targets *)
+  ; remaining: int array (* samples left before reaching the targets *)
+  ; state: float array (* 2 per band and channel *) }
+
+let create ?bank ?(smoothing : float = 0.02) ~(sample_rate : int)
+    ~(channels : int) (bands : band array) : t =
+  let nbands = Array.length bands in
+  let coefs = Array.make (5 * nbands) 0. in
+  Array.iteri
+    (fun b band ->
+      Array.blit (coefficients ?bank ~sample_rate band) 0 coefs (5 * b) 5 )
+    bands ;
+  { bank
+  ; sample_rate
+  ; channels
+  ; smoothing= max 1 (int_of_float (smoothing *. float_of_int sample_rate))
+  ; settings= Array.copy bands
+  ; coefs
+  ; targets= Array.copy coefs
+  ; steps= Array.make (5 * nbands) 0.
+  ; remaining= Array.make nbands 0
+  ; state= Array.make (2 * nbands * channels) 0. }
+
+let set_band (eq : t) (b : int) (band : band) : unit =
+  if b < 0 || b >= Array.length eq.settings then
+    raise (Invalid_argument "Effects.Equalizer.set_band: no such band") ;
+  eq.settings.(b) <- band ;
+  let target = coefficients ?bank:eq.bank ~sample_rate:eq.sample_rate band in
+  for k = 0 to 4 do
+    let j = (5 * b) + k in
+    eq.targets.(j) <- target.(k) ;
+    eq.steps.(j) <- (target.(k) -. eq.coefs.(j)) /. float_of_int eq.smoothing
+  done ;
+  eq.remaining.(b) <- eq.smoothing
+
+let bands (eq : t) : band array = Array.copy eq.settings
+
+let reset (eq : t) : unit = Array.fill eq.state 0 (Array.length eq.state) 0.
+
+(* filters the [n] samples of [buf] starting at [off] with the band [b], in
+   transposed direct form II *)
+let filter (eq : t) (b : int) (ch : int) buf (off : int) (n : int) : unit =
+  let j = 5 * b in
+  let b0 = ref eq.coefs.(j)
+  and b1 = ref eq.coefs.(j + 1)
+  and b2 = ref eq.coefs.(j + 2)
+  and a1 = ref eq.coefs.(j + 3)
+  and a2 = ref eq.coefs.(j + 4) in
+  let s = 2 * ((b * eq.channels) + ch) in
+  let z1 = ref eq.state.(s) and z2 = ref eq.state.(s + 1) in
+  let ramp = min n eq.remaining.(b) in
+  for i = 0 to n - 1 do
+    if i < ramp then (
+      b0 := !b0 +. eq.steps.(j) ;
+      b1 := !b1 +. eq.steps.(j + 1) ;
+      b2 := !b2 +. eq.steps.(j + 2) ;
+      a1 := !a1 +. eq.steps.(j + 3) ;
+      a2 := !a2 +. eq.steps.(j + 4) ) ;
+    let x = Bigarray.Array1.unsafe_get buf (off + i) in
+    let y = (!b0 *. x) +. !z1 in
+    z1 := (!b1 *. x) -. (!a1 *. y) +. !z2 ;
+    z2 := (!b2 *. x) -. (!a2 *. y) ;
+    Bigarray.Array1.unsafe_set buf (off + i) y
+  done ;
+  eq.state.(s) <- !z1 ;
+  eq.state.(s + 1) <- !z2
+
+let process (eq : t) (block : (float, Bigarray.float32_elt) Audio.G.t) : unit
+    =
+  let channels, n =
+    match Audio.G.shape block with
+    | [|channels; n|] ->
+        (channels, n)
+    | _ ->
+        raise
+          (Invalid_argument
+             "Effects.Equalizer.process: blocks must be planar matrices" )
+  in
+  if channels <> eq.channels then
+    raise (Invalid_argument "Effects.Equalizer.process: wrong channel count") ;
+  let buf = Bigarray.reshape_1 block (channels * n) in
+  for b = 0 to Array.length eq.settings - 1 do
+    for ch = 0 to channels - 1 do
+      filter eq b ch buf (ch * n) n
+    done ;
+    (* every channel went through the same ramp, which can now be committed *)
+    let ramp = min n eq.remaining.(b) in
+    if ramp > 0 then (
+      eq.remaining.(b) <- eq.remaining.(b) - ramp ;
+      for k = 5 * b to (5 * b) + 4 do
+        eq.coefs.(k) <-
+          ( if eq.remaining.(b) = 0 then eq.targets.(k)
+            else eq.coefs.(k) +. (float_of_int ramp *. eq.steps.(k)) )
+      done )
+  done
+
+let equalize ?bank (bands : band array) (a : Audio.audio) : Audio.audio =
+  let meta = Audio.meta a in
+  let eq =
+    create ?bank ~sample_rate:(Audio.Metadata.sample_rate meta)
+      ~channels:(Audio.Metadata.channels meta) bands
+  in
+  let p = Audio.planar a in
+  process eq p ; Audio.of_planar a p
@@ -0,0 +1,91 @@
+(*****************************************************************************)
+(*                                                                           *)
+(*                                                                           *)
+(*  Copyright (C) 2023                                                       *)
+(*    Gabriel Santamaria                                                     *)
+(*                                                                           *)
+(*                                                                           *)
+(*  Licensed under the Apache License, Version 2.0 (the "License");          *)
+(*  you may not use this file except in compliance with the License.         *)
+(*  You may obtain a copy of the License at                                  *)
+(*                                                                           *)
+(*    http://www.apache.org/licenses/LICENSE-2.0                             *)
+(*                                                                           *)
+(*  Unless required by applicable law or agreed to in writing, software      *)
+(*  distributed under the License is distributed on an "AS IS" BASIS,        *)
+(*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *)
+(*  See the License for the specific language governing permissions and      *)
+(*  limitations under the License.                                           *)
+(*                                                                           *)
+(*****************************************************************************)
+
+(**
+    The {!Effects.Equalizer} module implements a multi-band parametric
+    equalizer as a cascade of biquad filters, with the coefficients from
+    Robert Bristow-Johnson's Audio EQ Cookbook.
+
+    Coefficients can be cached in a {!bank} owned by the caller, so that
+    equalizers sharing the same settings don't recompute them. Changing the
+    settings of a band while processing moves its coefficients linearly
+    towards the new ones, which avoids clicks. *)
+
+(**
+    Settings of a band. Frequencies are expressed in Hz and gains in dB. *)
+type band =
+  | Peak of {freq: float; gain: float; q: float}
+  | LowShelf of {freq: float; gain: float; q: float}
+  | HighShelf of {freq: float; gain: float; q: float}
+  | LowPass of {freq: float; q: float}
+  | HighPass of {freq: float; q: float}
+
+type bank
+(**
+    Cache of coefficients, keyed by sample rate and band settings. A bank
+    grows with every distinct setting it sees and can be shared between
+    domains; it is freed with the last equalizer using it. *)
+
+val bank : unit -> bank
+(** [bank ()] creates a new empty bank *)
+
+val coefficients : ?bank:bank -> sample_rate:int -> band -> float array
+(**
+    [coefficients ?bank ~sample_rate band] returns the normalized biquad
+    coefficients [\[|b0; b1; b2; a1; a2|\]] of the band, looked up in and
+    added to [?bank] when given. *)
+
+type t
+
+val create :
+     ?bank:bank
+  -> ?smoothing:float
+  -> sample_rate:int
+  -> channels:int
+  -> band array
+  -> t
+(**
+    [create ?bank ?smoothing ~sample_rate ~channels bands] creates an
+    equalizer made of the given bands, taking its coefficients from [?bank]
+    when given. Changes of settings are spread over [?smoothing] seconds
+    (default [0.02]). *)
+
+val set_band : t -> int -> band -> unit
+(**
+    [set_band eq i band] changes the settings of the [i]-th band. *)
+
+val bands : t -> band array
+(**
+    [bands eq] returns the current settings of the bands *)
+
+val process : t -> (float, Bigarray.float32_elt) Audio.G.t -> unit
+(**
+    [process eq block] equalizes in place the planar block of shape
+    [\[|channels; frames|\]]. *)
+
+val reset : t -> unit
+(**
+    [reset eq] clears the state of the filters *)
+
+val equalize : ?bank:bank -> band array -> Audio.audio -> Audio.audio
+(**
+    [equalize ?bank bands audio] equalizes a whole audio element with the
+    given bands *)
@@ -0,0 +1,69 @@
+(*****************************************************************************)
+(*                                                                           *)
+(*                                                                           *)
+(*  Copyright (C) 2023                                                       *)
+(*    Gabriel Santamaria                                                     *)
+(*                                                                           *)
+(*                                                                           *)
+(*  Licensed under the Apache License, Version 2.0 (the "License");          *)
+(*  you may not use this file except in compliance with the License.         *)
+(*  You may obtain a copy of the License at                                  *)
+(*                                                                           *)
+(*    http://www.apache.org/licenses/LICENSE-2.0                             *)
+(*                                                                           *)
+(*  Unless required by applicable law or agreed to in writing, software      *)
+(*  distributed under the License is distributed on an "AS IS" BASIS,        *)
+(*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *)
+(*  See the License for the specific language governing permissions and      *)
+(*  limitations under the License.                                           *)
+(*                                                                           *)
+(*****************************************************************************)
+
+let pitch_class ?(tuning : float = 440.) (freq : float) : int =
+  let midi = 69. +. (12. *. Float.log2 (freq /. tuning)) in
+  let k = int_of_float (Float.round midi) mod 12 in
+  if k < 0 then k + 12 else k
+
+let chromagram ?(domains : int = Parallel.default_domains ())
+    ?(nfft : int = 4096) ?(hop : int = 2048) ?(fmin : float = 55.)
+    ?(fmax : float = 5000.) ?(tuning : float = 440.) (a : Audio.audio) :
+    (float, Bigarray.float32_elt) Audio.G.t =
+  if hop <= 0 then
+    raise (Invalid_argument "Feature.Chroma.chromagram: invalid hop") ;
+  if fmin <= 0. || fmin >= fmax then
+    raise (Invalid_argument "Feature.Chroma.chromagram: invalid range") ;
+  let sample_rate = Audio.Metadata.sample_rate (Audio.meta a) in
+  let bin_hz = float_of_int sample_rate /. float_of_int nfft in
+  (* pitch class of each bin, [-1] for the bins out of range *)
+  let classes =
+    Array.init
+      ((nfft / 2) + 1)
+      (fun k ->
+        let f = float_of_int k *. bin_hz in
+        if f < fmin || f > fmax then -1 else pitch_class ~tuning f )
+  in
+  let stft = Dsp.Stft.create nfft in
+  let x = Audio.View.of_data (Audio.mixdown a) in
+  let count = Dsp.Stft.frames stft ~hop (Audio.View.length x) in
+  let out = Audio.G.zeros Bigarray.Float32 [|12; count|] in
+  let buf = Bigarray.reshape_2 out 12 count in
+  Parallel.chunks ~domains ~chunk:64 count (fun start stop ->
+      let re = Array.make nfft 0. and im = Array.make nfft 0. in
+      let power = Array.make ((nfft / 2) + 1) 0. in
+      let chroma = Array.make 12 0. in
+      for k = start to stop - 1 do
+        Dsp.Stft.power stft ~re ~im
+          (fun i -> Audio.View.get x ((k * hop) + i))
+          power ;
+        Array.fill chroma 0 12 0. ;
+        Array.iteri
+          (fun j c ->
+            if c >= 0 then chroma.(c) <- chroma.(c) +. power.(j) )
+          classes ;
+        let top = Array.fold_left Float.max 0. chroma in
+        let scale = if top > 0. then 1. /. top else 0. in
+        for c = 0 to 11 do
+          Bigarray.Array2.unsafe_set buf c k (chroma.(c) *. scale)
+        done
+      done ) ;
+  out
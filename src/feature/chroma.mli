@@ -0,0 +1,50 @@
+(*****************************************************************************)
+(*                                                                           *)
+(*                                                                           *)
+(*  Copyright (C) 2023                                                       *)
+(*    Gabriel Santamaria                                                     *)
+(*                                                                           *)
+(*                                                                           *)
+(*  Licensed under the Apache License, Version 2.0 (the "License");          *)
+(*  you may not use this file except in compliance with the License.         *)
+(*  You may obtain a copy of the License at                                  *)
+(*                                                                           *)
+(*    http://www.apache.org/licenses/LICENSE-2.0                             *)
+(*                                                                           *)
+(*  Unless required by applicable law or agreed to in writing, software      *)
+(*  distributed under the License is distributed on an "AS IS" BASIS,        *)
+(*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *)
+(*  See the License for the specific language governing permissions and      *)
+(*  limitations under the License.                                           *)
+(*                                                                           *)
+(*****************************************************************************)
+
+(**
+    The {!Feature.Chroma} module computes chromagrams, where the power
+    spectrum of each frame is folded onto the twelve pitch classes of the
+    equal-tempered scale, [C] being the class [0]. *)
+
+val pitch_class : ?tuning:float -> float -> int
+(**
+    [pitch_class ?tuning freq] returns the pitch class nearest to [freq] Hz,
+    the [A] above middle [C] being tuned at [?tuning] Hz (default is
+    [440.]). *)
+
+val chromagram :
+     ?domains:int
+  -> ?nfft:int
+  -> ?hop:int
+  -> ?fmin:float
+  -> ?fmax:float
+  -> ?tuning:float
+  -> Audio.audio
+  -> (float, Bigarray.float32_elt) Audio.G.t
+(**
+    [chromagram ?domains ?nfft ?hop ?fmin ?fmax ?tuning audio] computes the
+    chromagram of the mixdown of [audio], as a matrix of shape
+    [\[|12; frames|\]]. Frames are [?nfft] samples long (default is [4096]),
+    Hann windowed and taken every [?hop] samples (default is [2048]). Only
+    the bins between [?fmin] (default is [55.]) and [?fmax] Hz (default is
+    [5000.]) are folded, and each frame is scaled so that its largest class
+    is [1]. Frames are computed in parallel over at most [?domains]
+    domains. *)
@@ -0,0 +1,161 @@
+(*****************************************************************************)
+(*                                                                           *)
+(*                                                                           *)
+(*  Copyright (C) 2023                                                       *)
+(*    Gabriel Santamaria                                                     *)
+(*                                                                           *)
+(*                                                                           *)
+(*  Licensed under the Apache License, Version 2.0 (the "License");          *)
+(*  you may not use this file except in compliance with the License.         *)
+(*  You may obtain a copy of the License at                                  *)
+(*                                                                           *)
+(*    http://www.apache.org/licenses/LICENSE-2.0                             *)
+(*                                                                           *)
+(*  Unless required by applicable law or agreed to in writing, software      *)
+(*  distributed under the License is distributed on an "AS IS" BASIS,        *)
+(*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *)
+(*  See the License for the specific language governing permissions and      *)
+(*  limitations under the License.                                           *)
+(*                                                                           *)
+(*****************************************************************************)
+
+let erb (f : float) : float = 24.7 *. ((4.37 *. f /. 1000.) +. 1.)
+
+let center_frequencies ?(fmin : float = 50.) ?(fmax : float = 8000.)
+    ~(sample_rate : int) (n : int) : float array =
+  let fmax = Float.min fmax (0.45 *. float_of_int sample_rate) in
+  if n <= 0 || fmin <= 0. || fmin >= fmax then
+    raise (Invalid_argument "Feature.Gammatone: invalid frequency range") ;
+  let rate f = 21.4 *. Float.log10 (1. +. (0.00437 *. f)) in
+  let inv e = (Float.pow 10. (e /. 21.4) -. 1.) /. 0.00437 in
+  let lo = rate fmin and hi = rate fmax in
+  Array.init n (fun i ->
+      if n = 1 then fmin
+      else inv (lo +. ((hi -. lo) *. float_of_int i /. float_of_int (n - 1))) )
+
+(* filters [x] with the gammatone centered on [fc], calling [f i y] with each
+   output sample *)
+let run ~(sample_rate : int) (fc : float) (x : Audio.View.t)
+    (f : int -> float -> unit) : unit =
+  let fs = float_of_int sample_rate in
+  let a = Float.exp (-2. *. Float.pi *. 1.019 *. erb fc /. fs) in
+  let g = 1. -. a in
+  let w = 2. *. Float.pi *. fc /. fs in
+  let cr = Float.cos w and ci = -.Float.sin w in
+  let pr = ref 1. and pi = ref 0. in
+  let r1 = ref 0. and i1 = ref 0. and r2 = ref 0. and i2 = ref 0. in
+  let r3 = ref 0. and i3 = ref 0. and r4 = ref 0. and i4 = ref 0. in
+  let buf = Audio.View.buffer x in
+  let off = Audio.View.offset x and stride = Audio.View.stride x in
+  for n = 0 to Audio.View.length x - 1 do
+    let v = Bigarray.Array1.unsafe_get buf (off + (n * stride)) in
+    r1 := (g *. v *. !pr) +. (a *. !r1) ;
+    i1 := (g *. v *. !pi) +. (a *. !i1) ;
+    r2 := (g *. !r1) +. (a *. !r2) ;
+    i2 := (g *. !i1) +. (a *. !i2) ;
+    r3 := (g *. !r2) +. (a *. !r3) ;
+    i3 := (g *. !i2) +. (a *. !i3) ;
+    r4 := (g *. !r3) +. (a *. !r4) ;
+    i4 := (g *. !i3) +. (a *. !i4) ;
+    f n (2. *. ((!r4 *. !pr) +. (!i4 *. !pi))) ;
+    let r = (!pr *. cr) -. (!pi *. ci) in
+    pi := (!pr *. ci) +. (!pi *. cr) ;
+    pr := r ;
+    (* keeps the phasor on the unit circle despite rounding errors *)
+    if n land 1023 = 1023 then (
+      let m = Float.sqrt ((!pr *. !pr) +. (!pi *. !pi)) in
+      pr := !pr /. m ;
+      pi := !pi /. m )
+  done
+
+let filterbank ?(domains : int = Parallel.default_domains ()) ?fmin ?fmax
+    ?(bands : int = 64) (a : Audio.audio) :
+    (float, Bigarray.float32_elt) Audio.G.t =
+  let sample_rate = Audio.Metadata.sample_rate (Audio.meta a) in
+  let fcs = center_frequencies ?fmin ?fmax ~sample_rate bands in
+  let x = Audio.View.of_data (Audio.mixdown a) in
+  let n = Audio.View.length x in
+  let out = Audio.G.zeros Bigarray.Float32 [|bands; n|] in
+  let buf = Bigarray.reshape_1 out (bands * n) in
+  Parallel.parallel_for ~domains bands (fun b ->
+      run ~sample_rate fcs.(b) x (fun i y ->
+          Bigarray.Array1.unsafe_set buf ((b * n) + i) y ) ) ;
+  out
+
+let cochleagram ?(domains : int = Parallel.default_domains ()) ?fmin ?fmax
+    ?(bands : int = 64) ?frame ?hop (a : Audio.audio) :
+    (float, Bigarray.float32_elt) Audio.G.t =
+  let sample_rate = Audio.Metadata.sample_rate (Audio.meta a) in
+  let frame = Option.value ~default:(sample_rate * 25 / 1000) frame in
+  let hop = Option.value ~default:(sample_rate / 100) hop in
+  if frame <= 0 || hop <= 0 then
+    raise (Invalid_argument "Feature.Gammatone.cochleagram: invalid framing") ;
+  let fcs = center_frequencies ?fmin ?fmax ~sample_rate bands in
+  let x = Audio.View.of_data (Audio.mixdown a) in
+  let n = Audio.View.length x in
+  let count = if n < frame then 0 else ((n - frame) / hop) + 1 in
+  let out = Audio.G.zeros Bigarray.Float32 [|bands; count|] in
+  let buf = Bigarray.reshape_1 out (bands * count) in
+  Parallel.parallel_for ~domains bands (fun b ->
+      (* running sums of the squared output, from which every frame is
+         integrated in constant time *)
+      let sums = Array.make (n + 1) 0. in
+      run ~sample_rate fcs.(b) x (fun i y ->
+          sums.(i + 1) <- sums.(i) +. (y *. y) ) ;
+      for k = 0 to count - 1 do
+        let start = k * hop in
+        Bigarray.Array1.unsafe_set buf
+          ((b * count) + k)
+          ((sums.(start + frame) -. sums.(start)) /. float_of_int frame)
+      done ) ;
+  out
+
+let cochleagram_fft ?(domains : int = Parallel.default_domains ()) ?fmin
+    ?fmax ?(bands : int = 64) ?(nfft : int = 512) ?hop (a : Audio.audio) :
+    (float, Bigarray.float32_elt) Audio.G.t =
+  let sample_rate = Audio.Metadata.sample_rate (Audio.meta a) in
+  let hop = Option.value ~default:(sample_rate / 100) hop in
+  if hop <= 0 then
+    raise (Invalid_argument "Feature.Gammatone.cochleagram_fft: invalid hop") ;
+  let fcs = center_frequencies ?fmin ?fmax ~sample_rate bands in
+  let half = nfft / 2 in
+  let stft = Dsp.Stft.create nfft in
+  (* energy of a frame from its one-sided power spectrum *)
+  let scale =
+    let energy =
+      Array.fold_left (fun s w -> s +. (w *. w)) 0. (Dsp.Stft.window stft)
+    in
+    2. /. (float_of_int nfft *. energy)
+  in
+  (* squared magnitude responses of the filters, sampled on the bins *)
+  let weights =
+    Array.map
+      (fun fc ->
+        let b = 1.019 *. erb fc in
+        Array.init (half + 1) (fun k ->
+            let f = float_of_int (k * sample_rate) /. float_of_int nfft in
+            let d = (f -. fc) /. b in
+            scale /. Float.pow (1. +. (d *. d)) 4. ) )
+      fcs
+  in
+  let x = Audio.View.of_data (Audio.mixdown a) in
+  let count = Dsp.Stft.frames stft ~hop (Audio.View.length x) in
+  let out = Audio.G.zeros Bigarray.Float32 [|bands; count|] in
+  let buf = Bigarray.reshape_1 out (bands * count) in
+  Parallel.chunks ~domains ~chunk:64 count (fun start stop ->
+      let re = Array.make nfft 0. and im = Array.make nfft 0. in
+      let power = Array.make (half + 1) 0. in
+      for k = start to stop - 1 do
+        Dsp.Stft.power stft ~re ~im
+          (fun i -> Audio.View.get x ((k * hop) + i))
+          power ;
+        Array.iteri
+          (fun b w ->
+            let e = ref 0. in
+            for j = 0 to half do
+              e := !e +. (w.(j) *. power.(j))
+            done ;
+            Bigarray.Array1.unsafe_set buf ((b * count) + k) !e )
+          weights
+      done ) ;
+  out
@@ -0,0 +1,88 @@
+(*****************************************************************************)
+(*                                                                           *)
+(*                                                                           *)
+(*  Copyright (C) 2023                                                       *)
+(*    Gabriel Santamaria                                                     *)
+(*                                                                           *)
+(*                                                                           *)
+(*  Licensed under the Apache License, Version 2.0 (the "License");          *)
+(*  you may not use this file except in compliance with the License.         *)
+(*  You may obtain a copy of the License at                                  *)
+(*                                                                           *)
+(*    http://www.apache.org/licenses/LICENSE-2.0                             *)
+(*                                                                           *)
+(*  Unless required by applicable law or agreed to in writing, software      *)
+(*  distributed under the License is distributed on an "AS IS" BASIS,        *)
+(*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *)
+(*  See the License for the specific language governing permissions and      *)
+(*  limitations under the License.                                           *)
+(*                                                                           *)
+(*****************************************************************************)
+
+(**
+    The {!Feature.Gammatone} module implements a fourth-order gammatone
+    filterbank, a common model of the frequency analysis performed by the
+    cochlea. Center frequencies are evenly spaced on the ERB-rate scale.
+
+    Each filter is computed recursively: the signal is shifted down by the
+    center frequency with a rotating phasor, smoothed by four cascaded
+    one-pole lowpass filters and shifted back up. This costs a handful of
+    multiplications per sample and filter, whatever the bandwidth. *)
+
+val erb : float -> float
+(**
+    [erb f] returns the equivalent rectangular bandwidth, in Hz, of the
+    auditory filter centered on [f] Hz (Glasberg and Moore). *)
+
+val center_frequencies :
+  ?fmin:float -> ?fmax:float -> sample_rate:int -> int -> float array
+(**
+    [center_frequencies ?fmin ?fmax ~sample_rate n] returns [n] frequencies
+    evenly spaced on the ERB-rate scale between [?fmin] (default is [50.])
+    and [?fmax] (default is [8000.], capped at 90% of the Nyquist
+    frequency). *)
+
+val filterbank :
+     ?domains:int
+  -> ?fmin:float
+  -> ?fmax:float
+  -> ?bands:int
+  -> Audio.audio
+  -> (float, Bigarray.float32_elt) Audio.G.t
+(**
+    [filterbank ?domains ?fmin ?fmax ?bands audio] filters the mixdown of
+    [audio] with [?bands] gammatone filters (default is [64]) and returns
+    their outputs as a matrix of shape [\[|bands; frames|\]]. Filters are
+    computed in parallel over at most [?domains] domains. *)
+
+val cochleagram :
+     ?domains:int
+  -> ?fmin:float
+  -> ?fmax:float
+  -> ?bands:int
+  -> ?frame:int
+  -> ?hop:int
+  -> Audio.audio
+  -> (float, Bigarray.float32_elt) Audio.G.t
+(**
+    [cochleagram ?domains ?fmin ?fmax ?bands ?frame ?hop audio] returns the
+    mean energy of the output of each filter over frames of [?frame] samples
+    (default is 25 ms) taken every [?hop] samples (default is 10 ms), as a
+    matrix of shape [\[|bands; count|\]]. The filter outputs are integrated
+    on the fly and never stored. *)
+
+val cochleagram_fft :
+     ?domains:int
+  -> ?fmin:float
+  -> ?fmax:float
+  -> ?bands:int
+  -> ?nfft:int
+  -> ?hop:int
+  -> Audio.audio
+  -> (float, Bigarray.float32_elt) Audio.G.t
+(**
+    [cochleagram_fft ?domains ?fmin ?fmax ?bands ?nfft ?hop audio]
+    approximates {!cochleagram} by weighting the power spectra of frames of
+    [?nfft] samples (default is [512]) with the magnitude responses of the
+    filters. It is much faster with many bands, at the cost of the frequency
+    resolution of the STFT at low frequencies. *)
@@ -0,0 +1,124 @@
+(*****************************************************************************)
+(*                                                                           *)
+(*                                                                           *)
+(*  Copyright (C) 2023                                                       *)
+(*    Gabriel Santamaria                                                     *)
+(*                                                                           *)
+(*                                                                           *)
+(*  Licensed under the Apache License, Version 2.0 (the "License");          *)
+(*  you may not use this file except in compliance with the License.         *)
+(*  You may obtain a copy of the License at                                  *)
+(*                                                                           *)
+(*    http://www.apache.org/licenses/LICENSE-2.0                             *)
+(*                                                                           *)
+(*  Unless required by applicable law or agreed to in writing, software      *)
+(*  distributed under the License is distributed on an "AS IS" BASIS,        *)
+(*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *)
+(*  See the License for the specific language governing permissions and      *)
+(*  limitations under the License.                                           *)
+(*                                                                           *)
+(*****************************************************************************)
+
+let hz_to_mel (f : float) : float = 2595. *. Float.log10 (1. +. (f /. 700.))
+
+let mel_to_hz (m : float) : float = 700. *. (Float.pow 10. (m /. 2595.) -. 1.)
+
+(* each filter is stored as its first bin and its weights *)
+type filterbank = {first: int array; weights: float array array}
+
+let filterbank ?(fmin : float = 0.) ?fmax ~(sample_rate : int) ~(nfft : int)
+    (bands : int) : filterbank =
+  let nyquist = float_of_int sample_rate /. 2. in
+  let fmax = Option.value ~default:nyquist fmax in
+  if bands <= 0 || fmin < 0. || fmin >= fmax || fmax > nyquist then
+    raise (Invalid_argument "Feature.Mel.filterbank: invalid bands") ;
+  let lo = hz_to_mel fmin and hi = hz_to_mel fmax in
+  (* band edges in Hz, filter [b] spanning [edges.(b); edges.(b + 2)] *)
+  let edges =
+    Array.init (bands + 2) (fun i ->
+        let r = float_of_int i /. float_of_int (bands + 1) in
+        mel_to_hz (lo +. ((hi -. lo) *. r)) )
+  in
+  let bin_hz = float_of_int sample_rate /. float_of_int nfft in
+  let bins = (nfft / 2) + 1 in
+  let filter b =
+    let left = edges.(b) and center = edges.(b + 1) in
+    let right = edges.(b + 2) in
+    let norm = 2. /. (right -. left) in
+    let first = max 0 (int_of_float (Float.ceil (left /. bin_hz))) in
+    let last = min (bins - 1) (int_of_float (Float.floor (right /. bin_hz))) in
+    let w =
+      Array.init
+        (max 0 (last - first + 1))
+        (fun i ->
+          let f = float_of_int (first + i) *. bin_hz in
+          let up = (f -. left) /. (center -. left)
+          and down = (right -. f) /. (right -. center) in
+          norm *. Float.max 0. (Float.min up down) )
+    in
+    (first, w)
+  in
+  let filters = Array.init bands filter in
+  {first= Array.map fst filters; weights= Array.map snd filters}
+
+let bands (fb : filterbank) : int = Array.length fb.first
+
+let apply (fb : filterbank) (power : float array) (mel : float array) : unit =
+  Array.iteri
+    (fun b w ->
+      let first = fb.first.(b) in
+      let e = ref 0. in
+      for i = 0 to Array.length w - 1 do
+        e := !e +. (w.(i) *. Array.unsafe_get power (first + i))
+      done ;
+      mel.(b) <- !e )
+    fb.weights
+
+let spectrogram ?(domains : int = Parallel.default_domains ())
+    ?(nfft : int = 2048) ?(hop : int = 512) ?(bands : int = 128) ?fmin ?fmax
+    (a : Audio.audio) : (float, Bigarray.float32_elt) Audio.G.t =
+  if hop <= 0 then
+    raise (Invalid_argument "Feature.Mel.spectrogram: invalid hop") ;
+  let sample_rate = Audio.Metadata.sample_rate (Audio.meta a) in
+  let fb = filterbank ?fmin ?fmax ~sample_rate ~nfft bands in
+  let stft = Dsp.Stft.create nfft in
+  let x = Audio.View.of_data (Audio.mixdown a) in
+  let count = Dsp.Stft.frames stft ~hop (Audio.View.length x) in
+  let out = Audio.G.zeros Bigarray.Float32 [|bands; count|] in
+  let buf = Bigarray.reshape_2 out bands count in
+  Parallel.chunks ~domains ~chunk:64 count (fun start stop ->
+      let re = Array.make nfft 0. and im = Array.make nfft 0. in
+      let power = Array.make ((nfft / 2) + 1) 0. in
+      let mel = Array.make bands 0. in
+      for k = start to stop - 1 do
+        Dsp.Stft.power stft ~re ~im
+          (fun i -> Audio.View.get x ((k * hop) + i))
+          power ;
+        apply fb power mel ;
+        for b = 0 to bands - 1 do
+          Bigarray.Array2.unsafe_set buf b k mel.(b)
+        done
+      done ) ;
+  out
+
+let mfcc ?(coefficients : int = 13) ?(floor : float = 1e-10)
+    (mel : (float, Bigarray.float32_elt) Audio.G.t) :
+    (float, Bigarray.float32_elt) Audio.G.t =
+  let bands =
+    match Audio.G.shape mel with
+    | [|bands; _|] ->
+        bands
+    | _ ->
+        raise (Invalid_argument "Feature.Mel.mfcc: expected a matrix")
+  in
+  if coefficients <= 0 || coefficients > bands then
+    raise (Invalid_argument "Feature.Mel.mfcc: invalid coefficients") ;
+  let b = float_of_int bands in
+  let basis =
+    Audio.G.init_nd Bigarray.Float32 [|coefficients; bands|] (fun idx ->
+        let k = float_of_int idx.(0) and j = float_of_int idx.(1) in
+        let scale = if idx.(0) = 0 then sqrt (1. /. b) else sqrt (2. /. b) in
+        scale *. Float.cos (Float.pi *. k *. (j +. 0.5) /. b) )
+  in
+  let logmel = Audio.G.map (fun v -> Float.log (Float.max v floor)) mel in
+  Audio.G.dot basis logmel
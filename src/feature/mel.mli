@@ -0,0 +1,83 @@
+(*****************************************************************************)
+(*                                                                           *)
+(*                                                                           *)
+(*  Copyright (C) 2023                                                       *)
+(*    Gabriel Santamaria                                                     *)
+(*                                                                           *)
+(*                                                                           *)
+(*  Licensed under the Apache License, Version 2.0 (the "License");          *)
+(*  you may not use this file except in compliance with the License.         *)
+(*  You may obtain a copy of the License at                                  *)
+(*                                                                           *)
+(*    http://www.apache.org/licenses/LICENSE-2.0                             *)
+(*                                                                           *)
+(*  Unless required by applicable law or agreed to in writing, software      *)
+(*  distributed under the License is distributed on an "AS IS" BASIS,        *)
+(*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *)
+(*  See the License for the specific language governing permissions and      *)
+(*  limitations under the License.                                           *)
+(*                                                                           *)
+(*****************************************************************************)
+
+(**
+    The {!Feature.Mel} module computes mel-scaled spectrograms, where the
+    power spectrum of each frame is summed into triangular bands evenly
+    spaced on the mel scale (HTK formula). *)
+
+val hz_to_mel : float -> float
+
+val mel_to_hz : float -> float
+
+type filterbank
+(**
+    Triangular filters mapping the bins of a power spectrum to mel bands *)
+
+val filterbank :
+     ?fmin:float
+  -> ?fmax:float
+  -> sample_rate:int
+  -> nfft:int
+  -> int
+  -> filterbank
+(**
+    [filterbank ?fmin ?fmax ~sample_rate ~nfft bands] creates [bands]
+    triangular filters between [?fmin] (default is [0.]) and [?fmax] Hz
+    (default is the Nyquist frequency), for spectra of [nfft / 2 + 1] bins.
+    Filters are area normalized. *)
+
+val bands : filterbank -> int
+
+val apply : filterbank -> float array -> float array -> unit
+(**
+    [apply fb power mel] fills [mel] with the band energies of the one-sided
+    power spectrum [power] *)
+
+val spectrogram :
+     ?domains:int
+  -> ?nfft:int
+  -> ?hop:int
+  -> ?bands:int
+  -> ?fmin:float
+  -> ?fmax:float
+  -> Audio.audio
+  -> (float, Bigarray.float32_elt) Audio.G.t
+(**
+    [spectrogram ?domains ?nfft ?hop ?bands ?fmin ?fmax audio] computes the
+    mel power spectrogram of the mixdown of [audio], as a matrix of shape
+    [\[|bands; frames|\]]. Frames are [?nfft] samples long (default is
+    [2048]), Hann windowed and taken every [?hop] samples (default is
+    [512]); there are [?bands] bands (default is [128]). Frames are computed
+    in parallel over at most [?domains] domains. *)
+
+val mfcc :
+     ?coefficients:int
+  -> ?floor:float
+  -> (float, Bigarray.float32_elt) Audio.G.t
+  -> (float, Bigarray.float32_elt) Audio.G.t
+(**
+    [mfcc ?coefficients ?floor mel] computes the mel-frequency cepstral
+    coefficients of the mel power spectrogram [mel] of shape
+    [\[|bands; frames|\]], as the orthonormal DCT-II of the natural logarithm
+    of the band energies, floored at [?floor] (default is [1e-10]). The
+    result has shape [\[|coefficients; frames|\]], with [?coefficients]
+    defaulting to [13]. *)
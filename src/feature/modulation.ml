@@ -0,0 +1,127 @@
+(*****************************************************************************)
+(*                                                                           *)
+(*                                                                           *)
+(*  Copyright (C) 2023                                                       *)
+(*    Gabriel Santamaria                                                     *)
+(*                                                                           *)
+(*                                                                           *)
+(*  Licensed under the Apache License, Version 2.0 (the "License");          *)
+(*  you may not use this file except in compliance with the License.         *)
+(*  You may obtain a copy of the License at                                  *)
+(*                                                                           *)
+(*    http://www.apache.org/licenses/LICENSE-2.0                             *)
+(*                                                                           *)
+(*  Unless required by applicable law or agreed to in writing, software      *)
+(*  distributed under the License is distributed on an "AS IS" BASIS,        *)
+(*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *)
+(*  See the License for the specific language governing permissions and      *)
+(*  limitations under the License.                                           *)
+(*                                                                           *)
+(*****************************************************************************)
+
+let frequencies ~(frame_rate : float) ~(length : int) : float array =
+  Array.init ((length / 2) + 1) (fun k ->
+      float_of_int k *. frame_rate /. float_of_int length )
+
+(* shape of the envelopes and number of windows *)
+let layout (fname : string) (env : (float, Bigarray.float32_elt) Audio.G.t)
+    (length : int) (hop : int) : int * int * int =
+  if length <= 0 || length land (length - 1) <> 0 then
+    raise (Invalid_argument (fname ^ ": length must be a power of two")) ;
+  if hop <= 0 then raise (Invalid_argument (fname ^ ": invalid hop")) ;
+  match Audio.G.shape env with
+  | [|bands; frames|] ->
+      let windows =
+        if frames < length then 0 else ((frames - length) / hop) + 1
+      in
+      (bands, frames, windows)
+  | _ ->
+      raise (Invalid_argument (fname ^ ": envelopes must be a matrix"))
+
+(* calls [f band window bin magnitude] for every value of the modulation
+   spectrogram *)
+let transform ~domains ~length ~hop ~bands ~frames ~windows
+    (env : (float, Bigarray.float32_elt) Audio.G.t)
+    (f : int -> int -> int -> float -> unit) : unit =
+  let src = Bigarray.reshape_2 env bands frames in
+  let plan = Dsp.Fft.plan length in
+  let window = Dsp.Stft.hann length in
+  let half = length / 2 in
+  (* [fill b w dst] copies the windowed, zero-mean window [w] of band [b] *)
+  let fill b w (dst : float array) =
+    let start = w * hop in
+    let mean = ref 0. in
+    for i = 0 to length - 1 do
+      mean := !mean +. Bigarray.Array2.unsafe_get src b (start + i)
+    done ;
+    let mean = !mean /. float_of_int length in
+    for i = 0 to length - 1 do
+      dst.(i) <-
+        (Bigarray.Array2.unsafe_get src b (start + i) -. mean) *. window.(i)
+    done
+  in
+  Parallel.parallel_for ~domains
+    ((bands + 1) / 2)
+    (fun p ->
+      let b0 = 2 * p and b1 = (2 * p) + 1 in
+      let re = Array.make length 0. and im = Array.make length 0. in
+      for w = 0 to windows - 1 do
+        fill b0 w re ;
+        if b1 < bands then fill b1 w im else Array.fill im 0 length 0. ;
+        Dsp.Fft.forward plan re im ;
+        (* Z = X + iY for real X and Y, so X_k = (Z_k + conj Z_(n-k)) / 2 and
+           Y_k = (Z_k - conj Z_(n-k)) / 2i *)
+        for k = 0 to half do
+          let j = (length - k) land (length - 1) in
+          let zr = re.(k) and zi = im.(k) and cr = re.(j) and ci = -.im.(j) in
+          let xr = 0.5 *. (zr +. cr) and xi = 0.5 *. (zi +. ci) in
+          f b0 w k (Float.sqrt ((xr *. xr) +. (xi *. xi))) ;
+          if b1 < bands then
+            let yr = 0.5 *. (zi -. ci) and yi = -0.5 *. (zr -. cr) in
+            f b1 w k (Float.sqrt ((yr *. yr) +. (yi *. yi)))
+        done
+      done )
+
+let spectrogram ?(domains : int = Parallel.default_domains ())
+    ?(length : int = 256) ?hop (env : (float, Bigarray.float32_elt) Audio.G.t)
+    : (float, Bigarray.float32_elt) Audio.G.t =
+  let hop = Option.value ~default:(max 1 (length / 2)) hop in
+  let bands, frames, windows =
+    layout "Feature.Modulation.spectrogram" env length hop
+  in
+  let bins = (length / 2) + 1 in
+  let out = Audio.G.zeros Bigarray.Float32 [|bands; bins; windows|] in
+  let dst = Bigarray.reshape_1 out (bands * bins * windows) in
+  transform ~domains ~length ~hop ~bands ~frames ~windows env (fun b w k m ->
+      Bigarray.Array1.unsafe_set dst ((((b * bins) + k) * windows) + w) m ) ;
+  out
+
+let spectrum ?(domains : int = Parallel.default_domains ())
+    ?(length : int = 256) ?hop (env : (float, Bigarray.float32_elt) Audio.G.t)
+    : (float, Bigarray.float32_elt) Audio.G.t =
+  let hop = Option.value ~default:(max 1 (length / 2)) hop in
+  let bands, frames, windows =
+    layout "Feature.Modulation.spectrum" env length hop
+  in
+  let bins = (length / 2) + 1 in
+  (* each band is only written by the domain handling its pair *)
+  let acc = Array.make (bands * bins) 0. in
+  transform ~domains ~length ~hop ~bands ~frames ~windows env (fun b _ k m ->
+      acc.((b * bins) + k) <- acc.((b * bins) + k) +. m ) ;
+  let scale = if windows = 0 then 0. else 1. /. float_of_int windows in
+  let out = Audio.G.zeros Bigarray.Float32 [|bands; bins|] in
+  let dst = Bigarray.reshape_1 out (bands * bins) in
+  Array.iteri (fun i v -> Bigarray.Array1.unsafe_set dst i (v *. scale)) acc ;
+  out
+
+let of_audio ?(domains : int = Parallel.default_domains ()) ?nfft ?hop
+    ?(bands : int = 32) ?(length : int = 256) (a : Audio.audio) :
+    (float, Bigarray.float32_elt) Audio.G.t * float array =
+  let sample_rate = Audio.Metadata.sample_rate (Audio.meta a) in
+  let hop = Option.value ~default:(sample_rate / 100) hop in
+  let mel = Mel.spectrogram ~domains ?nfft ~hop ~bands a in
+  let env = Audio.G.sqrt mel in
+  ( spectrum ~domains ~length env
+  , frequencies
+      ~frame_rate:(float_of_int sample_rate /. float_of_int hop)
+      ~length )
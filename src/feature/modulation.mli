@@ -0,0 +1,77 @@
+(*****************************************************************************)
+(*                                                                           *)
+(*                                                                           *)
+(*  Copyright (C) 2023                                                       *)
+(*    Gabriel Santamaria                                                     *)
+(*                                                                           *)
+(*                                                                           *)
+(*  Licensed under the Apache License, Version 2.0 (the "License");          *)
+(*  you may not use this file except in compliance with the License.         *)
+(*  You may obtain a copy of the License at                                  *)
+(*                                                                           *)
+(*    http://www.apache.org/licenses/LICENSE-2.0                             *)
+(*                                                                           *)
+(*  Unless required by applicable law or agreed to in writing, software      *)
+(*  distributed under the License is distributed on an "AS IS" BASIS,        *)
+(*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *)
+(*  See the License for the specific language governing permissions and      *)
+(*  limitations under the License.                                           *)
+(*                                                                           *)
+(*****************************************************************************)
+
+(**
+    The {!Feature.Modulation} module computes modulation spectra: the spectra
+    of the temporal envelopes of frequency bands. They describe how fast the
+    energy of each band fluctuates, such as the syllabic rate of speech.
+
+    The first stage is a band decomposition over time, such as a mel
+    spectrogram or a cochleagram, given as a matrix of shape
+    [\[|bands; frames|\]]. The second stage computes the FFTs of windows of
+    each envelope. These FFTs all share the same cached plan, and two real
+    envelopes are transformed at once as the real and imaginary parts of a
+    single complex FFT. Pairs of bands are processed in parallel. *)
+
+val frequencies : frame_rate:float -> length:int -> float array
+(**
+    [frequencies ~frame_rate ~length] returns the modulation frequencies, in
+    Hz, of the [length / 2 + 1] bins of windows of [length] envelope frames
+    sampled at [frame_rate] Hz. *)
+
+val spectrogram :
+     ?domains:int
+  -> ?length:int
+  -> ?hop:int
+  -> (float, Bigarray.float32_elt) Audio.G.t
+  -> (float, Bigarray.float32_elt) Audio.G.t
+(**
+    [spectrogram ?domains ?length ?hop env] returns the modulation
+    spectrogram of the envelopes [env], as an array of shape
+    [\[|bands; length / 2 + 1; windows|\]] of magnitudes. Windows of [?length]
+    frames (default is [256], must be a power of two) are taken every [?hop]
+    frames (default is [length / 2]); their mean is removed and they are Hann
+    windowed before the FFT. *)
+
+val spectrum :
+     ?domains:int
+  -> ?length:int
+  -> ?hop:int
+  -> (float, Bigarray.float32_elt) Audio.G.t
+  -> (float, Bigarray.float32_elt) Audio.G.t
+(**
+    [spectrum ?domains ?length ?hop env] returns the modulation spectrum of
+    the envelopes [env], the average of the modulation spectrogram over
+    windows, as a matrix of shape [\[|bands; length / 2 + 1|\]]. *)
+
+val of_audio :
+     ?domains:int
+  -> ?nfft:int
+  -> ?hop:int
+  -> ?bands:int
+  -> ?length:int
+  -> Audio.audio
+  -> (float, Bigarray.float32_elt) Audio.G.t * float array
+(**
+    [of_audio ?domains ?nfft ?hop ?bands ?length audio] computes the
+    modulation spectrum of the mel band magnitudes of [audio] (see
+    {!Feature.Mel.spectrogram}, [?hop] defaults to 10 ms here) and returns it
+    along with its modulation frequencies. *)
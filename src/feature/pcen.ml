@@ -0,0 +1,85 @@
+(*****************************************************************************)
+(*                                                                           *)
+(*                                                                           *)
+(*  Copyright (C) 2023                                                       *)
+(*    Gabriel Santamaria                                                     *)
+(*                                                                           *)
+(*                                                                           *)
+(*  Licensed under the Apache License, Version 2.0 (the "License");          *)
+(*  you may not use this file except in compliance with the License.         *)
+(*  You may obtain a copy of the License at                                  *)
+(*                                                                           *)
+(*    http://www.apache.org/licenses/LICENSE-2.0                             *)
+(*                                                                           *)
+(*  Unless required by applicable law or agreed to in writing, software      *)
+(*  distributed under the License is distributed on an "AS IS" BASIS,        *)
+(*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *)
+(*  See the License for the specific language governing permissions and      *)
+(*  limitations under the License.                                           *)
+(*                                                                           *)
+(*****************************************************************************)
+
+type params = {s: float; alpha: float; delta: float; r: float; eps: float}
+
+let default = {s= 0.025; alpha= 0.98; delta= 2.; r= 0.5; eps= 1e-6}
+
+(* smoothing and normalization of one value [e] given the previous smoothed
+   value [m], returning the new smoothed value and storing the output with
+   [out]. Both modes go through this function. *)
+let[@inline] step (p : params) (offset : float) (m : float) (e : float)
+    (out : float -> unit) : float =
+  let m = ((1. -. p.s) *. m) +. (p.s *. e) in
+  let gain = Float.pow (p.eps +. m) p.alpha in
+  out (Float.pow ((e /. gain) +. p.delta) p.r -. offset) ;
+  m
+
+type t =
+  { params: params
+  ; offset: float (* delta ^ r *)
+  ; smooth: float array
+  ; mutable started: bool }
+
+let create ?(params : params = default) (bands : int) : t =
+  { params
+  ; offset= Float.pow params.delta params.r
+  ; smooth= Array.make bands 0.
+  ; started= false }
+
+let process (p : t) (frame : float array) : unit =
+  if Array.length frame <> Array.length p.smooth then
+    raise (Invalid_argument "Feature.Pcen.process: wrong number of bands") ;
+  if not p.started then (
+    Array.blit frame 0 p.smooth 0 (Array.length frame) ;
+    p.started <- true ) ;
+  for b = 0 to Array.length frame - 1 do
+    p.smooth.(b) <-
+      step p.params p.offset p.smooth.(b) frame.(b) (fun y -> frame.(b) <- y)
+  done
+
+let reset (p : t) : unit =
+  Array.fill p.smooth 0 (Array.length p.smooth) 0. ;
+  p.started <- false
+
+let pcen ?(domains : int = Parallel.default_domains ())
+    ?(params : params = default) (mel : (float, Bigarray.float32_elt) Audio.G.t)
+    : (float, Bigarray.float32_elt) Audio.G.t =
+  let bands, frames =
+    match Audio.G.shape mel with
+    | [|bands; frames|] ->
+        (bands, frames)
+    | _ ->
+        raise (Invalid_argument "Feature.Pcen.pcen: expected a matrix")
+  in
+  let out = Audio.G.zeros Bigarray.Float32 [|bands; frames|] in
+  let src = Bigarray.reshape_2 mel bands frames in
+  let dst = Bigarray.reshape_2 out bands frames in
+  let offset = Float.pow params.delta params.r in
+  Parallel.parallel_for ~domains bands (fun b ->
+      if frames > 0 then (
+        let m = ref (Bigarray.Array2.unsafe_get src b 0) in
+        for t = 0 to frames - 1 do
+          m :=
+            step params offset !m (Bigarray.Array2.unsafe_get src b t) (fun y ->
+                Bigarray.Array2.unsafe_set dst b t y )
+        done ) ) ;
+  out
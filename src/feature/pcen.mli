@@ -0,0 +1,70 @@
+(*****************************************************************************)
+(*                                                                           *)
+(*                                                                           *)
+(*  Copyright (C) 2023                                                       *)
+(*    Gabriel Santamaria                                                     *)
+(*                                                                           *)
+(*                                                                           *)
+(*  Licensed under the Apache License, Version 2.0 (the "License");          *)
+(*  you may not use this file except in compliance with the License.         *)
+(*  You may obtain a copy of the License at                                  *)
+(*                                                                           *)
+(*    http://www.apache.org/licenses/LICENSE-2.0                             *)
+(*                                                                           *)
+(*  Unless required by applicable law or agreed to in writing, software      *)
+(*  distributed under the License is distributed on an "AS IS" BASIS,        *)
+(*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *)
+(*  See the License for the specific language governing permissions and      *)
+(*  limitations under the License.                                           *)
+(*                                                                           *)
+(*****************************************************************************)
+
+(**
+    The {!Feature.Pcen} module implements per-channel energy normalization
+    (Wang et al., 2017), a replacement of the log compression of mel
+    spectrograms that is more robust to loudness changes and background
+    noise:
+
+    [pcen(t, f) = (E(t, f) / (eps + M(t, f))^alpha + delta)^r - delta^r]
+
+    where [M] is [E] smoothed over time by a first-order IIR filter with
+    coefficient [s]. The streaming and batch versions share the same update,
+    so they produce exactly the same values. *)
+
+type params = {s: float; alpha: float; delta: float; r: float; eps: float}
+
+val default : params
+(**
+    [default] are the usual parameters, [s = 0.025], [alpha = 0.98],
+    [delta = 2.], [r = 0.5] and [eps = 1e-6] *)
+
+(**
+    {1 Streaming} *)
+
+type t
+
+val create : ?params:params -> int -> t
+(**
+    [create ?params bands] creates a normalizer for frames of [bands] mel
+    bands. The smoother starts from the first frame it is given. *)
+
+val process : t -> float array -> unit
+(**
+    [process p frame] normalizes in place the next mel frame *)
+
+val reset : t -> unit
+(**
+    [reset p] forgets the state of the smoother *)
+
+(**
+    {1 Batch} *)
+
+val pcen :
+     ?domains:int
+  -> ?params:params
+  -> (float, Bigarray.float32_elt) Audio.G.t
+  -> (float, Bigarray.float32_elt) Audio.G.t
+(**
+    [pcen ?domains ?params mel] normalizes the mel spectrogram [mel] of shape
+    [\[|bands; frames|\]], as returned by {!Feature.Mel.spectrogram}. Bands
+    are processed in parallel over at most [?domains] domains. *)
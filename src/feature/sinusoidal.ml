@@ -0,0 +1,210 @@
+(*****************************************************************************)
+(*                                                                           *)
+(*                                                                           *)
+(*  Copyright (C) 2023                                                       *)
+(*    Gabriel Santamaria                                                     *)
+(*                                                                           *)
+(*                                                                           *)
+(*  Licensed under the Apache License, Version 2.0 (the "License");          *)
+(*  you may not use this file except in compliance with the License.         *)
+(*  You may obtain a copy of the License at                                  *)
+(*                                                                           *)
+(*    http://www.apache.org/licenses/LICENSE-2.0                             *)
+(*                                                                           *)
+(*  Unless required by applicable law or agreed to in writing, software      *)
+(*  distributed under the License is distributed on an "AS IS" BASIS,        *)
+(*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *)
+(*  See the License for the specific language governing permissions and      *)
+(*  limitations under the License.                                           *)
+(*                                                                           *)
+(*****************************************************************************)
+
+type peak = {freq: float; amp: float}
+
+let peaks ?(domains : int = Parallel.default_domains ()) ?(nfft : int = 2048)
+    ?(hop : int = 256) ?(threshold : float = -80.) ?(max_peaks : int = 60)
+    (a : Audio.audio) : peak array array =
+  if hop <= 0 then
+    raise (Invalid_argument "Feature.Sinusoidal.peaks: invalid hop") ;
+  let sample_rate = float_of_int (Audio.Metadata.sample_rate (Audio.meta a)) in
+  let stft = Dsp.Stft.create nfft in
+  (* a sinusoid of amplitude 1 peaks at [sum w / 2] *)
+  let gain = 2. /. Array.fold_left ( +. ) 0. (Dsp.Stft.window stft) in
+  let x = Audio.View.of_data (Audio.mixdown a) in
+  let count = Dsp.Stft.frames stft ~hop (Audio.View.length x) in
+  let out = Array.make count [||] in
+  let half = nfft / 2 in
+  Parallel.chunks ~domains ~chunk:32 count (fun start stop ->
+      let re = Array.make nfft 0. and im = Array.make nfft 0. in
+      let db = Array.make (half + 1) 0. in
+      for k = start to stop - 1 do
+        Dsp.Stft.power stft ~re ~im
+          (fun i -> Audio.View.get x ((k * hop) + i))
+          db ;
+        (* the powers are turned into levels in place *)
+        for j = 0 to half do
+          let m = gain *. Float.sqrt db.(j) in
+          db.(j) <- 20. *. Float.log10 (Float.max m 1e-12)
+        done ;
+        let found = ref [] in
+        for j = 1 to half - 1 do
+          let l = db.(j - 1) and c = db.(j) and r = db.(j + 1) in
+          if c > threshold && c > l && c >= r then
+            (* vertex of the parabola through the three bins *)
+            let p = 0.5 *. (l -. r) /. (l -. (2. *. c) +. r) in
+            let level = c -. (0.25 *. (l -. r) *. p) in
+            found :=
+              { freq= (float_of_int j +. p) *. sample_rate /. float_of_int nfft
+              ; amp= Float.pow 10. (level /. 20.) }
+              :: !found
+        done ;
+        let sorted =
+          List.sort (fun a b -> Float.compare b.amp a.amp) !found
+          |> List.filteri (fun i _ -> i < max_peaks)
+        in
+        out.(k) <- Array.of_list sorted
+      done ) ;
+  out
+
+type partial = {start: int; freqs: float array; amps: float array}
+
+(* partial being tracked, its values in reverse order *)
+type active =
+  { first: int
+  ; mutable last_freq: float
+  ; mutable rev_freqs: float list
+  ; mutable rev_amps: float list }
+
+let track ?(max_jump : float = 50.) ?(min_length : int = 4)
+    (peaks : peak array array) : partial list =
+  let finished = ref [] in
+  let finish (p : active) =
+    if List.length p.rev_freqs >= min_length then
+      finished :=
+        { start= p.first
+        ; freqs= Array.of_list (List.rev p.rev_freqs)
+        ; amps= Array.of_list (List.rev p.rev_amps) }
+        :: !finished
+  in
+  let active = ref [] in
+  Array.iteri
+    (fun k frame ->
+      let free = ref !active and next = ref [] in
+      (* loudest peaks pick their partial first *)
+      let frame = Array.copy frame in
+      Array.sort (fun a b -> Float.compare b.amp a.amp) frame ;
+      Array.iter
+        (fun pk ->
+          let best =
+            List.fold_left
+              (fun best p ->
+                let d = Float.abs (p.last_freq -. pk.freq) in
+                match best with
+                | Some (_, bd) when bd <= d ->
+                    best
+                | _ when d <= max_jump ->
+                    Some (p, d)
+                | _ ->
+                    best )
+              None !free
+          in
+          match best with
+          | Some (p, _) ->
+              free := List.filter (fun q -> q != p) !free ;
+              p.last_freq <- pk.freq ;
+              p.rev_freqs <- pk.freq :: p.rev_freqs ;
+              p.rev_amps <- pk.amp :: p.rev_amps ;
+              next := p :: !next
+          | None ->
+              next :=
+                { first= k
+                ; last_freq= pk.freq
+                ; rev_freqs= [pk.freq]
+                ; rev_amps= [pk.amp] }
+                :: !next )
+        frame ;
+      List.iter finish !free ;
+      active := !next )
+    peaks ;
+  List.iter finish !active ;
+  List.sort (fun a b -> Int.compare a.start b.start) !finished
+
+let synthesize ?(domains : int = Parallel.default_domains ())
+    ~(sample_rate : int) ~(hop : int) ~(offset : int) ~(length : int)
+    (partials : partial list) : (float, Bigarray.float32_elt) Audio.G.t =
+  let out = Audio.G.zeros Bigarray.Float32 [|length|] in
+  let buf = Bigarray.reshape_1 out length in
+  let w f = 2. *. Float.pi *. f /. float_of_int sample_rate in
+  let fhop = float_of_int hop in
+  (* each partial gets a silent frame before and after it, so it fades in and
+     out, and the phase at each of its frames is accumulated beforehand *)
+  let prepared =
+    List.map
+      (fun p ->
+        let len = Array.length p.freqs in
+        let freqs =
+          Array.init (len + 2) (fun i ->
+              w p.freqs.(max 0 (min (len - 1) (i - 1))) )
+        in
+        let amps =
+          Array.init (len + 2) (fun i ->
+              if i = 0 || i = len + 1 then 0. else p.amps.(i - 1) )
+        in
+        let phases = Array.make (len + 2) 0. in
+        for i = 1 to len + 1 do
+          let delta = (freqs.(i) -. freqs.(i - 1)) /. fhop in
+          phases.(i) <-
+            Float.rem
+              ( phases.(i - 1)
+              +. (fhop *. freqs.(i - 1))
+              +. (delta *. fhop *. (fhop -. 1.) /. 2.) )
+              (2. *. Float.pi)
+        done ;
+        (p.start - 1, freqs, amps, phases) )
+      partials
+    |> Array.of_list
+  in
+  let segments = ((length - offset) / hop) + 2 in
+  (* segment [s] covers the samples between the frames [s - 1] and [s] *)
+  Parallel.parallel_for ~domains segments (fun s ->
+      let k = s - 1 in
+      let t0 = offset + (k * hop) in
+      Array.iter
+        (fun (first, freqs, amps, phases) ->
+          let i = k - first in
+          if i >= 0 && i < Array.length freqs - 1 then (
+            let w0 = freqs.(i) in
+            let delta = (freqs.(i + 1) -. freqs.(i)) /. fhop in
+            let a0 = amps.(i) and da = (amps.(i + 1) -. amps.(i)) /. fhop in
+            (* phasor, its rotation and the rotation of the rotation *)
+            let pr = ref (Float.cos phases.(i)) in
+            let pi = ref (Float.sin phases.(i)) in
+            let rr = ref (Float.cos w0) and ri = ref (Float.sin w0) in
+            let qr = Float.cos delta and qi = Float.sin delta in
+            for j = 0 to hop - 1 do
+              let t = t0 + j in
+              if t >= 0 && t < length then
+                Bigarray.Array1.unsafe_set buf t
+                  ( Bigarray.Array1.unsafe_get buf t
+                  +. ((a0 +. (da *. float_of_int j)) *. !pr) ) ;
+              let r = (!pr *. !rr) -. (!pi *. !ri) in
+              pi := (!pr *. !ri) +. (!pi *. !rr) ;
+              pr := r ;
+              let r = (!rr *. qr) -. (!ri *. qi) in
+              ri := (!rr *. qi) +. (!ri *. qr) ;
+              rr := r
+            done ) )
+        prepared ) ;
+  out
+
+let resynthesize ?(domains : int = Parallel.default_domains ())
+    ?(nfft : int = 2048) ?(hop : int = 256) ?threshold ?max_peaks ?max_jump
+    ?min_length (a : Audio.audio) : (float, Bigarray.float32_elt) Audio.G.t =
+  let pk = peaks ~domains ~nfft ~hop ?threshold ?max_peaks a in
+  let partials = track ?max_jump ?min_length pk in
+  let channels = Audio.Metadata.channels (Audio.meta a) in
+  synthesize ~domains
+    ~sample_rate:(Audio.Metadata.sample_rate (Audio.meta a))
+    ~hop ~offset:(nfft / 2)
+    ~length:(Audio.rawsize a / channels)
+    partials
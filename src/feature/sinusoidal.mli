@@ -0,0 +1,94 @@
+(*****************************************************************************)
+(*                                                                           *)
+(*                                                                           *)
+(*  Copyright (C) 2023                                                       *)
+(*    Gabriel Santamaria                                                     *)
+(*                                                                           *)
+(*                                                                           *)
+(*  Licensed under the Apache License, Version 2.0 (the "License");          *)
+(*  you may not use this file except in compliance with the License.         *)
+(*  You may obtain a copy of the License at                                  *)
+(*                                                                           *)
+(*    http://www.apache.org/licenses/LICENSE-2.0                             *)
+(*                                                                           *)
+(*  Unless required by applicable law or agreed to in writing, software      *)
+(*  distributed under the License is distributed on an "AS IS" BASIS,        *)
+(*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *)
+(*  See the License for the specific language governing permissions and      *)
+(*  limitations under the License.                                           *)
+(*                                                                           *)
+(*****************************************************************************)
+
+(**
+    The {!Feature.Sinusoidal} module implements McAulay-Quatieri sinusoidal
+    modeling: the spectral peaks of each frame are located precisely with a
+    parabolic interpolation, linked from frame to frame into partials, and
+    the partials can be resynthesized by a bank of oscillators.
+
+    Oscillators are recursive phasors whose rotation is itself rotated to
+    follow linear frequency changes, so no trigonometric function is evaluated
+    per sample. The phase of each partial at every frame is known beforehand,
+    which lets the resynthesis of separate frames run in parallel. *)
+
+type peak =
+  { freq: float  (** in Hz *)
+  ; amp: float  (** linear amplitude *) }
+
+val peaks :
+     ?domains:int
+  -> ?nfft:int
+  -> ?hop:int
+  -> ?threshold:float
+  -> ?max_peaks:int
+  -> Audio.audio
+  -> peak array array
+(**
+    [peaks ?domains ?nfft ?hop ?threshold ?max_peaks audio] returns the
+    spectral peaks of each frame of the mixdown of [audio]. Frames are
+    [?nfft] samples long (default is [2048]), Hann windowed and taken every
+    [?hop] samples (default is [256]). Only local maxima above [?threshold]
+    dBFS (default is [-80.]) are kept, at most [?max_peaks] per frame (default
+    is [60]), the loudest ones. Frames are analysed in parallel over at most
+    [?domains] domains. *)
+
+type partial =
+  { start: int  (** index of the first frame of the partial *)
+  ; freqs: float array  (** frequency at each frame, in Hz *)
+  ; amps: float array  (** amplitude at each frame *) }
+
+val track :
+  ?max_jump:float -> ?min_length:int -> peak array array -> partial list
+(**
+    [track ?max_jump ?min_length peaks] links the peaks of consecutive frames
+    into partials. A partial continues with the closest peak of the next frame
+    within [?max_jump] Hz (default is [50.]), loudest peaks being served
+    first; unmatched peaks start new partials. Partials shorter than
+    [?min_length] frames (default is [4]) are dropped. *)
+
+val synthesize :
+     ?domains:int
+  -> sample_rate:int
+  -> hop:int
+  -> offset:int
+  -> length:int
+  -> partial list
+  -> (float, Bigarray.float32_elt) Audio.G.t
+(**
+    [synthesize ?domains ~sample_rate ~hop ~offset ~length partials] renders
+    [length] samples of the sum of the partials, the frame [k] being located
+    at the sample [offset + k * hop]. Amplitudes and frequencies are linearly
+    interpolated between frames, and partials fade in and out over one hop. *)
+
+val resynthesize :
+     ?domains:int
+  -> ?nfft:int
+  -> ?hop:int
+  -> ?threshold:float
+  -> ?max_peaks:int
+  -> ?max_jump:float
+  -> ?min_length:int
+  -> Audio.audio
+  -> (float, Bigarray.float32_elt) Audio.G.t
+(**
+    [resynthesize audio] chains {!peaks}, {!track} and {!synthesize} and
+    returns a mono signal of the length of [audio] *)
@@ -106,17 +106,19 @@ let spectral_helper ?(nfft : int = 256) ?(fs : int = 2) ?(window = Signal.hann)
   let window =
     Audio.G.reshape Audio.G.(window * ones Bigarray.float32 [|nfft|]) [|-1; 1|]
   in
-  let res =
-    Audio.G.slide ~window:nfft ~step:(nfft - noverlap) x |> Audio.G.transpose
+  (* frames are gathered in a single copy, one frame per column *)
+  let framed (d : (float, Bigarray.float32_elt) Audio.G.t) =
+    Audio.View.(
+      of_data d |> frames ~hop:(nfft - noverlap) ~length:nfft |> to_matrix )
   in
+  let res = framed x in
   let res = detrend res in
   let res = Audio.G.(res * window) in
   let res = Fft.S.rfft res ~axis:0 in
   Audio.G.get_slice_ ~out:res [[]; [num_freqs]] res ;
   let freqs = fftfreq pad_to (1. /. float_of_int fs) in
   ( if not same_data then (
-      let res_y = Audio.G.slide ~window:nfft ~step:(nfft - noverlap) y in
-      let res_y = Audio.G.transpose res_y in
+      let res_y = framed y in
       let res_y = detrend res_y in
       let res_y = Audio.G.(res_y * window) in
       let res_y = Fft.S.rfft res_y ~axis:0 in
@@ -0,0 +1,180 @@
+(*****************************************************************************)
+(*                                                                           *)
+(*                                                                           *)
+(*  Copyright (C) 2023                                                       *)
+(*    Gabriel Santamaria                                                     *)
+(*                                                                           *)
+(*                                                                           *)
+(*  Licensed under the Apache License, Version 2.0 (the "License");          *)
+(*  you may not use this file except in compliance with the License.         *)
+(*  You may obtain a copy of the License at                                  *)
+(*                                                                           *)
+(*    http://www.apache.org/licenses/LICENSE-2.0                             *)
+(*                                                                           *)
+(*  Unless required by applicable law or agreed to in writing, software      *)
+(*  distributed under the License is distributed on an "AS IS" BASIS,        *)
+(*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *)
+(*  See the License for the specific language governing permissions and      *)
+(*  limitations under the License.                                           *)
+(*                                                                           *)
+(*****************************************************************************)
+
+type wavelet = Morlet of float | Mexican_hat
+
+let frequency (w : wavelet) ~(sample_rate : int) (s : float) : float =
+  let period =
+    match w with
+    | Morlet w0 ->
+        4. *. Float.pi *. s /. (w0 +. Float.sqrt (2. +. (w0 *. w0)))
+    | Mexican_hat ->
+        2. *. Float.pi *. s /. Float.sqrt 2.5
+  in
+  float_of_int sample_rate /. period
+
+let scales ?(fmin : float = 50.) ?fmax (w : wavelet) ~(sample_rate : int)
+    (n : int) : float array =
+  let fmax = Option.value ~default:(float_of_int sample_rate /. 4.) fmax in
+  if n <= 0 || fmin <= 0. || fmin >= fmax then
+    raise (Invalid_argument "Feature.Wavelet.scales: invalid range") ;
+  (* the frequency is inversely proportional to the scale *)
+  let unit = frequency w ~sample_rate 1. in
+  Array.init n (fun i ->
+      let r = if n = 1 then 0. else float_of_int i /. float_of_int (n - 1) in
+      unit /. (fmax *. Float.pow (fmin /. fmax) r) )
+
+(* highest angular frequency, in radians per sample, where the spectrum of
+   the wavelet at scale [s] is not negligible *)
+let cutoff (w : wavelet) (s : float) : float =
+  match w with Morlet w0 -> (w0 +. 4.) /. s | Mexican_hat -> 5. /. s
+
+(* bin [k] of the spectrum of the wavelet at scale [s] sampled on [n] bins,
+   normalized to unit energy (Torrence and Compo) *)
+let spectrum (w : wavelet) (n : int) (s : float) (k : int) : float =
+  let norm = Float.sqrt (2. *. Float.pi *. s) in
+  let k = if k <= n / 2 then k else k - n in
+  let x = s *. 2. *. Float.pi *. float_of_int k /. float_of_int n in
+  match w with
+  | Morlet w0 ->
+      if x <= 0. then 0.
+      else
+        norm
+        *. Float.pow Float.pi (-0.25)
+        *. Float.exp (-0.5 *. (x -. w0) *. (x -. w0))
+  | Mexican_hat ->
+      (* sqrt (gamma 2.5) *)
+      norm *. x *. x *. Float.exp (-0.5 *. x *. x) /. 1.1529702
+
+type plan =
+  { size: int
+  ; support: int
+  ; scales: float array
+  ; decimation: int array
+  ; spectra: float array array (* the [size / decimation] bins kept *) }
+
+let plan ?(decimate : bool = true) ?(max_decimation : int = 64) (w : wavelet)
+    ~(scales : float array) (length : int) : plan =
+  if Array.exists (fun s -> s <= 0.) scales then
+    raise (Invalid_argument "Feature.Wavelet.plan: scales must be positive") ;
+  (* zero padding covering the support of the widest wavelet limits the
+     wrap-around of the circular convolution *)
+  let support =
+    int_of_float (Array.fold_left (fun m s -> Float.max m (4. *. s)) 0. scales)
+  in
+  let size = Dsp.Fft.next_pow2 (max 2 (max 0 length + support)) in
+  let factor s =
+    if not decimate then 1
+    else
+      let limit = Float.pi /. cutoff w s in
+      let rec go d =
+        if
+          2 * d <= max_decimation
+          && float_of_int (2 * d) <= limit
+          && size / (2 * d) >= 2
+        then go (2 * d)
+        else d
+      in
+      go 1
+  in
+  let decimation = Array.map factor scales in
+  (* only the lowest [m] frequencies are kept, negative ones being folded at
+     the end of the smaller spectrum *)
+  let spectra =
+    Array.mapi
+      (fun i s ->
+        let m = size / decimation.(i) in
+        Array.init m (fun k ->
+            spectrum w size s (if k < m / 2 then k else k + size - m) ) )
+      scales
+  in
+  {size; support; scales= Array.copy scales; decimation; spectra}
+
+type scalogram =
+  { frames: int
+  ; scales: float array
+  ; decimation: int array
+  ; rows: (float, Bigarray.float32_elt) Audio.G.t array }
+
+let run ~(domains : int) (p : plan) (x : Audio.View.t) : scalogram =
+  let n = Audio.View.length x in
+  let size = p.size in
+  let xr = Array.make size 0. and xi = Array.make size 0. in
+  Audio.View.blit x xr 0 ;
+  Dsp.Fft.forward (Dsp.Fft.plan size) xr xi ;
+  let rows =
+    Parallel.map ~domains
+      (fun i ->
+        let d = p.decimation.(i) and psi = p.spectra.(i) in
+        let m = size / d in
+        let re = Array.make m 0. and im = Array.make m 0. in
+        for k = 0 to m - 1 do
+          let j = if k < m / 2 then k else k + size - m in
+          re.(k) <- xr.(j) *. psi.(k) ;
+          im.(k) <- xi.(j) *. psi.(k)
+        done ;
+        Dsp.Fft.inverse (Dsp.Fft.plan m) re im ;
+        let len = (n + d - 1) / d in
+        let row = Audio.G.zeros Bigarray.Float32 [|len|] in
+        let buf = Bigarray.reshape_1 row len in
+        let scale = 1. /. float_of_int d in
+        for t = 0 to len - 1 do
+          Bigarray.Array1.unsafe_set buf t
+            (scale *. Float.sqrt ((re.(t) *. re.(t)) +. (im.(t) *. im.(t))))
+        done ;
+        row )
+      (Array.init (Array.length p.scales) Fun.id)
+  in
+  { frames= n
+  ; scales= Array.copy p.scales
+  ; decimation= Array.copy p.decimation
+  ; rows }
+
+let transform ?(domains : int = Parallel.default_domains ()) (p : plan)
+    (a : Audio.audio) : scalogram =
+  let x = Audio.View.of_data (Audio.mixdown a) in
+  if Audio.View.length x + p.support > p.size then
+    raise
+      (Invalid_argument
+         "Feature.Wavelet.transform: audio too long for the plan" ) ;
+  run ~domains p x
+
+let cwt ?(domains : int = Parallel.default_domains ()) ?decimate
+    ?max_decimation (w : wavelet) ~(scales : float array) (a : Audio.audio) :
+    scalogram =
+  let x = Audio.View.of_data (Audio.mixdown a) in
+  let p = plan ?decimate ?max_decimation w ~scales (Audio.View.length x) in
+  run ~domains p x
+
+let to_matrix (s : scalogram) : (float, Bigarray.float32_elt) Audio.G.t =
+  let scales = Array.length s.rows in
+  let out = Audio.G.zeros Bigarray.Float32 [|scales; s.frames|] in
+  let dst = Bigarray.reshape_2 out scales s.frames in
+  Array.iteri
+    (fun i row ->
+      let d = s.decimation.(i) in
+      let src = Bigarray.reshape_1 row (Audio.G.numel row) in
+      for t = 0 to s.frames - 1 do
+        Bigarray.Array2.unsafe_set dst i t
+          (Bigarray.Array1.unsafe_get src (t / d))
+      done )
+    s.rows ;
+  out
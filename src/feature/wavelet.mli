@@ -0,0 +1,111 @@
+(*****************************************************************************)
+(*                                                                           *)
+(*                                                                           *)
+(*  Copyright (C) 2023                                                       *)
+(*    Gabriel Santamaria                                                     *)
+(*                                                                           *)
+(*                                                                           *)
+(*  Licensed under the Apache License, Version 2.0 (the "License");          *)
+(*  you may not use this file except in compliance with the License.         *)
+(*  You may obtain a copy of the License at                                  *)
+(*                                                                           *)
+(*    http://www.apache.org/licenses/LICENSE-2.0                             *)
+(*                                                                           *)
+(*  Unless required by applicable law or agreed to in writing, software      *)
+(*  distributed under the License is distributed on an "AS IS" BASIS,        *)
+(*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *)
+(*  See the License for the specific language governing permissions and      *)
+(*  limitations under the License.                                           *)
+(*                                                                           *)
+(*****************************************************************************)
+
+(**
+    The {!Feature.Wavelet} module computes continuous wavelet transforms,
+    which analyse a signal with a time resolution adapted to each frequency
+    and are well suited to transients.
+
+    The transform is computed in the frequency domain. The spectrum of the
+    signal is computed once, multiplied by the spectrum of the wavelet at
+    each scale and transformed back, scales being processed in parallel. The
+    spectra of the wavelets are held by a {!plan}, which callers analysing
+    many signals of similar lengths can create once and reuse.
+
+    Since coarse scales only keep low frequencies, their inverse FFTs can be
+    computed on fewer points, which directly gives decimated rows and cuts
+    both the cost and the memory of the scalogram. *)
+
+type wavelet =
+  | Morlet of float  (** analytic Morlet wavelet of central frequency w0 *)
+  | Mexican_hat  (** second derivative of a Gaussian *)
+
+val frequency : wavelet -> sample_rate:int -> float -> float
+(**
+    [frequency w ~sample_rate s] returns the Fourier frequency, in Hz,
+    matching the scale [s] (expressed in samples) *)
+
+val scales :
+     ?fmin:float
+  -> ?fmax:float
+  -> wavelet
+  -> sample_rate:int
+  -> int
+  -> float array
+(**
+    [scales ?fmin ?fmax w ~sample_rate n] returns [n] scales whose
+    frequencies are log-spaced from [?fmax] (default is [sample_rate / 4])
+    down to [?fmin] Hz (default is [50.]). *)
+
+type plan
+(**
+    Spectra and decimation factors of the wavelet at a set of scales, for a
+    given FFT size *)
+
+val plan :
+     ?decimate:bool
+  -> ?max_decimation:int
+  -> wavelet
+  -> scales:float array
+  -> int
+  -> plan
+(**
+    [plan ?decimate ?max_decimation w ~scales length] prepares the transform
+    of signals of at most [length] frames. When [?decimate] is [true] (the
+    default), the row of each scale is decimated by the largest power of two,
+    up to [?max_decimation] (default is [64]), that keeps the band of the
+    wavelet below the Nyquist frequency of the row. A plan holds one spectrum
+    per scale, of up to twice the next power of two above [length], and can
+    be shared between domains. *)
+
+type scalogram =
+  { frames: int  (** number of frames of the analysed audio *)
+  ; scales: float array
+  ; decimation: int array  (** decimation factor of each row *)
+  ; rows: (float, Bigarray.float32_elt) Audio.G.t array
+        (** magnitudes of the coefficients, one row per scale *) }
+
+val cwt :
+     ?domains:int
+  -> ?decimate:bool
+  -> ?max_decimation:int
+  -> wavelet
+  -> scales:float array
+  -> Audio.audio
+  -> scalogram
+(**
+    [cwt ?domains ?decimate ?max_decimation w ~scales audio] computes the
+    scalogram of the mixdown of [audio] with a plan made for it, see
+    {!plan}. *)
+
+val transform : ?domains:int -> plan -> Audio.audio -> scalogram
+(**
+    [transform ?domains p audio] computes the scalogram of the mixdown of
+    [audio] with the plan [p], scales being processed over at most
+    [?domains] domains.
+
+    @raise Invalid_argument if [audio] is longer than the plan allows. *)
+
+val to_matrix : scalogram -> (float, Bigarray.float32_elt) Audio.G.t
+(**
+    [to_matrix s] expands the decimated rows of [s] back to full rate, by
+    repeating their values, and returns a matrix of shape
+    [\[|scales; frames|\]]. *)
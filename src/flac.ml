@@ -0,0 +1,372 @@
+(*****************************************************************************)
+(*                                                                           *)
+(*                                                                           *)
+(*  Copyright (C) 2023                                                       *)
+(*    Gabriel Santamaria                                                     *)
+(*                                                                           *)
+(*                                                                           *)
+(*  Licensed under the Apache License, Version 2.0 (the "License");          *)
+(*  you may not use this file except in compliance with the License.         *)
+(*  You may obtain a copy of the License at                                  *)
+(*                                                                           *)
+(*    http://www.apache.org/licenses/LICENSE-2.0                             *)
+(*                                                                           *)
+(*  Unless required by applicable law or agreed to in writing, software      *)
+(*  distributed under the License is distributed on an "AS IS" BASIS,        *)
+(*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *)
+(*  See the License for the specific language governing permissions and      *)
+(*  limitations under the License.                                           *)
+(*                                                                           *)
+(*****************************************************************************)
+
+(* see https://xiph.org/flac/format.html *)
+
+module W = Lossless.Bitwriter
+
+let header_size = 42
+
+(* bounds of the sample rate and of the number of samples per channel, stored
+   on 20 and 36 bits in STREAMINFO *)
+let max_sample_rate = 655350
+
+let max_total = 1 lsl 36
+
+let max_lpc_order = 8
+
+let lpc_precision = 12
+
+let max_partition_order = 8
+
+let crc8_table =
+  Array.init 256 (fun i ->
+      let crc = ref i in
+      for _ = 0 to 7 do
+        crc :=
+          if !crc land 0x80 <> 0 then ((!crc lsl 1) lxor 0x07) land 0xff
+          else (!crc lsl 1) land 0xff
+      done ;
+      !crc )
+
+let crc16_table =
+  Array.init 256 (fun i ->
+      let crc = ref (i lsl 8) in
+      for _ = 0 to 7 do
+        crc :=
+          if !crc land 0x8000 <> 0 then ((!crc lsl 1) lxor 0x8005) land 0xffff
+          else (!crc lsl 1) land 0xffff
+      done ;
+      !crc )
+
+let crc8 (s : string) : int =
+  String.fold_left
+    (fun crc c -> crc8_table.(crc lxor Char.code c))
+    0 s
+
+let crc16 (s : string) : int =
+  String.fold_left
+    (fun crc c ->
+      ((crc lsl 8) land 0xffff) lxor crc16_table.((crc lsr 8) lxor Char.code c)
+      )
+    0 s
+
+(* block size code, with the optional explicit size written after the frame
+   number *)
+let block_size_code (n : int) : int * (int * int) option =
+  let rec pow2 code size =
+    if code > 15 then None
+    else if size = n then Some code
+    else pow2 (code + 1) (size * 2)
+  in
+  match (n, pow2 8 256, pow2 2 576) with
+  | 192, _, _ ->
+      (1, None)
+  | _, Some code, _ ->
+      (code, None)
+  | _, _, Some code when code <= 5 ->
+      (code, None)
+  | _ when n <= 256 ->
+      (6, Some (8, n - 1))
+  | _ ->
+      (7, Some (16, n - 1))
+
+let sample_size_code (bps : int) : int =
+  match bps with
+  | 8 ->
+      1
+  | 12 ->
+      2
+  | 16 ->
+      4
+  | 20 ->
+      5
+  | 24 ->
+      6
+  | 32 ->
+      7
+  | _ ->
+      0
+
+(* frame numbers are coded like UTF-8 characters *)
+let write_utf8 (w : W.t) (v : int) : unit =
+  if v < 0x80 then W.bits w 8 v
+  else
+    let len =
+      if v < 0x800 then 2
+      else if v < 0x10000 then 3
+      else if v < 0x200000 then 4
+      else if v < 0x4000000 then 5
+      else 6
+    in
+    let lead = (0xff lsl (8 - len)) land 0xff in
+    W.bits w 8 (lead lor (v lsr (6 * (len - 1)))) ;
+    for i = len - 2 downto 0 do
+      W.bits w 8 (0x80 lor ((v lsr (6 * i)) land 0x3f))
+    done
+
+(* optimal Rice parameter of [m] folded residuals summing to [sum] *)
+let rice_k (sum : int) (m : int) : int =
+  let rec best k = if k < 14 && m lsl (k + 1) <= sum then best (k + 1) else k in
+  if m = 0 then 0 else best 0
+
+(* returns the estimated size in bits of the residual along with the best
+   partition order *)
+let residual_cost (res : int array) (order : int) (n : int) : int * int =
+  let prefix = Array.make (n + 1) 0 in
+  for i = 0 to n - 1 do
+    prefix.(i + 1) <- prefix.(i) + Lossless.zigzag res.(i)
+  done ;
+  let cost p =
+    let psize = n lsr p in
+    let total = ref 6 in
+    for part = 0 to (1 lsl p) - 1 do
+      let start = if part = 0 then order else part * psize in
+      let stop = (part + 1) * psize in
+      let m = stop - start in
+      let sum = prefix.(stop) - prefix.(start) in
+      let k = rice_k sum m in
+      total := !total + 4 + (m * (k + 1)) + (sum lsr k)
+    done ;
+    !total
+  in
+  let rec search p best =
+    if
+      p > max_partition_order
+      || n land ((1 lsl p) - 1) <> 0
+      || n lsr p <= order
+    then best
+    else
+      let c = cost p in
+      search (p + 1) (if c < fst best then (c, p) else best)
+  in
+  search 1 (cost 0, 0)
+
+let write_residual (w : W.t) (res : int array) (order : int) (n : int)
+    (p : int) : unit =
+  W.bits w 2 0 ;
+  W.bits w 4 p ;
+  let psize = n lsr p in
+  for part = 0 to (1 lsl p) - 1 do
+    let start = if part = 0 then order else part * psize in
+    let stop = (part + 1) * psize in
+    let k = min 14 (Lossless.rice_parameter res start (stop - start)) in
+    W.bits w 4 k ;
+    for i = start to stop - 1 do
+      W.rice w k (Array.unsafe_get res i)
+    done
+  done
+
+let subframe_header (w : W.t) (kind : int) : unit =
+  W.bits w 1 0 ; W.bits w 6 kind ; W.bits w 1 0
+
+let write_subframe (w : W.t) ~(bps : int) (x : int array) (n : int)
+    (fixed : int array) (lpc : int array) : unit =
+  let constant = ref true in
+  for i = 1 to n - 1 do
+    if x.(i) <> x.(0) then constant := false
+  done ;
+  if !constant then (subframe_header w 0 ; W.bits w bps x.(0))
+  else
+    let forder = Lossless.fixed_order x 0 n in
+    Lossless.fixed_residual forder x 0 n fixed ;
+    let fcost, fpart = residual_cost fixed forder n in
+    let fcost = fcost + (forder * bps) in
+    let lorder = min max_lpc_order (n / 2) in
+    let q, shift =
+      Lossless.lpc_coefficients x 0 n lorder
+      |> Lossless.quantize_lpc ~precision:lpc_precision
+    in
+    let lcost, lpart =
+      if lorder > 0 then (
+        Lossless.lpc_residual q shift x 0 n lpc ;
+        let cost, part = residual_cost lpc lorder n in
+        (cost + (lorder * (bps + lpc_precision)) + 9, part) )
+      else (max_int, 0)
+    in
+    let vcost = n * bps in
+    if vcost <= fcost && vcost <= lcost then (
+      subframe_header w 1 ;
+      for i = 0 to n - 1 do
+        W.bits w bps x.(i)
+      done )
+    else if fcost <= lcost then (
+      subframe_header w (8 + forder) ;
+      for i = 0 to forder - 1 do
+        W.bits w bps x.(i)
+      done ;
+      write_residual w fixed forder n fpart )
+    else (
+      subframe_header w (32 + lorder - 1) ;
+      for i = 0 to lorder - 1 do
+        W.bits w bps x.(i)
+      done ;
+      W.bits w 4 (lpc_precision - 1) ;
+      W.bits w 5 shift ;
+      Array.iter (W.bits w lpc_precision) q ;
+      write_residual w lpc lorder n lpart )
+
+let encode_frame ~(bps : int) ~(channels : int) ~(frame_number : int)
+    (x : int array) : string =
+  let n = Array.length x / channels in
+  let code, explicit = block_size_code n in
+  let h = W.create 16 in
+  W.bits h 14 0x3ffe ;
+  (* reserved bit and fixed blocking strategy *)
+  W.bits h 2 0 ;
+  W.bits h 4 code ;
+  (* the sample rate is read from STREAMINFO *)
+  W.bits h 4 0 ;
+  W.bits h 4 (channels - 1) ;
+  W.bits h 3 (sample_size_code bps) ;
+  W.bits h 1 0 ;
+  write_utf8 h frame_number ;
+  Option.iter (fun (len, v) -> W.bits h len v) explicit ;
+  let header = W.contents h in
+  let w = W.create ((n * channels * bps / 16) + 64) in
+  String.iter (fun c -> W.bits w 8 (Char.code c)) header ;
+  W.bits w 8 (crc8 header) ;
+  let ch = Array.make n 0 in
+  let fixed = Array.make n 0 in
+  let lpc = Array.make n 0 in
+  for c = 0 to channels - 1 do
+    for i = 0 to n - 1 do
+      ch.(i) <- x.((i * channels) + c)
+    done ;
+    write_subframe w ~bps ch n fixed lpc
+  done ;
+  let body = W.contents w in
+  let crc = crc16 body in
+  let footer = Bytes.create 2 in
+  Bytes.set_uint16_be footer 0 crc ;
+  body ^ Bytes.to_string footer
+
+(* incremental MD5 (RFC 1321), so that the signature of a stream never
+   requires to keep its samples around *)
+module Md5 = struct
+  type t =
+    { state: int array
+    ; block: Bytes.t
+    ; mutable fill: int
+    ; mutable length: int }
+
+  let shifts =
+    [| 7; 12; 17; 22; 7; 12; 17; 22; 7; 12; 17; 22; 7; 12; 17; 22
+     ; 5; 9; 14; 20; 5; 9; 14; 20; 5; 9; 14; 20; 5; 9; 14; 20
+     ; 4; 11; 16; 23; 4; 11; 16; 23; 4; 11; 16; 23; 4; 11; 16; 23
+     ; 6; 10; 15; 21; 6; 10; 15; 21; 6; 10; 15; 21; 6; 10; 15; 21 |]
+
+  let constants =
+    Array.init 64 (fun i ->
+        Int64.to_int
+          (Int64.of_float
+             (Float.abs (Float.sin (float_of_int (i + 1))) *. 4294967296.) ) )
+
+  let mask = 0xffffffff
+
+  let create () : t =
+    { state= [|0x67452301; 0xefcdab89; 0x98badcfe; 0x10325476|]
+    ; block= Bytes.create 64
+    ; fill= 0
+    ; length= 0 }
+
+  let compress (h : t) (src : Bytes.t) (off : int) : unit =
+    let m = Array.init 16 (fun j -> Bytes.get_int32_le src (off + (4 * j))) in
+    let m = Array.map (fun v -> Int32.to_int v land mask) m in
+    let a = ref h.state.(0) and b = ref h.state.(1) in
+    let c = ref h.state.(2) and d = ref h.state.(3) in
+    for i = 0 to 63 do
+      let f, g =
+        if i < 16 then ((!b land !c) lor (lnot !b land mask land !d), i)
+        else if i < 32 then
+          ((!d land !b) lor (lnot !d land mask land !c), ((5 * i) + 1) mod 16)
+        else if i < 48 then (!b lxor !c lxor !d, ((3 * i) + 5) mod 16)
+        else (!c lxor (!b lor (lnot !d land mask)), 7 * i mod 16)
+      in
+      let f = (f + !a + constants.(i) + m.(g)) land mask in
+      let r = shifts.(i) in
+      a := !d ;
+      d := !c ;
+      c := !b ;
+      b := (!b + (((f lsl r) lor (f lsr (32 - r))) land mask)) land mask
+    done ;
+    h.state.(0) <- (h.state.(0) + !a) land mask ;
+    h.state.(1) <- (h.state.(1) + !b) land mask ;
+    h.state.(2) <- (h.state.(2) + !c) land mask ;
+    h.state.(3) <- (h.state.(3) + !d) land mask
+
+  let feed (h : t) (src : Bytes.t) : unit =
+    let len = Bytes.length src in
+    let pos = ref 0 in
+    while !pos < len do
+      if h.fill = 0 && len - !pos >= 64 then (
+        compress h src !pos ;
+        pos := !pos + 64 )
+      else
+        let n = min (64 - h.fill) (len - !pos) in
+        Bytes.blit src !pos h.block h.fill n ;
+        h.fill <- h.fill + n ;
+        pos := !pos + n ;
+        if h.fill = 64 then (
+          compress h h.block 0 ;
+          h.fill <- 0 )
+    done ;
+    h.length <- h.length + len
+
+  let finish (h : t) : string =
+    let bits = h.length * 8 in
+    let pad = Bytes.make (1 + ((55 - h.length) land 63)) '\000' in
+    Bytes.set pad 0 '\x80' ;
+    feed h pad ;
+    let size = Bytes.create 8 in
+    Bytes.set_int64_le size 0 (Int64.of_int bits) ;
+    feed h size ;
+    let out = Bytes.create 16 in
+    Array.iteri
+      (fun i v -> Bytes.set_int32_le out (4 * i) (Int32.of_int v))
+      h.state ;
+    Bytes.to_string out
+end
+
+let header ~(block_size : int) ~(min_frame : int) ~(max_frame : int)
+    ~(sample_rate : int) ~(channels : int) ~(bps : int) ~(total : int)
+    ~(md5 : string) : Bytes.t =
+  if sample_rate <= 0 || sample_rate > max_sample_rate then
+    raise (Invalid_argument "Flac.header: invalid sample rate") ;
+  if total < 0 || total >= max_total then
+    raise (Invalid_argument "Flac.header: too many samples") ;
+  let w = W.create header_size in
+  String.iter (fun c -> W.bits w 8 (Char.code c)) "fLaC" ;
+  (* last metadata block, of type STREAMINFO and length 34 *)
+  W.bits w 1 1 ;
+  W.bits w 7 0 ;
+  W.bits w 24 34 ;
+  W.bits w 16 block_size ;
+  W.bits w 16 block_size ;
+  W.bits w 24 min_frame ;
+  W.bits w 24 max_frame ;
+  W.bits w 20 sample_rate ;
+  W.bits w 3 (channels - 1) ;
+  W.bits w 5 (bps - 1) ;
+  W.bits w 4 (total lsr 32) ;
+  W.bits w 32 total ;
+  String.iter (fun c -> W.bits w 8 (Char.code c)) md5 ;
+  Bytes.of_string (W.contents w)
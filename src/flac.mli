@@ -0,0 +1,81 @@
+(*****************************************************************************)
+(*                                                                           *)
+(*                                                                           *)
+(*  Copyright (C) 2023                                                       *)
+(*    Gabriel Santamaria                                                     *)
+(*                                                                           *)
+(*                                                                           *)
+(*  Licensed under the Apache License, Version 2.0 (the "License");          *)
+(*  you may not use this file except in compliance with the License.         *)
+(*  You may obtain a copy of the License at                                  *)
+(*                                                                           *)
+(*    http://www.apache.org/licenses/LICENSE-2.0                             *)
+(*                                                                           *)
+(*  Unless required by applicable law or agreed to in writing, software      *)
+(*  distributed under the License is distributed on an "AS IS" BASIS,        *)
+(*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *)
+(*  See the License for the specific language governing permissions and      *)
+(*  limitations under the License.                                           *)
+(*                                                                           *)
+(*****************************************************************************)
+
+(**
+    Native FLAC bitstream encoder used by {!Io.write}. Frames are independent
+    from each other, which allows them to be encoded in parallel before being
+    written in order. *)
+
+val header_size : int
+(**
+    Size in bytes of the stream marker and the STREAMINFO block. *)
+
+val max_sample_rate : int
+(**
+    Highest sample rate, in Hz, of a FLAC stream. *)
+
+val max_total : int
+(**
+    Bound, excluded, of the number of samples per channel of a FLAC stream. *)
+
+val encode_frame :
+  bps:int -> channels:int -> frame_number:int -> int array -> string
+(**
+    [encode_frame ~bps ~channels ~frame_number x] encodes the interleaved
+    samples [x], quantized on [~bps] bits, as the FLAC frame [~frame_number].
+    Each subframe uses the best of the constant, fixed, LPC and verbatim
+    encodings. *)
+
+(**
+    Incremental MD5 digests, as used for the signature of the unencoded
+    samples in STREAMINFO. *)
+module Md5 : sig
+  type t
+
+  val create : unit -> t
+
+  val feed : t -> Bytes.t -> unit
+  (** [feed h bytes] appends [bytes] to the message digested by [h] *)
+
+  val finish : t -> string
+  (**
+      [finish h] returns the 16 bytes digest of the message. [h] must not be
+      used afterwards. *)
+end
+
+val header :
+     block_size:int
+  -> min_frame:int
+  -> max_frame:int
+  -> sample_rate:int
+  -> channels:int
+  -> bps:int
+  -> total:int
+  -> md5:string
+  -> Bytes.t
+(**
+    [header ~block_size ~min_frame ~max_frame ~sample_rate ~channels ~bps
+    ~total ~md5] returns the stream marker followed by the STREAMINFO block,
+    [~total] being the number of samples per channel and [~md5] the MD5
+    digest of the unencoded samples.
+
+    Raises [Invalid_argument] if [~sample_rate] is not in
+    [\[1; max_sample_rate\]] or if [~total] is not lower than {!max_total}. *)
@@ -29,83 +29,235 @@ module FrameToS32Bytes =
 module FloatArrayToFrame =
   Swresample.Make (Swresample.FloatArray) (Swresample.Frame)
 
-let read_metadata (filename : string) (format : string) : Metadata.t =
-  let open Avcodec in
-  let format =
-    match Av.Format.find_input_format format with
-    | Some f ->
-        f
-    | None ->
-        raise (Invalid_argument ("Could not find format: " ^ format))
+let find_input_format (format : string) =
+  match Av.Format.find_input_format format with
+  | Some f ->
+      f
+  | None ->
+      raise (Invalid_argument ("Could not find format: " ^ format))
+
+(* growable buffer holding the decoded samples of a stream *)
+type samples =
+  { mutable buf:
+      (float, Bigarray.float32_elt, Bigarray.c_layout) Bigarray.Array1.t
+  ; mutable len: int }
+
+let samples_create (capacity : int) : samples =
+  let buf =
+    Bigarray.Array1.create Bigarray.Float32 Bigarray.c_layout (max 1 capacity)
+  in
+  {buf; len= 0}
+
+(* appends the samples of format [fmt] contained in [bytes], multiplied by
+   [scale], at the end of [s] *)
+let samples_push (s : samples) (fmt : Pcm.format) (scale : float)
+    (bytes : Bytes.t) : unit =
+  let n = Bytes.length bytes / Pcm.width fmt in
+  ( if s.len + n > Bigarray.Array1.dim s.buf then
+      let capacity = max (s.len + n) (2 * Bigarray.Array1.dim s.buf) in
+      let buf =
+        Bigarray.Array1.create Bigarray.Float32 Bigarray.c_layout capacity
+      in
+      Bigarray.Array1.(blit (sub s.buf 0 s.len) (sub buf 0 s.len)) ;
+      s.buf <- buf ) ;
+  s.len <- s.len + Pcm.decode fmt ~scale bytes s.buf s.len
+
+(* format of the samples produced by [FrameToS32Bytes] *)
+let s32 = Pcm.S32 Pcm.native
+
+let samples_data (s : samples) : (float, Bigarray.float32_elt) G.t =
+  Bigarray.Array1.sub s.buf 0 s.len |> Bigarray.genarray_of_array1
+
+(* metadata of a decoded stream, along with the factor the decoded samples
+   are multiplied by *)
+let stream_meta (filename : string) (icodec : Avutil.audio Avcodec.params) :
+    Metadata.t * float =
+  let sr = Avcodec.Audio.get_sample_rate icodec in
+  let nb_channels = Avcodec.Audio.get_nb_channels icodec in
+  let bit_rate = Avcodec.Audio.get_bit_rate icodec in
+  let sample_width = bit_rate / (nb_channels * sr) in
+  let bit_depth = bit_rate / (sr * nb_channels) in
+  ( Metadata.create ~name:filename nb_channels sample_width sr bit_rate
+  , 1. /. (Float.pow 2. (float_of_int bit_depth) -. 1.) )
+
+(* we're a bit over-evaluating the number of samples of the stream to alloc
+   enought memory just before starting the reading process *)
+let estimated_samples (meta : Metadata.t) (duration : Int64.t) : int =
+  let nsamples =
+    Int64.to_float duration
+    *. float_of_int (Metadata.sample_rate meta)
+    *. Float.pow 10. (-3.)
+    *. float_of_int (Metadata.channels meta)
   in
+  int_of_float (nsamples *. 1.01)
+
+let read_metadata (filename : string) (format : string) : Metadata.t =
+  let format = find_input_format format in
   let input = Av.open_input ~format filename in
   let _, _, icodec = Av.find_best_audio_stream input in
-  let sr = Audio.get_sample_rate icodec in
-  let channels = Audio.get_nb_channels icodec in
-  let bit_rate = Audio.get_bit_rate icodec in
-  let sample_width = Audio.get_bit_rate icodec / (channels * sr) in
   Av.close input ;
   Gc.full_major () ;
-  Metadata.create ~name:filename channels sample_width sr bit_rate
+  fst (stream_meta filename icodec)
 
-let read (filename : string) (format : string) : audio =
+let read ?(pipelined : bool = false) (filename : string) (format : string) :
+    audio =
   let open Avcodec in
-  let format =
-    match Av.Format.find_input_format format with
-    | Some f ->
-        f
-    | None ->
-        raise (Invalid_argument ("Could not find format: " ^ format))
-  in
+  let format = find_input_format format in
   let input = Av.open_input ~format filename in
   let idx, istream, icodec = Av.find_best_audio_stream input in
   let out_sr = Audio.get_sample_rate icodec in
   let channels = Audio.get_channel_layout icodec in
-  let nb_channels = Audio.get_nb_channels icodec in
   let options = [`Engine_soxr] in
   let rsp = FrameToS32Bytes.from_codec ~options icodec channels out_sr in
   let duration = Av.get_duration ~format:`Millisecond istream in
-  let bit_rate = Audio.get_bit_rate icodec in
-  let sample_width = Audio.get_bit_rate icodec / (nb_channels * out_sr) in
-  let bit_depth = bit_rate / (out_sr * nb_channels) in
-  (* number of samples in the audio file *)
-  let nsamples =
-    Int64.to_float duration *. float_of_int out_sr *. Float.pow 10. (-3.)
-    *. float_of_int nb_channels
+  let meta, scale = stream_meta filename icodec in
+  let samples = samples_create (estimated_samples meta duration) in
+  let store frame =
+    FrameToS32Bytes.convert rsp frame |> samples_push samples s32 scale
   in
-  (* we're a bit over-evaluating the size of the number of samples to alloc
-     enought memory just before starting the reading process *)
-  let data = G.create Bigarray.Float32 [|int_of_float (nsamples *. 1.01)|] 0. in
-  (* number of read samples during the process *)
-  let rsamples = ref 0 in
-  (* each recursive call decodes a single frame *)
-  let rec decode_frames () : unit =
-    match Av.read_input ~audio_frame:[istream] input with
-    | `Audio_frame (i, frame) when i = idx ->
-        let bytes = FrameToS32Bytes.convert rsp frame in
-        let length = Bytes.length bytes in
-        for i = 0 to length / 4 do
-          let offset = i * 4 in
-          if offset + 4 <= length then (
-            let value = Int32.to_float (Bytes.get_int32_ne bytes offset) in
-            G.set data [|!rsamples|] value ;
-            incr rsamples )
-        done ;
-        decode_frames ()
-    | exception Avutil.Error `Eof ->
-        ()
-    | _ ->
-        decode_frames ()
-  in
-  decode_frames () ;
+  ( if pipelined then (
+      (* the producer domain demuxes and decodes the frames while the calling
+         domain resamples and stores them *)
+      let queue = Parallel.Spsc.create 64 in
+      let rec produce () : unit =
+        match Av.read_input ~audio_frame:[istream] input with
+        | `Audio_frame (i, frame) when i = idx ->
+            Parallel.Spsc.push queue (`Frame frame) ;
+            produce ()
+        | exception Avutil.Error `Eof ->
+            Parallel.Spsc.push queue `Eof
+        | exception e ->
+            Parallel.Spsc.push queue (`Failed e)
+        | _ ->
+            produce ()
+      in
+      let producer = Domain.spawn produce in
+      (* after a failure we keep on draining the queue so that the producer
+         never spins on it forever *)
+      let rec consume (failure : exn option) : exn option =
+        match Parallel.Spsc.pop queue with
+        | `Frame frame -> (
+          match failure with
+          | Some _ ->
+              consume failure
+          | None ->
+              consume (try store frame ; None with e -> Some e) )
+        | `Eof ->
+            failure
+        | `Failed e ->
+            Some (Option.value failure ~default:e)
+      in
+      let failure = consume None in
+      Domain.join producer ;
+      Option.iter raise failure )
+    else
+      (* each recursive call decodes a single frame *)
+      let rec decode_frames () : unit =
+        match Av.read_input ~audio_frame:[istream] input with
+        | `Audio_frame (i, frame) when i = idx ->
+            store frame ; decode_frames ()
+        | exception Avutil.Error `Eof ->
+            ()
+        | _ ->
+            decode_frames ()
+      in
+      decode_frames () ) ;
   Av.get_input istream |> Av.close ;
   Gc.full_major () ;
-  let data = G.resize data [|!rsamples|] in
-  G.div_scalar_ ~out:data data (Float.pow 2. (float_of_int bit_depth) -. 1.) ;
-  let meta =
-    Metadata.create ~name:filename nb_channels sample_width out_sr bit_rate
+  create meta icodec (samples_data samples)
+
+(* state of a single stream decoded by [read_all_streams] *)
+type stream_decoder =
+  { icodec: Avutil.audio Avcodec.params
+  ; decoder: Avutil.audio Avcodec.decoder
+  ; rsp: FrameToS32Bytes.t
+  ; scale: float
+  ; samples: samples }
+
+let read_all_streams ?(domains : int = Parallel.default_domains ())
+    (filename : string) (format : string) : audio list =
+  let format = find_input_format format in
+  let input = Av.open_input ~format filename in
+  let streams = Av.get_audio_streams input in
+  if List.is_empty streams then (
+    Av.close input ;
+    raise (Invalid_argument ("No audio stream found in: " ^ filename)) ) ;
+  let decoders =
+    List.map
+      (fun (_, istream, icodec) ->
+        let codec =
+          Avcodec.Audio.find_decoder (Avcodec.Audio.get_params_id icodec)
+        in
+        let decoder = Avcodec.Audio.create_decoder ~params:icodec codec in
+        let channels = Avcodec.Audio.get_channel_layout icodec in
+        let sr = Avcodec.Audio.get_sample_rate icodec in
+        let rsp =
+          FrameToS32Bytes.from_codec ~options:[`Engine_soxr] icodec channels sr
+        in
+        let meta, scale = stream_meta filename icodec in
+        let duration = Av.get_duration ~format:`Millisecond istream in
+        let samples = samples_create (estimated_samples meta duration) in
+        {icodec; decoder; rsp; scale; samples} )
+      streams
+    |> Array.of_list
+  in
+  (* stream indexes inside the container, mapped to their slot in [decoders] *)
+  let slots = Hashtbl.create 8 in
+  List.iteri (fun slot (idx, _, _) -> Hashtbl.replace slots idx slot) streams ;
+  (* the packets of each stream go through an unbounded channel, so that the
+     demuxer never blocks and the decoders always end, whatever the number of
+     pool domains left to run them *)
+  let chans = Array.map (fun _ -> Parallel.Chan.create max_int) decoders in
+  let istreams = List.map (fun (_, istream, _) -> istream) streams in
+  let demux () : unit =
+    let rec loop () =
+      match Av.read_input ~audio_packet:istreams input with
+      | `Audio_packet (i, packet) ->
+          ( match Hashtbl.find_opt slots i with
+          | Some slot ->
+              Parallel.Chan.push chans.(slot) (`Packet packet)
+          | None ->
+              () ) ;
+          loop ()
+      | exception Avutil.Error `Eof ->
+          ()
+      | _ ->
+          loop ()
+    in
+    Fun.protect
+      ~finally:(fun () -> Array.iter (fun c -> Parallel.Chan.push c `Eof) chans)
+      loop
+  in
+  let decode (slot : int) : unit =
+    let d = decoders.(slot) in
+    let push frame =
+      FrameToS32Bytes.convert d.rsp frame |> samples_push d.samples s32 d.scale
+    in
+    let rec loop () =
+      match Parallel.Chan.pop chans.(slot) with
+      | `Packet packet ->
+          Avcodec.decode d.decoder push packet ;
+          loop ()
+      | `Eof ->
+          ()
+    in
+    loop () ;
+    Avcodec.flush_decoder d.decoder push
   in
-  create meta icodec data
+  (* the job 0 demuxes the container and the job [slot + 1] decodes the stream
+     at [slot]; jobs are handed out in order, so the demuxer has always started
+     when a decoder waits for its packets *)
+  ( try
+      Parallel.parallel_for ~domains
+        (Array.length decoders + 1)
+        (fun job -> if job = 0 then demux () else decode (job - 1))
+    with e -> Av.close input ; raise e ) ;
+  Av.close input ;
+  Gc.full_major () ;
+  Array.to_list decoders
+  |> List.map (fun d ->
+         let meta, _ = stream_meta filename d.icodec in
+         create meta d.icodec (samples_data d.samples) )
 
 module type Writer = sig
   type t
@@ -119,6 +271,7 @@ module type Writer = sig
     -> Avutil.Sample_format.t * Avutil.Sample_format.t
     -> int * int
     -> Avcodec.encode Avcodec.Audio.t
+    -> Quantize.dither * Quantize.shaping
     -> t
 
   val convert : t -> float array -> Bytes.t
@@ -140,7 +293,9 @@ module GenericWriter : Writer = struct
   (* everything is handled by ffmpeg *)
   let header_size = 0
 
-  let create channel_layout channels tb (in_sf, out_sf) (in_sr, out_sr) ocodec =
+  (* ffmpeg handles the conversion of the float samples by itself *)
+  let create channel_layout channels tb (in_sf, out_sf) (in_sr, out_sr) ocodec _
+      =
     let open Avcodec in
     let encoder =
       Audio.create_encoder ~channel_layout ~channels ~time_base:tb
@@ -198,54 +353,36 @@ module WavWriter : Writer = struct
 
   let header_size = 44
 
-  let create_converter (format : Avutil.Sample_format.t) =
-    let func (to_bytes : float -> Bytes.t) (slice : float array) =
-      let bytes = ref Bytes.empty in
-      for i = 0 to Array.length slice - 1 do
-        let data = slice.(i) in
-        let conv = to_bytes data in
-        bytes := Bytes.cat !bytes conv
-      done ;
-      !bytes
+  let create_converter (format : Avutil.Sample_format.t) (channels : int)
+      (dither, shaping) =
+    let quantizer bits = Quantize.create ~dither ~shaping ~bits ~channels () in
+    let func (fmt : Pcm.format) =
+      let q = quantizer (Pcm.bits fmt) in
+      let module K = (val Pcm.kernels fmt) in
+      (* position of the next sample in the stream, used to seed the dither *)
+      let offset = ref 0 in
+      fun (slice : float array) ->
+        let x = Quantize.quantize q ~offset:!offset slice in
+        offset := !offset + Array.length slice ;
+        K.encode x
     in
+    (* WAV files are always little-endian *)
     match format with
     | `Dbl | `Dblp | `Flt | `Fltp | `None ->
         raise (Invalid_argument "Unsupported format")
     | `S16 | `S16p ->
-        let to_bytes (data : float) =
-          let data = int_of_float (data *. (Float.pow 2. 15. -. 1.)) in
-          let bytes = Bytes.create 2 in
-          Bytes.set_int16_ne bytes 0 data ;
-          bytes
-        in
-        (func to_bytes, 16)
+        (func Pcm.(S16 Little), 16)
     | `S32 | `S32p ->
-        let to_bytes (data : float) =
-          let data = Int32.of_float (data *. (Float.pow 2. 31. -. 1.)) in
-          let bytes = Bytes.create 4 in
-          Bytes.set_int32_ne bytes 0 data ;
-          bytes
-        in
-        (func to_bytes, 32)
+        (func Pcm.(S32 Little), 32)
     | `S64 | `S64p ->
-        let to_bytes (data : float) =
-          let data = Int64.of_float (data *. (Float.pow 2. 63. -. 1.)) in
-          let bytes = Bytes.create 8 in
-          Bytes.set_int64_ne bytes 0 data ;
-          bytes
-        in
-        (func to_bytes, 64)
+        (func Pcm.(S64 Little), 64)
     | `U8 | `U8p ->
-        let to_bytes (data : float) =
-          let data = int_of_float data in
-          let bytes = Bytes.create 1 in
-          Bytes.set_int8 bytes 0 data ;
-          bytes
-        in
-        (func to_bytes, 8)
+        (func Pcm.U8, 8)
 
-  let create _ channels _ (_, format) (_, sample_rate) _ =
-    let converter, bits_per_sample = create_converter format in
+  let create _ channels _ (_, format) (_, sample_rate) _ quantization =
+    let converter, bits_per_sample =
+      create_converter format channels quantization
+    in
     let block_align = channels * bits_per_sample / 8 in
     let byte_rate = sample_rate * block_align in
     let header =
@@ -267,18 +404,18 @@ module WavWriter : Writer = struct
     (* Note: these values are only for PCM *)
     let header = Bytes.create 44 in
     Bytes.blit_string "RIFF" 0 header 0 4 ;
-    Bytes.set_int32_ne header 4 (Int32.of_int (w.header.data_size + 36)) ;
+    Bytes.set_int32_le header 4 (Int32.of_int (w.header.data_size + 36)) ;
     Bytes.blit_string "WAVE" 0 header 8 4 ;
     Bytes.blit_string "fmt " 0 header 12 4 ;
-    Bytes.set_int32_ne header 16 (Int32.of_int 16) ;
-    Bytes.set_int16_ne header 20 1 ;
-    Bytes.set_int16_ne header 22 w.header.channels ;
-    Bytes.set_int32_ne header 24 (Int32.of_int w.header.sample_rate) ;
-    Bytes.set_int32_ne header 28 (Int32.of_int w.header.byte_rate) ;
-    Bytes.set_int16_ne header 32 w.header.block_align ;
-    Bytes.set_int16_ne header 34 w.header.bits_per_sample ;
+    Bytes.set_int32_le header 16 (Int32.of_int 16) ;
+    Bytes.set_int16_le header 20 1 ;
+    Bytes.set_int16_le header 22 w.header.channels ;
+    Bytes.set_int32_le header 24 (Int32.of_int w.header.sample_rate) ;
+    Bytes.set_int32_le header 28 (Int32.of_int w.header.byte_rate) ;
+    Bytes.set_int16_le header 32 w.header.block_align ;
+    Bytes.set_int16_le header 34 w.header.bits_per_sample ;
     Bytes.blit_string "data" 0 header 36 4 ;
-    Bytes.set_int32_ne header 40 (Int32.of_int (w.header.data_size + 44)) ;
+    Bytes.set_int32_le header 40 (Int32.of_int (w.header.data_size + 44)) ;
     header
 
   let frame_size _ = 512
@@ -286,16 +423,117 @@ module WavWriter : Writer = struct
   let flush _ = Bytes.empty
 end
 
+(* Native FLAC writer: frames are buffered and encoded in parallel, then
+   written in order *)
+module FlacWriter : Writer = struct
+  type t =
+    { channels: int
+    ; sample_rate: int
+    ; bps: int
+    ; quantizer: Quantize.t
+    ; pcm: Pcm.format
+    ; batch: int
+    ; mutable pending: int array list (* in reverse order *)
+    ; mutable frame_number: int
+    ; mutable total: int
+    ; mutable min_frame: int
+    ; mutable max_frame: int
+    ; md5: Flac.Md5.t }
+
+  let header_size = Flac.header_size
+
+  (* number of frames per channel inside a FLAC frame *)
+  let block_size = 4096
+
+  let create _ channels _ (_, format) (sample_rate, _) _ (dither, shaping) =
+    if channels < 1 || channels > 8 then
+      raise
+        (Invalid_argument "FLAC streams can only hold from 1 to 8 channels") ;
+    if sample_rate <= 0 || sample_rate > Flac.max_sample_rate then
+      raise
+        (Invalid_argument
+           "FLAC streams can only have sample rates from 1 to 655350 Hz" ) ;
+    let bps =
+      match format with
+      | `U8 | `U8p ->
+          8
+      | `S32 | `S32p | `S64 | `S64p | `Flt | `Fltp | `Dbl | `Dblp ->
+          24
+      | _ ->
+          16
+    in
+    { channels
+    ; sample_rate
+    ; bps
+    ; quantizer= Quantize.create ~dither ~shaping ~bits:bps ~channels ()
+    ; pcm= Pcm.(match bps with 8 -> S8 | 24 -> S24 Little | _ -> S16 Little)
+    ; batch= 4 * Parallel.default_domains ()
+    ; pending= []
+    ; frame_number= 0
+    ; total= 0
+    ; min_frame= max_int
+    ; max_frame= 0
+    ; md5= Flac.Md5.create () }
+
+  let encode_pending (w : t) : Bytes.t =
+    let frames = Array.of_list (List.rev w.pending) in
+    let first = w.frame_number in
+    let encoded =
+      Parallel.map
+        (fun (i, x) ->
+          Flac.encode_frame ~bps:w.bps ~channels:w.channels
+            ~frame_number:(first + i) x )
+        (Array.mapi (fun i x -> (i, x)) frames)
+    in
+    w.pending <- [] ;
+    w.frame_number <- first + Array.length frames ;
+    let buf = Buffer.create (1 lsl 16) in
+    Array.iter
+      (fun frame ->
+        let len = String.length frame in
+        w.min_frame <- min w.min_frame len ;
+        w.max_frame <- max w.max_frame len ;
+        Buffer.add_string buf frame )
+      encoded ;
+    Buffer.to_bytes buf
+
+  let convert (w : t) (slice : float array) : Bytes.t =
+    let offset = w.total * w.channels in
+    let x = Quantize.quantize w.quantizer ~offset slice in
+    (* the MD5 signature is computed on signed little-endian samples *)
+    Pcm.encode w.pcm x |> Flac.Md5.feed w.md5 ;
+    w.total <- w.total + (Array.length x / w.channels) ;
+    if w.total >= Flac.max_total then
+      raise (Invalid_argument "FLAC streams can only hold 2^36 - 1 frames") ;
+    w.pending <- x :: w.pending ;
+    if List.length w.pending >= w.batch then encode_pending w else Bytes.empty
+
+  (* a stream without any frame has its frame sizes marked as unknown *)
+  let get_header (w : t) : Bytes.t =
+    let min_frame = if w.min_frame = max_int then 0 else w.min_frame in
+    Flac.header ~block_size ~min_frame ~max_frame:w.max_frame
+      ~sample_rate:w.sample_rate ~channels:w.channels ~bps:w.bps
+      ~total:w.total ~md5:(Flac.Md5.finish w.md5)
+
+  let frame_size (w : t) = block_size * w.channels
+
+  let flush (w : t) = encode_pending w
+end
+
 let get_writer (format : string) : (module Writer) =
   match format with
   | "wav" ->
       (module WavWriter : Writer)
+  | "flac" ->
+      (module FlacWriter : Writer)
   | "aiff" ->
       raise (Invalid_argument "AIFF format is not supported yet.")
   | _ ->
       (module GenericWriter : Writer)
 
-let write (a : audio) (filename : string) (ext : string) : unit =
+let write ?(dither : Quantize.dither = Quantize.NoDither)
+    ?(shaping : Quantize.shaping = Quantize.NoShaping) (a : audio)
+    (filename : string) (ext : string) : unit =
   let open Avcodec in
   let format =
     match Av.Format.guess_output_format ~short_name:ext ~filename () with
@@ -305,12 +543,23 @@ let write (a : audio) (filename : string) (ext : string) : unit =
         raise (Invalid_argument ("Could not find format: " ^ ext))
   in
   let ocodec = Av.Format.get_audio_codec_id format |> Audio.find_encoder in
-  (* we first need to gather data about the codec used to decode the file *)
-  let icodec = codec a in
-  let in_cl = Audio.get_channel_layout icodec in
-  let channels = Audio.get_nb_channels icodec in
-  let in_sample_rate = Audio.get_sample_rate icodec in
-  let in_sample_format = Audio.get_sample_format icodec in
+  (* we first need to gather data about the codec used to decode the file,
+     audio that wasn't decoded from a file being described by its metadata *)
+  let in_cl, channels, in_sample_rate, in_sample_format =
+    match codec_opt a with
+    | Some icodec ->
+        ( Audio.get_channel_layout icodec
+        , Audio.get_nb_channels icodec
+        , Audio.get_sample_rate icodec
+        , Audio.get_sample_format icodec )
+    | None ->
+        let m = meta a in
+        let channels = Metadata.channels m in
+        ( Avutil.Channel_layout.get_default channels
+        , channels
+        , Metadata.sample_rate m
+        , `Dbl )
+  in
   let out_sample_format = Audio.find_best_sample_format ocodec `Dbl in
   let out_sample_rate = Audio.find_best_sample_rate ocodec 44100 in
   let time_base = {Avutil.num= 1; den= in_sample_rate} in
@@ -319,7 +568,7 @@ let write (a : audio) (filename : string) (ext : string) : unit =
     W.create in_cl channels time_base
       (in_sample_format, out_sample_format)
       (in_sample_rate, out_sample_rate)
-      ocodec
+      ocodec (dither, shaping)
   in
   let frame_size = W.frame_size writer in
   let out_file = open_out_bin filename in
@@ -332,27 +581,28 @@ let write (a : audio) (filename : string) (ext : string) : unit =
     W.create in_cl channels time_base
       (in_sample_format, out_sample_format)
       (in_sample_rate, out_sample_rate)
-      ocodec
+      ocodec (dither, shaping)
   in
   let values = data a in
   for i = 0 to length / frame_size do
     let start = i * frame_size in
     let finish = min (start + frame_size) length in
-    let slice = values |> G.get_slice [[start; finish - 1]] |> G.to_array in
-    try W.convert writer slice |> output_bytes out_file with
-    | Avutil.Error e ->
-        Printf.eprintf "Error while encoding data: %s\n"
-          (Avutil.string_of_error e) ;
-        flush stderr ;
-        Gc.full_major () ;
-        Gc.full_major () ;
-        exit 1
-    | _ ->
-        Printf.eprintf "An unknown error occured while encoding the file.\n" ;
-        flush stderr ;
-        Gc.full_major () ;
-        Gc.full_major () ;
-        exit 1
+    if finish > start then
+      let slice = values |> G.get_slice [[start; finish - 1]] |> G.to_array in
+      try W.convert writer slice |> output_bytes out_file with
+      | Avutil.Error e ->
+          Printf.eprintf "Error while encoding data: %s\n"
+            (Avutil.string_of_error e) ;
+          flush stderr ;
+          Gc.full_major () ;
+          Gc.full_major () ;
+          exit 1
+      | _ ->
+          Printf.eprintf "An unknown error occured while encoding the file.\n" ;
+          flush stderr ;
+          Gc.full_major () ;
+          Gc.full_major () ;
+          exit 1
   done ;
   (* flushing the data *)
   W.flush writer |> output_bytes out_file ;
@@ -43,7 +43,8 @@ open Audio
     {2 Writing}
 
     - WAV
-    - MP3 *)
+    - MP3
+    - FLAC (native encoder, frames are encoded in parallel) *)
 
 (**
     {1 Reading data} *)
@@ -62,9 +63,14 @@ val read_metadata : string -> string -> Metadata.t
         (* ... *)
     ]} *)
 
-val read : string -> string -> audio
+val read : ?pipelined:bool -> string -> string -> audio
 (**
-    [read filename format] reads an audio file returns a representation of the file.
+    [read ?pipelined filename format] reads an audio file returns a representation of the file.
+
+    When [?pipelined] is [true] (default is [false]), demuxing and decoding run
+    on a separate domain while the calling one resamples and stores the
+    decoded frames. This almost halves the reading time of large files whose
+    codec makes the conversion step significant.
     
     Example usage:
     
@@ -82,12 +88,47 @@ val read : string -> string -> audio
         (* ... *)
     ]} *)
 
+val read_all_streams : ?domains:int -> string -> string -> audio list
+(**
+    [read_all_streams ?domains filename format] reads every audio stream of the
+    given file and returns one {!Audio.audio} per stream, in the order they
+    appear in the container.
+
+    The file is demuxed only once: the packets of each stream are dispatched to
+    its decoder, the demuxer and the decoders running as jobs of the
+    {!Parallel} pool on up to [?domains] domains (by default
+    {!Parallel.default_domains}). This is useful for multitrack containers
+    such as MKV files with several languages or MXF files with discrete mono
+    tracks.
+
+    Example usage:
+
+    {[
+    let () =
+        let tracks = Io.read_all_streams "file.mkv" "matroska" in
+        List.iteri (fun i track -> Io.write track (Printf.sprintf "track_%d.wav" i) "wav") tracks
+    ]} *)
+
 (**
     {1 Writing data} *)
 
-val write : audio -> string -> string -> unit
+val write :
+     ?dither:Quantize.dither
+  -> ?shaping:Quantize.shaping
+  -> audio
+  -> string
+  -> string
+  -> unit
 (**
-    [write audio filename format] writes an audio file from the given audio data element.
+    [write ?dither ?shaping audio filename format] writes an audio file from the given audio data element.
+
+    When the samples have to be converted to integers (WAV and FLAC), they are
+    rounded and saturated, with the optional [?dither] and noise [?shaping]
+    described in {!Quantize}. By default, none of them are applied.
+
+    Audio elements built by {!Audio.of_generated}, such as the ones made by
+    {!Audio.Gen}, are written with the sample rate and the number of channels
+    of their metadata, using the default channel layout.
     
     Example usage:
     
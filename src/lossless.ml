@@ -0,0 +1,323 @@
+(*****************************************************************************)
+(*                                                                           *)
+(*                                                                           *)
+(*  Copyright (C) 2023                                                       *)
+(*    Gabriel Santamaria                                                     *)
+(*                                                                           *)
+(*                                                                           *)
+(*  Licensed under the Apache License, Version 2.0 (the "License");          *)
+(*  you may not use this file except in compliance with the License.         *)
+(*  You may obtain a copy of the License at                                  *)
+(*                                                                           *)
+(*    http://www.apache.org/licenses/LICENSE-2.0                             *)
+(*                                                                           *)
+(*  Unless required by applicable law or agreed to in writing, software      *)
+(*  distributed under the License is distributed on an "AS IS" BASIS,        *)
+(*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *)
+(*  See the License for the specific language governing permissions and      *)
+(*  limitations under the License.                                           *)
+(*                                                                           *)
+(*****************************************************************************)
+
+module Bitwriter = struct
+  (* [acc] holds the [nbits] pending bits that don't fill a byte yet *)
+  type t = {buf: Buffer.t; mutable acc: int; mutable nbits: int}
+
+  let create (n : int) : t = {buf= Buffer.create n; acc= 0; nbits= 0}
+
+  let bits (w : t) (n : int) (v : int) : unit =
+    w.acc <- (w.acc lsl n) lor (v land ((1 lsl n) - 1)) ;
+    w.nbits <- w.nbits + n ;
+    while w.nbits >= 8 do
+      w.nbits <- w.nbits - 8 ;
+      Buffer.add_char w.buf (Char.unsafe_chr ((w.acc lsr w.nbits) land 0xff))
+    done ;
+    w.acc <- w.acc land ((1 lsl w.nbits) - 1)
+
+  let unary (w : t) (q : int) : unit =
+    let q = ref q in
+    while !q >= 32 do
+      bits w 32 0 ; q := !q - 32
+    done ;
+    bits w (!q + 1) 1
+
+  let zigzag (v : int) : int = (v lsl 1) lxor (v asr (Sys.int_size - 1))
+
+  let rice (w : t) (k : int) (v : int) : unit =
+    let u = zigzag v in
+    unary w (u lsr k) ; bits w k u
+
+  let align (w : t) : unit = if w.nbits > 0 then bits w (8 - w.nbits) 0
+
+  let length (w : t) : int = (Buffer.length w.buf * 8) + w.nbits
+
+  let contents (w : t) : string = align w ; Buffer.contents w.buf
+end
+
+module Bitreader = struct
+  (* [pos] is expressed in bits *)
+  type t = {s: string; mutable pos: int}
+
+  let of_string ?(pos : int = 0) (s : string) : t = {s; pos= pos * 8}
+
+  let bits (r : t) (n : int) : int =
+    let rec go acc n =
+      if n = 0 then acc
+      else
+        let byte = Char.code (String.get r.s (r.pos lsr 3)) in
+        let avail = 8 - (r.pos land 7) in
+        let take = min avail n in
+        let v = (byte lsr (avail - take)) land ((1 lsl take) - 1) in
+        r.pos <- r.pos + take ;
+        go ((acc lsl take) lor v) (n - take)
+    in
+    go 0 n
+
+  let signed (r : t) (n : int) : int =
+    let v = bits r n in
+    if n > 0 && v land (1 lsl (n - 1)) <> 0 then v - (1 lsl n) else v
+
+  let unary (r : t) : int =
+    let rec clz b n = if b land 0x80 <> 0 then n else clz (b lsl 1) (n + 1) in
+    let rec go q =
+      let off = r.pos land 7 in
+      let byte = (Char.code (String.get r.s (r.pos lsr 3)) lsl off) land 0xff in
+      if byte = 0 then (
+        r.pos <- r.pos + 8 - off ;
+        go (q + 8 - off) )
+      else
+        let z = clz byte 0 in
+        r.pos <- r.pos + z + 1 ;
+        q + z
+    in
+    go 0
+
+  let unzigzag (u : int) : int = (u lsr 1) lxor (-(u land 1))
+
+  let rice (r : t) (k : int) : int =
+    let q = unary r in
+    unzigzag ((q lsl k) lor bits r k)
+end
+
+let zigzag = Bitwriter.zigzag
+
+let unzigzag = Bitreader.unzigzag
+
+let rice_parameter (res : int array) (off : int) (n : int) : int =
+  let sum = ref 0 in
+  for i = off to off + n - 1 do
+    sum := !sum + zigzag (Array.unsafe_get res i)
+  done ;
+  (* largest [k] such that [n * 2^k <= sum], ie. [floor (log2 mean)] *)
+  let rec best k = if k < 30 && n lsl (k + 1) <= !sum then best (k + 1) else k in
+  if n = 0 then 0 else best 0
+
+let max_fixed_order = 4
+
+let fixed_order (x : int array) (off : int) (n : int) : int =
+  if n <= max_fixed_order then 0
+  else
+    let sums = Array.make (max_fixed_order + 1) 0 in
+    for i = off + max_fixed_order to off + n - 1 do
+      let x0 = Array.unsafe_get x i
+      and x1 = Array.unsafe_get x (i - 1)
+      and x2 = Array.unsafe_get x (i - 2)
+      and x3 = Array.unsafe_get x (i - 3)
+      and x4 = Array.unsafe_get x (i - 4) in
+      let e1 = x0 - x1 in
+      let e2 = e1 - (x1 - x2) in
+      let e3 = e2 - (x1 - (2 * x2) + x3) in
+      let e4 = e3 - (x1 - (3 * x2) + (3 * x3) - x4) in
+      sums.(0) <- sums.(0) + abs x0 ;
+      sums.(1) <- sums.(1) + abs e1 ;
+      sums.(2) <- sums.(2) + abs e2 ;
+      sums.(3) <- sums.(3) + abs e3 ;
+      sums.(4) <- sums.(4) + abs e4
+    done ;
+    let best = ref 0 in
+    for order = 1 to max_fixed_order do
+      if sums.(order) < sums.(!best) then best := order
+    done ;
+    !best
+
+let fixed_residual (order : int) (x : int array) (off : int) (n : int)
+    (res : int array) : unit =
+  let order = min order n in
+  Array.blit x off res 0 order ;
+  (* one specialised loop per order so that the inner loops don't branch *)
+  match order with
+  | 0 ->
+      Array.blit x off res 0 n
+  | 1 ->
+      for i = 1 to n - 1 do
+        let j = off + i in
+        res.(i) <- x.(j) - x.(j - 1)
+      done
+  | 2 ->
+      for i = 2 to n - 1 do
+        let j = off + i in
+        res.(i) <- x.(j) - (2 * x.(j - 1)) + x.(j - 2)
+      done
+  | 3 ->
+      for i = 3 to n - 1 do
+        let j = off + i in
+        res.(i) <- x.(j) - (3 * x.(j - 1)) + (3 * x.(j - 2)) - x.(j - 3)
+      done
+  | _ ->
+      for i = 4 to n - 1 do
+        let j = off + i in
+        res.(i) <-
+          x.(j)
+          - (4 * x.(j - 1))
+          + (6 * x.(j - 2))
+          - (4 * x.(j - 3))
+          + x.(j - 4)
+      done
+
+let fixed_restore (order : int) (x : int array) (n : int) : unit =
+  match order with
+  | 0 ->
+      ()
+  | 1 ->
+      for i = 1 to n - 1 do
+        x.(i) <- x.(i) + x.(i - 1)
+      done
+  | 2 ->
+      for i = 2 to n - 1 do
+        x.(i) <- x.(i) + (2 * x.(i - 1)) - x.(i - 2)
+      done
+  | 3 ->
+      for i = 3 to n - 1 do
+        x.(i) <- x.(i) + (3 * x.(i - 1)) - (3 * x.(i - 2)) + x.(i - 3)
+      done
+  | _ ->
+      for i = 4 to n - 1 do
+        x.(i) <-
+          x.(i)
+          + (4 * x.(i - 1))
+          - (6 * x.(i - 2))
+          + (4 * x.(i - 3))
+          - x.(i - 4)
+      done
+
+let lpc_coefficients (x : int array) (off : int) (n : int) (order : int) :
+    float array =
+  let half = float_of_int (n - 1) /. 2. in
+  let windowed =
+    Array.init n (fun i ->
+        let t = if half > 0. then (float_of_int i -. half) /. half else 0. in
+        float_of_int x.(off + i) *. (1. -. (t *. t)) )
+  in
+  let r =
+    Array.init (order + 1) (fun lag ->
+        let acc = ref 0. in
+        for i = lag to n - 1 do
+          acc := !acc +. (windowed.(i) *. windowed.(i - lag))
+        done ;
+        !acc )
+  in
+  let a = Array.make order 0. in
+  ( if r.(0) > 0. then
+      let err = ref r.(0) in
+      let prev = Array.make order 0. in
+      try
+        for i = 0 to order - 1 do
+          let acc = ref r.(i + 1) in
+          for j = 0 to i - 1 do
+            acc := !acc -. (a.(j) *. r.(i - j))
+          done ;
+          let k = !acc /. !err in
+          Array.blit a 0 prev 0 i ;
+          for j = 0 to i - 1 do
+            a.(j) <- prev.(j) -. (k *. prev.(i - 1 - j))
+          done ;
+          a.(i) <- k ;
+          err := !err *. (1. -. (k *. k)) ;
+          (* the signal is perfectly predicted, higher orders are useless *)
+          if !err <= 0. then raise Exit
+        done
+      with Exit -> () ) ;
+  a
+
+let quantize_lpc ~(precision : int) (a : float array) : int array * int =
+  let cmax = Array.fold_left (fun acc c -> Float.max acc (Float.abs c)) 0. a in
+  if cmax <= 0. then (Array.map (fun _ -> 0) a, 0)
+  else
+    let _, log2cmax = Float.frexp cmax in
+    let p = precision - 1 in
+    let qmax = (1 lsl p) - 1 and qmin = -(1 lsl p) in
+    let shift = max 0 (min 15 (p - log2cmax)) in
+    let scale = float_of_int (1 lsl shift) in
+    let err = ref 0. in
+    let q =
+      Array.map
+        (fun c ->
+          err := !err +. (c *. scale) ;
+          let q = max qmin (min qmax (int_of_float (Float.round !err))) in
+          err := !err -. float_of_int q ;
+          q )
+        a
+    in
+    (q, shift)
+
+let lpc_residual (q : int array) (shift : int) (x : int array) (off : int)
+    (n : int) (res : int array) : unit =
+  let order = Array.length q in
+  Array.blit x off res 0 (min order n) ;
+  for i = order to n - 1 do
+    let j = off + i in
+    let sum = ref 0 in
+    for k = 0 to order - 1 do
+      sum := !sum + (Array.unsafe_get q k * Array.unsafe_get x (j - k - 1))
+    done ;
+    res.(i) <- x.(j) - (!sum asr shift)
+  done
+
+(* number of residuals sharing the same Rice parameter *)
+let partition_size = 256
+
+(* Layout of a block:
+   - predictor order (3 bits)
+   - [order] warm-up samples ([bits] bits each, signed)
+   - for each partition of the residuals: its Rice parameter (5 bits) followed
+     by the Rice coded residuals *)
+let encode_block ~(bits : int) (x : int array) (off : int) (n : int) : string
+    =
+  let order = min (fixed_order x off n) n in
+  let res = Array.make n 0 in
+  fixed_residual order x off n res ;
+  let w = Bitwriter.create ((n * bits / 16) + 16) in
+  Bitwriter.bits w 3 order ;
+  for i = 0 to order - 1 do
+    Bitwriter.bits w bits res.(i)
+  done ;
+  let start = ref order in
+  while !start < n do
+    let len = min partition_size (n - !start) in
+    let k = rice_parameter res !start len in
+    Bitwriter.bits w 5 k ;
+    for i = !start to !start + len - 1 do
+      Bitwriter.rice w k (Array.unsafe_get res i)
+    done ;
+    start := !start + len
+  done ;
+  Bitwriter.contents w
+
+let decode_block ~(bits : int) (s : string) (x : int array) (n : int) : unit =
+  let r = Bitreader.of_string s in
+  let order = Bitreader.bits r 3 in
+  for i = 0 to order - 1 do
+    x.(i) <- Bitreader.signed r bits
+  done ;
+  (* residuals are first decoded as a whole, then the samples are restored in
+     a single tight loop *)
+  let start = ref order in
+  while !start < n do
+    let len = min partition_size (n - !start) in
+    let k = Bitreader.bits r 5 in
+    for i = !start to !start + len - 1 do
+      Array.unsafe_set x i (Bitreader.rice r k)
+    done ;
+    start := !start + len
+  done ;
+  fixed_restore order x n
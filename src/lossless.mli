@@ -0,0 +1,168 @@
+(*****************************************************************************)
+(*                                                                           *)
+(*                                                                           *)
+(*  Copyright (C) 2023                                                       *)
+(*    Gabriel Santamaria                                                     *)
+(*                                                                           *)
+(*                                                                           *)
+(*  Licensed under the Apache License, Version 2.0 (the "License");          *)
+(*  you may not use this file except in compliance with the License.         *)
+(*  You may obtain a copy of the License at                                  *)
+(*                                                                           *)
+(*    http://www.apache.org/licenses/LICENSE-2.0                             *)
+(*                                                                           *)
+(*  Unless required by applicable law or agreed to in writing, software      *)
+(*  distributed under the License is distributed on an "AS IS" BASIS,        *)
+(*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *)
+(*  See the License for the specific language governing permissions and      *)
+(*  limitations under the License.                                           *)
+(*                                                                           *)
+(*****************************************************************************)
+
+(**
+    The {!Lossless} module contains the building blocks of the lossless
+    integer audio codec used by {!Audio.Compressed}: bit-level input and
+    output, Rice coding of residuals and FLAC-like fixed linear predictors.
+
+    Blocks of samples are encoded independently from each other, so any block
+    can be decoded without touching the others. *)
+
+(**
+    {1 Bit-level input and output} *)
+
+(**
+    Big-endian (most significant bit first) bit writer. *)
+module Bitwriter : sig
+  type t
+
+  val create : int -> t
+  (**
+      [create n] creates a new writer with an initial capacity of [n] bytes. *)
+
+  val bits : t -> int -> int -> unit
+  (**
+      [bits w n v] writes the [n] lowest bits of [v], with [n <= 32]. *)
+
+  val unary : t -> int -> unit
+  (**
+      [unary w q] writes [q] zeros followed by a one. *)
+
+  val rice : t -> int -> int -> unit
+  (**
+      [rice w k v] writes the signed value [v] using a Rice code of parameter
+      [k]. *)
+
+  val align : t -> unit
+  (**
+      [align w] pads the output with zeros up to the next byte boundary. *)
+
+  val length : t -> int
+  (**
+      [length w] returns the number of bits written so far. *)
+
+  val contents : t -> string
+  (**
+      [contents w] aligns [w] and returns the bytes written so far. *)
+end
+
+(**
+    Big-endian (most significant bit first) bit reader. *)
+module Bitreader : sig
+  type t
+
+  val of_string : ?pos:int -> string -> t
+  (**
+      [of_string ?pos s] creates a reader starting at byte [?pos] of [s]. *)
+
+  val bits : t -> int -> int
+  (**
+      [bits r n] reads [n] bits as an unsigned value. *)
+
+  val signed : t -> int -> int
+  (**
+      [signed r n] reads [n] bits as a two's complement signed value. *)
+
+  val unary : t -> int
+  (**
+      [unary r] reads a unary coded value written by {!Bitwriter.unary}. *)
+
+  val rice : t -> int -> int
+  (**
+      [rice r k] reads a signed value written by {!Bitwriter.rice}. *)
+end
+
+(**
+    {1 Residual coding} *)
+
+val zigzag : int -> int
+(**
+    [zigzag v] maps signed integers to unsigned ones ([0, -1, 1, -2, ...] to
+    [0, 1, 2, 3, ...]). *)
+
+val unzigzag : int -> int
+(**
+    [unzigzag u] is the inverse of {!zigzag}. *)
+
+val rice_parameter : int array -> int -> int -> int
+(**
+    [rice_parameter res off n] estimates the optimal Rice parameter to encode
+    the [n] residuals of [res] starting at [off]. *)
+
+(**
+    {1 Fixed linear predictors}
+
+    These are the polynomial predictors of order 0 to 4 used by FLAC. *)
+
+val max_fixed_order : int
+
+val fixed_order : int array -> int -> int -> int
+(**
+    [fixed_order x off n] returns the fixed predictor order that minimises the
+    residual energy of the [n] samples of [x] starting at [off]. *)
+
+val fixed_residual : int -> int array -> int -> int -> int array -> unit
+(**
+    [fixed_residual order x off n res] writes into [res.(0 .. n - 1)] the
+    residuals of the [n] samples of [x] starting at [off]. The first [order]
+    residuals are the samples themselves. *)
+
+val fixed_restore : int -> int array -> int -> unit
+(**
+    [fixed_restore order x n] replaces in place the [n] residuals stored in [x]
+    by the samples they have been computed from. *)
+
+(**
+    {1 Linear predictive coding} *)
+
+val lpc_coefficients : int array -> int -> int -> int -> float array
+(**
+    [lpc_coefficients x off n order] computes the [order] coefficients [a] of
+    the linear predictor [x.(i) ~ sum_j a.(j) * x.(i - j - 1)] of the [n]
+    samples of [x] starting at [off]. The autocorrelation is computed over a
+    Welch window and solved with the Levinson-Durbin recursion. *)
+
+val quantize_lpc : precision:int -> float array -> int array * int
+(**
+    [quantize_lpc ~precision a] quantizes the coefficients [a] on [~precision]
+    signed bits and returns them along with the shift to apply to the
+    prediction. The quantization error is carried over to the next
+    coefficient. *)
+
+val lpc_residual :
+  int array -> int -> int array -> int -> int -> int array -> unit
+(**
+    [lpc_residual q shift x off n res] works like {!fixed_residual} with the
+    quantized predictor [(q, shift)] returned by {!quantize_lpc}. *)
+
+(**
+    {1 Blocks} *)
+
+val encode_block : bits:int -> int array -> int -> int -> string
+(**
+    [encode_block ~bits x off n] encodes the [n] samples of [x] starting at
+    [off]. The samples must fit on [~bits] bits. *)
+
+val decode_block : bits:int -> string -> int array -> int -> unit
+(**
+    [decode_block ~bits s x n] decodes the [n] samples of a block encoded by
+    {!encode_block} into [x.(0 .. n - 1)]. *)
@@ -0,0 +1,279 @@
+(*****************************************************************************)
+(*                                                                           *)
+(*                                                                           *)
+(*  Copyright (C) 2023                                                       *)
+(*    Gabriel Santamaria                                                     *)
+(*                                                                           *)
+(*                                                                           *)
+(*  Licensed under the Apache License, Version 2.0 (the "License");          *)
+(*  you may not use this file except in compliance with the License.         *)
+(*  You may obtain a copy of the License at                                  *)
+(*                                                                           *)
+(*    http://www.apache.org/licenses/LICENSE-2.0                             *)
+(*                                                                           *)
+(*  Unless required by applicable law or agreed to in writing, software      *)
+(*  distributed under the License is distributed on an "AS IS" BASIS,        *)
+(*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *)
+(*  See the License for the specific language governing permissions and      *)
+(*  limitations under the License.                                           *)
+(*                                                                           *)
+(*****************************************************************************)
+
+let default_domains () = Domain.recommended_domain_count ()
+
+(* The worker domains are created on first use and kept for the lifetime of
+   the program, so that per-call helpers never pay for [Domain.spawn] and
+   domain-local state survives from one call to the next. They all pop their
+   jobs from a single queue, and jobs never raise. *)
+let jobs : (unit -> unit) Queue.t = Queue.create ()
+
+let lock = Mutex.create ()
+
+let available = Condition.create ()
+
+let workers : unit Domain.t list ref = ref []
+
+let started = ref false
+
+let closed = ref false
+
+let rec worker () : unit =
+  let job =
+    Mutex.protect lock (fun () ->
+        while Queue.is_empty jobs && not !closed do
+          Condition.wait available lock
+        done ;
+        Queue.take_opt jobs )
+  in
+  match job with Some job -> job () ; worker () | None -> ()
+
+let shutdown () : unit =
+  Mutex.protect lock (fun () ->
+      closed := true ;
+      Condition.broadcast available ) ;
+  List.iter Domain.join !workers ;
+  workers := []
+
+(* must be called with [lock] held; when a spawn fails, the pool keeps the
+   workers that are already running *)
+let start () : unit =
+  if not !started then (
+    started := true ;
+    let rec spawn (k : int) =
+      if k > 0 then
+        match Domain.spawn worker with
+        | d ->
+            workers := d :: !workers ;
+            spawn (k - 1)
+        | exception _ ->
+            ()
+    in
+    spawn (default_domains () - 1) ;
+    at_exit shutdown )
+
+(* runs [work] on the calling domain and on at most [n - 1] workers of the
+   pool, then waits for all of them, re-raising the first exception that
+   occured *)
+let spawn_join (n : int) (work : unit -> unit) : unit =
+  let helpers =
+    if n <= 1 then 0
+    else
+      Mutex.protect lock (fun () ->
+          if !closed then 0
+          else (
+            start () ;
+            min (n - 1) (List.length !workers) ) )
+  in
+  if helpers = 0 then work ()
+  else
+    let pending = ref helpers and failure = ref None in
+    let finished = Condition.create () in
+    let job () =
+      let e = try work () ; None with e -> Some e in
+      Mutex.protect lock (fun () ->
+          if Option.is_none !failure then failure := e ;
+          decr pending ;
+          if !pending = 0 then Condition.broadcast finished )
+    in
+    Mutex.protect lock (fun () ->
+        for _ = 1 to helpers do
+          Queue.push job jobs
+        done ;
+        Condition.broadcast available ) ;
+    let self = try work () ; None with e -> Some e in
+    (* while our jobs are queued we run them, or any other one, ourselves
+       rather than blocking, so that nested calls made from the workers
+       cannot deadlock the pool *)
+    let rec wait () =
+      let next =
+        Mutex.protect lock (fun () ->
+            if !pending = 0 then `Done
+            else
+              match Queue.take_opt jobs with
+              | Some job ->
+                  `Run job
+              | None ->
+                  Condition.wait finished lock ;
+                  `Retry )
+      in
+      match next with
+      | `Done ->
+          ()
+      | `Run job ->
+          job () ; wait ()
+      | `Retry ->
+          wait ()
+    in
+    wait () ;
+    match (self, !failure) with
+    | Some e, _ | None, Some e ->
+        raise e
+    | None, None ->
+        ()
+
+let parallel_for ?(domains : int = default_domains ()) (n : int)
+    (f : int -> unit) : unit =
+  let next = Atomic.make 0 in
+  let rec work () =
+    let i = Atomic.fetch_and_add next 1 in
+    if i < n then (f i ; work ())
+  in
+  if n > 0 then spawn_join (min domains n) work
+
+let map ?(domains : int = default_domains ()) (f : 'a -> 'b) (arr : 'a array)
+    : 'b array =
+  let res = Array.make (Array.length arr) None in
+  parallel_for ~domains (Array.length arr) (fun i ->
+      res.(i) <- Some (f arr.(i)) ) ;
+  Array.map Option.get res
+
+let chunks ?(domains : int = default_domains ()) ~(chunk : int) (n : int)
+    (f : int -> int -> unit) : unit =
+  if chunk <= 0 then invalid_arg "Parallel.chunks: chunk must be positive" ;
+  let count = (n + chunk - 1) / chunk in
+  parallel_for ~domains count (fun i ->
+      let start = i * chunk in
+      f start (min n (start + chunk)) )
+
+module Chan = struct
+  type 'a t =
+    { queue: 'a Queue.t
+    ; capacity: int
+    ; mutex: Mutex.t
+    ; not_empty: Condition.t
+    ; not_full: Condition.t }
+
+  let create (capacity : int) : 'a t =
+    { queue= Queue.create ()
+    ; capacity= max 1 capacity
+    ; mutex= Mutex.create ()
+    ; not_empty= Condition.create ()
+    ; not_full= Condition.create () }
+
+  let push (c : 'a t) (v : 'a) : unit =
+    Mutex.protect c.mutex (fun () ->
+        while Queue.length c.queue >= c.capacity do
+          Condition.wait c.not_full c.mutex
+        done ;
+        Queue.push v c.queue ;
+        Condition.signal c.not_empty )
+
+  let pop (c : 'a t) : 'a =
+    Mutex.protect c.mutex (fun () ->
+        while Queue.is_empty c.queue do
+          Condition.wait c.not_empty c.mutex
+        done ;
+        let v = Queue.pop c.queue in
+        Condition.signal c.not_full ;
+        v )
+end
+
+module Spsc = struct
+  (* [head] is the next slot to read and [tail] the next slot to write, both
+     are only ever increased, by the consumer and the producer respectively.
+     A side that cannot make progress spins for a while, then registers in
+     [sleepers] and waits on [wakeup]; the other side only takes [lock] when
+     someone sleeps *)
+  type 'a t =
+    { buf: 'a option array
+    ; mask: int
+    ; head: int Atomic.t
+    ; tail: int Atomic.t
+    ; sleepers: int Atomic.t
+    ; lock: Mutex.t
+    ; wakeup: Condition.t }
+
+  (* number of failed attempts, with exponentially more [Domain.cpu_relax]
+     between them, before blocking *)
+  let spins = 10
+
+  let create (capacity : int) : 'a t =
+    let rec pow2 n = if n >= capacity then n else pow2 (2 * n) in
+    let size = pow2 1 in
+    { buf= Array.make size None
+    ; mask= size - 1
+    ; head= Atomic.make 0
+    ; tail= Atomic.make 0
+    ; sleepers= Atomic.make 0
+    ; lock= Mutex.create ()
+    ; wakeup= Condition.create () }
+
+  (* the atomics being sequentially consistent, either the sleeper sees the
+     update or we see the sleeper, which cannot miss the broadcast as it
+     holds [lock] until it waits *)
+  let notify (q : 'a t) : unit =
+    if Atomic.get q.sleepers > 0 then
+      Mutex.protect q.lock (fun () -> Condition.broadcast q.wakeup)
+
+  let try_push (q : 'a t) (v : 'a) : bool =
+    let tail = Atomic.get q.tail in
+    if tail - Atomic.get q.head > q.mask then false
+    else (
+      Array.unsafe_set q.buf (tail land q.mask) (Some v) ;
+      Atomic.set q.tail (tail + 1) ;
+      notify q ;
+      true )
+
+  let try_pop (q : 'a t) : 'a option =
+    let head = Atomic.get q.head in
+    if head = Atomic.get q.tail then None
+    else
+      let slot = head land q.mask in
+      let v = Array.unsafe_get q.buf slot in
+      Array.unsafe_set q.buf slot None ;
+      Atomic.set q.head (head + 1) ;
+      notify q ;
+      v
+
+  (* waits until [ready ()] holds *)
+  let await (q : 'a t) (ready : unit -> bool) : unit =
+    let rec spin (k : int) =
+      if ready () then true
+      else if k = spins then false
+      else (
+        for _ = 1 to 1 lsl k do
+          Domain.cpu_relax ()
+        done ;
+        spin (k + 1) )
+    in
+    if not (spin 0) then
+      Mutex.protect q.lock (fun () ->
+          Atomic.incr q.sleepers ;
+          while not (ready ()) do
+            Condition.wait q.wakeup q.lock
+          done ;
+          Atomic.decr q.sleepers )
+
+  let push (q : 'a t) (v : 'a) : unit =
+    if not (try_push q v) then (
+      await q (fun () -> Atomic.get q.tail - Atomic.get q.head <= q.mask) ;
+      ignore (try_push q v : bool) )
+
+  let pop (q : 'a t) : 'a =
+    match try_pop q with
+    | Some v ->
+        v
+    | None ->
+        await q (fun () -> Atomic.get q.head <> Atomic.get q.tail) ;
+        Option.get (try_pop q)
+end
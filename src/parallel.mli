@@ -0,0 +1,111 @@
+(*****************************************************************************)
+(*                                                                           *)
+(*                                                                           *)
+(*  Copyright (C) 2023                                                       *)
+(*    Gabriel Santamaria                                                     *)
+(*                                                                           *)
+(*                                                                           *)
+(*  Licensed under the Apache License, Version 2.0 (the "License");          *)
+(*  you may not use this file except in compliance with the License.         *)
+(*  You may obtain a copy of the License at                                  *)
+(*                                                                           *)
+(*    http://www.apache.org/licenses/LICENSE-2.0                             *)
+(*                                                                           *)
+(*  Unless required by applicable law or agreed to in writing, software      *)
+(*  distributed under the License is distributed on an "AS IS" BASIS,        *)
+(*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *)
+(*  See the License for the specific language governing permissions and      *)
+(*  limitations under the License.                                           *)
+(*                                                                           *)
+(*****************************************************************************)
+
+(**
+    The {!Parallel} module contains the small set of helpers SoundML uses to
+    spread its work across OCaml domains. It is used internally by the
+    decoding, encoding and analysis functions of the library.
+
+    The work is run by a pool of [default_domains () - 1] worker domains,
+    created on the first parallel call and kept until the program exits, and
+    by the calling domain itself. Calls can be nested: a domain waiting for
+    its helpers runs the pending work itself. *)
+
+val default_domains : unit -> int
+(**
+    [default_domains ()] returns the number of domains used by default, which is
+    {!Domain.recommended_domain_count}. *)
+
+val parallel_for : ?domains:int -> int -> (int -> unit) -> unit
+(**
+    [parallel_for ?domains n f] calls [f i] for every [i] in [\[0; n\[], spreading
+    the calls over at most [?domains] domains (the calling one included).
+
+    Indices are handed out dynamically, so [f] can take a different amount of
+    time for each of them. The order in which [f] is called is unspecified. *)
+
+val map : ?domains:int -> ('a -> 'b) -> 'a array -> 'b array
+(**
+    [map ?domains f arr] is [Array.map f arr] where the calls to [f] are spread
+    over at most [?domains] domains. *)
+
+val chunks : ?domains:int -> chunk:int -> int -> (int -> int -> unit) -> unit
+(**
+    [chunks ?domains ~chunk n f] splits [\[0; n\[] in consecutive ranges of
+    [chunk] elements and calls [f start stop] for each of them in parallel, with
+    [stop] being exclusive. *)
+
+(**
+    {1 Communication between domains} *)
+
+(**
+    Bounded blocking FIFO queue, safe to use from any number of domains. *)
+module Chan : sig
+  type 'a t
+
+  val create : int -> 'a t
+  (**
+      [create capacity] creates a new empty channel that can hold up to
+      [capacity] elements. *)
+
+  val push : 'a t -> 'a -> unit
+  (**
+      [push chan v] adds [v] at the end of [chan], blocking while it is full. *)
+
+  val pop : 'a t -> 'a
+  (**
+      [pop chan] removes the first element of [chan], blocking while it is
+      empty. *)
+end
+
+(**
+    Bounded queue with a single producer and a single consumer, lock-free as
+    long as neither side has to wait. It is meant to be used between two
+    domains working in a pipeline, one of them pushing and the other one
+    popping. *)
+module Spsc : sig
+  type 'a t
+
+  val create : int -> 'a t
+  (**
+      [create capacity] creates a new empty queue. The capacity is rounded up
+      to the next power of two. *)
+
+  val try_push : 'a t -> 'a -> bool
+  (**
+      [try_push q v] adds [v] at the end of [q] and returns [true], or returns
+      [false] if [q] is full. Must only be called by the producer. *)
+
+  val try_pop : 'a t -> 'a option
+  (**
+      [try_pop q] removes the first element of [q], if any. Must only be called
+      by the consumer. *)
+
+  val push : 'a t -> 'a -> unit
+  (**
+      [push q v] is like {!try_push} but waits until there is room in [q],
+      spinning for a short while before blocking. *)
+
+  val pop : 'a t -> 'a
+  (**
+      [pop q] is like {!try_pop} but waits until an element is available,
+      spinning for a short while before blocking. *)
+end
@@ -0,0 +1,329 @@
+(*****************************************************************************)
+(*                                                                           *)
+(*                                                                           *)
+(*  Copyright (C) 2023                                                       *)
+(*    Gabriel Santamaria                                                     *)
+(*                                                                           *)
+(*                                                                           *)
+(*  Licensed under the Apache License, Version 2.0 (the "License");          *)
+(*  you may not use this file except in compliance with the License.         *)
+(*  You may obtain a copy of the License at                                  *)
+(*                                                                           *)
+(*    http://www.apache.org/licenses/LICENSE-2.0                             *)
+(*                                                                           *)
+(*  Unless required by applicable law or agreed to in writing, software      *)
+(*  distributed under the License is distributed on an "AS IS" BASIS,        *)
+(*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *)
+(*  See the License for the specific language governing permissions and      *)
+(*  limitations under the License.                                           *)
+(*                                                                           *)
+(*****************************************************************************)
+
+type endianness = Little | Big
+
+type format =
+  | U8
+  | S8
+  | S16 of endianness
+  | S24 of endianness
+  | S32 of endianness
+  | S64 of endianness
+
+let native = if Sys.big_endian then Big else Little
+
+let width = function
+  | U8 | S8 ->
+      1
+  | S16 _ ->
+      2
+  | S24 _ ->
+      3
+  | S32 _ ->
+      4
+  | S64 _ ->
+      8
+
+let bits = function
+  | U8 | S8 ->
+      8
+  | S16 _ ->
+      16
+  | S24 _ ->
+      24
+  | S32 _ | S64 _ ->
+      32
+
+module type FORMAT = sig
+  val width : int
+
+  val get : Bytes.t -> int -> int
+
+  val set : Bytes.t -> int -> int -> unit
+end
+
+module type KERNELS = sig
+  val decode :
+       scale:float
+    -> Bytes.t
+    -> (float, Bigarray.float32_elt, Bigarray.c_layout) Bigarray.Array1.t
+    -> int
+    -> int
+
+  val encode : int array -> Bytes.t
+end
+
+let[@inline] byte (b : Bytes.t) (i : int) : int = Char.code (Bytes.unsafe_get b i)
+
+let[@inline] set_byte (b : Bytes.t) (i : int) (v : int) : unit =
+  Bytes.unsafe_set b i (Char.unsafe_chr (v land 0xff))
+
+(* sign extension of a [n] bits integer *)
+let[@inline] sign (n : int) (v : int) : int =
+  (v lsl (Sys.int_size - n)) asr (Sys.int_size - n)
+
+module U8 = struct
+  let width = 1
+
+  let get b i = byte b i - 128
+
+  let set b i v = set_byte b i (v + 128)
+end
+
+module S8 = struct
+  let width = 1
+
+  let get b i = sign 8 (byte b i)
+
+  let set b i v = set_byte b i v
+end
+
+module S16le = struct
+  let width = 2
+
+  let get b i = sign 16 (byte b i lor (byte b (i + 1) lsl 8))
+
+  let set b i v = set_byte b i v ; set_byte b (i + 1) (v lsr 8)
+end
+
+module S16be = struct
+  let width = 2
+
+  let get b i = sign 16 ((byte b i lsl 8) lor byte b (i + 1))
+
+  let set b i v = set_byte b i (v lsr 8) ; set_byte b (i + 1) v
+end
+
+module S24le = struct
+  let width = 3
+
+  let get b i =
+    sign 24 (byte b i lor (byte b (i + 1) lsl 8) lor (byte b (i + 2) lsl 16))
+
+  let set b i v =
+    set_byte b i v ;
+    set_byte b (i + 1) (v lsr 8) ;
+    set_byte b (i + 2) (v lsr 16)
+end
+
+module S24be = struct
+  let width = 3
+
+  let get b i =
+    sign 24 ((byte b i lsl 16) lor (byte b (i + 1) lsl 8) lor byte b (i + 2))
+
+  let set b i v =
+    set_byte b i (v lsr 16) ;
+    set_byte b (i + 1) (v lsr 8) ;
+    set_byte b (i + 2) v
+end
+
+module S32le = struct
+  let width = 4
+
+  let get b i =
+    sign 32
+      ( byte b i
+      lor (byte b (i + 1) lsl 8)
+      lor (byte b (i + 2) lsl 16)
+      lor (byte b (i + 3) lsl 24) )
+
+  let set b i v =
+    set_byte b i v ;
+    set_byte b (i + 1) (v lsr 8) ;
+    set_byte b (i + 2) (v lsr 16) ;
+    set_byte b (i + 3) (v lsr 24)
+end
+
+module S32be = struct
+  let width = 4
+
+  let get b i =
+    sign 32
+      ( (byte b i lsl 24)
+      lor (byte b (i + 1) lsl 16)
+      lor (byte b (i + 2) lsl 8)
+      lor byte b (i + 3) )
+
+  let set b i v =
+    set_byte b i (v lsr 24) ;
+    set_byte b (i + 1) (v lsr 16) ;
+    set_byte b (i + 2) (v lsr 8) ;
+    set_byte b (i + 3) v
+end
+
+(* 64 bits samples only keep their most significant half *)
+module S64le = struct
+  let width = 8
+
+  let get b i = S32le.get b (i + 4)
+
+  let set b i v = S32le.set b i 0 ; S32le.set b (i + 4) v
+end
+
+module S64be = struct
+  let width = 8
+
+  let get b i = S32be.get b i
+
+  let set b i v = S32be.set b i v ; S32be.set b (i + 4) 0
+end
+
+let check_room dst (pos : int) (n : int) : unit =
+  if pos + n > Bigarray.Array1.dim dst then
+    raise (Invalid_argument "Pcm.decode: destination is too small")
+
+module Make (F : FORMAT) : KERNELS = struct
+  let decode ~(scale : float) (b : Bytes.t) dst (pos : int) : int =
+    let n = Bytes.length b / F.width in
+    check_room dst pos n ;
+    for i = 0 to n - 1 do
+      Bigarray.Array1.unsafe_set dst (pos + i)
+        (float_of_int (F.get b (i * F.width)) *. scale)
+    done ;
+    n
+
+  let encode (x : int array) : Bytes.t =
+    let b = Bytes.create (Array.length x * F.width) in
+    for i = 0 to Array.length x - 1 do
+      F.set b (i * F.width) (Array.unsafe_get x i)
+    done ;
+    b
+end
+
+(* The formats used by the decoders and the WAV and FLAC writers have their
+   loops written out: without flambda, the calls to [F.get] and [F.set] in
+   the functor stay indirect calls. *)
+module KS16le : KERNELS = struct
+  let decode ~(scale : float) (b : Bytes.t) dst (pos : int) : int =
+    let n = Bytes.length b / 2 in
+    check_room dst pos n ;
+    for i = 0 to n - 1 do
+      let j = 2 * i in
+      let v = sign 16 (byte b j lor (byte b (j + 1) lsl 8)) in
+      Bigarray.Array1.unsafe_set dst (pos + i) (float_of_int v *. scale)
+    done ;
+    n
+
+  let encode (x : int array) : Bytes.t =
+    let b = Bytes.create (Array.length x * 2) in
+    for i = 0 to Array.length x - 1 do
+      let v = Array.unsafe_get x i and j = 2 * i in
+      set_byte b j v ;
+      set_byte b (j + 1) (v lsr 8)
+    done ;
+    b
+end
+
+module KS24le : KERNELS = struct
+  let decode ~(scale : float) (b : Bytes.t) dst (pos : int) : int =
+    let n = Bytes.length b / 3 in
+    check_room dst pos n ;
+    for i = 0 to n - 1 do
+      let j = 3 * i in
+      let v =
+        sign 24
+          (byte b j lor (byte b (j + 1) lsl 8) lor (byte b (j + 2) lsl 16))
+      in
+      Bigarray.Array1.unsafe_set dst (pos + i) (float_of_int v *. scale)
+    done ;
+    n
+
+  let encode (x : int array) : Bytes.t =
+    let b = Bytes.create (Array.length x * 3) in
+    for i = 0 to Array.length x - 1 do
+      let v = Array.unsafe_get x i and j = 3 * i in
+      set_byte b j v ;
+      set_byte b (j + 1) (v lsr 8) ;
+      set_byte b (j + 2) (v lsr 16)
+    done ;
+    b
+end
+
+module KS32le : KERNELS = struct
+  let decode ~(scale : float) (b : Bytes.t) dst (pos : int) : int =
+    let n = Bytes.length b / 4 in
+    check_room dst pos n ;
+    for i = 0 to n - 1 do
+      let j = 4 * i in
+      let v =
+        sign 32
+          ( byte b j
+          lor (byte b (j + 1) lsl 8)
+          lor (byte b (j + 2) lsl 16)
+          lor (byte b (j + 3) lsl 24) )
+      in
+      Bigarray.Array1.unsafe_set dst (pos + i) (float_of_int v *. scale)
+    done ;
+    n
+
+  let encode (x : int array) : Bytes.t =
+    let b = Bytes.create (Array.length x * 4) in
+    for i = 0 to Array.length x - 1 do
+      let v = Array.unsafe_get x i and j = 4 * i in
+      set_byte b j v ;
+      set_byte b (j + 1) (v lsr 8) ;
+      set_byte b (j + 2) (v lsr 16) ;
+      set_byte b (j + 3) (v lsr 24)
+    done ;
+    b
+end
+
+module KU8 = Make (U8)
+module KS8 = Make (S8)
+module KS16be = Make (S16be)
+module KS24be = Make (S24be)
+module KS32be = Make (S32be)
+module KS64le = Make (S64le)
+module KS64be = Make (S64be)
+
+let kernels (fmt : format) : (module KERNELS) =
+  match fmt with
+  | U8 ->
+      (module KU8)
+  | S8 ->
+      (module KS8)
+  | S16 Little ->
+      (module KS16le)
+  | S16 Big ->
+      (module KS16be)
+  | S24 Little ->
+      (module KS24le)
+  | S24 Big ->
+      (module KS24be)
+  | S32 Little ->
+      (module KS32le)
+  | S32 Big ->
+      (module KS32be)
+  | S64 Little ->
+      (module KS64le)
+  | S64 Big ->
+      (module KS64be)
+
+let decode (fmt : format) ~(scale : float) (b : Bytes.t) dst (pos : int) : int
+    =
+  let module K = (val kernels fmt) in
+  K.decode ~scale b dst pos
+
+let encode (fmt : format) (x : int array) : Bytes.t =
+  let module K = (val kernels fmt) in
+  K.encode x
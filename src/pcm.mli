@@ -0,0 +1,111 @@
+(*****************************************************************************)
+(*                                                                           *)
+(*                                                                           *)
+(*  Copyright (C) 2023                                                       *)
+(*    Gabriel Santamaria                                                     *)
+(*                                                                           *)
+(*                                                                           *)
+(*  Licensed under the Apache License, Version 2.0 (the "License");          *)
+(*  you may not use this file except in compliance with the License.         *)
+(*  You may obtain a copy of the License at                                  *)
+(*                                                                           *)
+(*    http://www.apache.org/licenses/LICENSE-2.0                             *)
+(*                                                                           *)
+(*  Unless required by applicable law or agreed to in writing, software      *)
+(*  distributed under the License is distributed on an "AS IS" BASIS,        *)
+(*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *)
+(*  See the License for the specific language governing permissions and      *)
+(*  limitations under the License.                                           *)
+(*                                                                           *)
+(*****************************************************************************)
+
+(**
+    The {!Pcm} module contains the conversion kernels between raw PCM bytes
+    and samples used by every reader and writer of {!Io}.
+
+    Each format is described by a small {!FORMAT} module, and the {!Make}
+    functor generates its conversion loops, which read and write the bytes
+    without bound checks. Unless the compiler is built with flambda, the
+    calls to [F.get] and [F.set] inside these loops are not inlined. The
+    little-endian 16, 24 and 32 bits formats, used by the decoders and the
+    writers, therefore have hand-written kernels with no per-sample call. *)
+
+type endianness = Little | Big
+
+(**
+    PCM sample formats. 64 bits samples are handled with their 32 most
+    significant bits. *)
+type format =
+  | U8
+  | S8
+  | S16 of endianness
+  | S24 of endianness
+  | S32 of endianness
+  | S64 of endianness
+
+val native : endianness
+(**
+    Endianness of the machine running the program *)
+
+val width : format -> int
+(**
+    [width fmt] returns the number of bytes of a sample of the given format *)
+
+val bits : format -> int
+(**
+    [bits fmt] returns the number of significant bits of the integers read and
+    written by the kernels of the given format *)
+
+(**
+    {1 Kernels} *)
+
+module type FORMAT = sig
+  val width : int
+
+  val get : Bytes.t -> int -> int
+  (**
+      [get b i] reads the sample starting at the byte [i] of [b] as a signed
+      integer. [b] is not bound checked. *)
+
+  val set : Bytes.t -> int -> int -> unit
+  (**
+      [set b i v] writes the signed integer [v] as the sample starting at the
+      byte [i] of [b]. [b] is not bound checked. *)
+end
+
+module type KERNELS = sig
+  val decode :
+       scale:float
+    -> Bytes.t
+    -> (float, Bigarray.float32_elt, Bigarray.c_layout) Bigarray.Array1.t
+    -> int
+    -> int
+  (**
+      [decode ~scale b dst pos] writes every complete sample of [b] multiplied
+      by [~scale] into [dst], starting at index [pos]. Returns the number of
+      decoded samples. *)
+
+  val encode : int array -> Bytes.t
+  (**
+      [encode x] returns the bytes of the integer samples [x]. *)
+end
+
+module Make (F : FORMAT) : KERNELS
+
+val kernels : format -> (module KERNELS)
+(**
+    [kernels fmt] returns the specialised kernels of the given format *)
+
+val decode :
+     format
+  -> scale:float
+  -> Bytes.t
+  -> (float, Bigarray.float32_elt, Bigarray.c_layout) Bigarray.Array1.t
+  -> int
+  -> int
+(**
+    [decode fmt ~scale b dst pos] is {!KERNELS.decode} for the format [fmt] *)
+
+val encode : format -> int array -> Bytes.t
+(**
+    [encode fmt x] is {!KERNELS.encode} for the format [fmt] *)
@@ -0,0 +1,116 @@
+(*****************************************************************************)
+(*                                                                           *)
+(*                                                                           *)
+(*  Copyright (C) 2023                                                       *)
+(*    Gabriel Santamaria                                                     *)
+(*                                                                           *)
+(*                                                                           *)
+(*  Licensed under the Apache License, Version 2.0 (the "License");          *)
+(*  you may not use this file except in compliance with the License.         *)
+(*  You may obtain a copy of the License at                                  *)
+(*                                                                           *)
+(*    http://www.apache.org/licenses/LICENSE-2.0                             *)
+(*                                                                           *)
+(*  Unless required by applicable law or agreed to in writing, software      *)
+(*  distributed under the License is distributed on an "AS IS" BASIS,        *)
+(*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *)
+(*  See the License for the specific language governing permissions and      *)
+(*  limitations under the License.                                           *)
+(*                                                                           *)
+(*****************************************************************************)
+
+type dither = NoDither | TPDF
+
+type shaping = NoShaping | FirstOrder | Lipshitz
+
+type t =
+  { bits: int
+  ; channels: int
+  ; scale: float
+  ; lo: float
+  ; hi: float
+  ; dither: dither
+  ; seed: int
+  ; coeffs: float array
+  ; errors: float array (* past errors of each channel, most recent first *)
+  }
+
+let create ?(dither : dither = NoDither) ?(shaping : shaping = NoShaping)
+    ?(seed : int = 0) ~(bits : int) ~(channels : int) () : t =
+  if bits < 2 || bits > 32 then
+    raise (Invalid_argument "Quantize.create: bits must be in [2; 32]") ;
+  let coeffs =
+    match shaping with
+    | NoShaping ->
+        [||]
+    | FirstOrder ->
+        [|1.|]
+    | Lipshitz ->
+        [|2.033; -2.165; 1.959; -1.590; 0.6149|]
+  in
+  { bits
+  ; channels
+  ; scale= Float.pow 2. (float_of_int (bits - 1)) -. 1.
+  ; lo= -.Float.pow 2. (float_of_int (bits - 1))
+  ; hi= Float.pow 2. (float_of_int (bits - 1)) -. 1.
+  ; dither
+  ; seed
+  ; coeffs
+  ; errors= Array.make (channels * Array.length coeffs) 0. }
+
+let bits (q : t) = q.bits
+
+let noise (q : t) (pos : int) : float =
+  match q.dither with
+  | NoDither ->
+      0.
+  | TPDF ->
+      Dsp.Rng.uniform q.seed (2 * pos)
+      +. Dsp.Rng.uniform q.seed ((2 * pos) + 1)
+      -. 1.
+
+(* quantizes [x.(start .. stop - 1)] into [out], [x.(start)] being at position
+   [offset] in the stream. [errors] holds the noise shaping filter state. *)
+let quantize_range (q : t) (errors : float array) ~(offset : int)
+    (x : float array) (out : int array) (start : int) (stop : int) : unit =
+  let order = Array.length q.coeffs in
+  match (q.dither, order) with
+  | NoDither, 0 ->
+      (* plain saturating rounding, kept free of any call or branch on the
+         configuration *)
+      for i = start to stop - 1 do
+        let v = Float.round (Array.unsafe_get x i *. q.scale) in
+        let v = Float.min q.hi (Float.max q.lo v) in
+        Array.unsafe_set out i (int_of_float v)
+      done
+  | _ ->
+      for i = start to stop - 1 do
+        let pos = offset + i - start in
+        let base = pos mod q.channels * order in
+        let v = ref (Array.unsafe_get x i *. q.scale) in
+        for k = 0 to order - 1 do
+          v := !v -. (q.coeffs.(k) *. errors.(base + k))
+        done ;
+        let r = Float.round (!v +. noise q pos) in
+        if order > 0 then (
+          for k = order - 1 downto 1 do
+            errors.(base + k) <- errors.(base + k - 1)
+          done ;
+          errors.(base) <- r -. !v ) ;
+        let r = Float.min q.hi (Float.max q.lo r) in
+        Array.unsafe_set out i (int_of_float r)
+      done
+
+let quantize (q : t) ~(offset : int) (x : float array) : int array =
+  let out = Array.make (Array.length x) 0 in
+  quantize_range q q.errors ~offset x out 0 (Array.length x) ;
+  out
+
+let quantize_array ?domains ?(chunk : int = 65536) (q : t) (x : float array) :
+    int array =
+  let n = Array.length x in
+  let out = Array.make n 0 in
+  Parallel.chunks ?domains ~chunk:(chunk * q.channels) n (fun start stop ->
+      let errors = Array.make (Array.length q.errors) 0. in
+      quantize_range q errors ~offset:start x out start stop ) ;
+  out
@@ -0,0 +1,74 @@
+(*****************************************************************************)
+(*                                                                           *)
+(*                                                                           *)
+(*  Copyright (C) 2023                                                       *)
+(*    Gabriel Santamaria                                                     *)
+(*                                                                           *)
+(*                                                                           *)
+(*  Licensed under the Apache License, Version 2.0 (the "License");          *)
+(*  you may not use this file except in compliance with the License.         *)
+(*  You may obtain a copy of the License at                                  *)
+(*                                                                           *)
+(*    http://www.apache.org/licenses/LICENSE-2.0                             *)
+(*                                                                           *)
+(*  Unless required by applicable law or agreed to in writing, software      *)
+(*  distributed under the License is distributed on an "AS IS" BASIS,        *)
+(*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *)
+(*  See the License for the specific language governing permissions and      *)
+(*  limitations under the License.                                           *)
+(*                                                                           *)
+(*****************************************************************************)
+
+(**
+    The {!Quantize} module converts floating point samples into integers
+    before they are written to a file. Samples are rounded to the nearest step
+    and saturated to the integer range, with optional dithering and noise
+    shaping.
+
+    The dither noise is produced by a counter-based generator: the noise added
+    to a sample only depends on the seed and on the position of that sample,
+    which makes the output reproducible however the data is split. *)
+
+type dither = NoDither | TPDF  (** Dither added before rounding *)
+
+(**
+    Noise shaping filter applied to the quantization error. [FirstOrder] pushes
+    the noise towards high frequencies and [Lipshitz] uses the 5 taps
+    E-weighted filter from Lipshitz et al. *)
+type shaping = NoShaping | FirstOrder | Lipshitz
+
+type t
+
+val create :
+     ?dither:dither
+  -> ?shaping:shaping
+  -> ?seed:int
+  -> bits:int
+  -> channels:int
+  -> unit
+  -> t
+(**
+    [create ?dither ?shaping ?seed ~bits ~channels ()] creates a quantizer to
+    signed integers of [~bits] bits (at most 32) for interleaved data of
+    [~channels] channels. A sample of [1.] is mapped to [2^(bits - 1) - 1].
+
+    By default, no dither nor noise shaping is applied. *)
+
+val bits : t -> int
+(**
+    [bits q] returns the number of bits of the produced integers *)
+
+val quantize : t -> offset:int -> float array -> int array
+(**
+    [quantize q ~offset x] quantizes the interleaved samples [x], [~offset]
+    being the position of [x.(0)] in the whole stream. Consecutive calls must
+    be made in order since the noise shaping filter state is kept between
+    them. *)
+
+val quantize_array :
+  ?domains:int -> ?chunk:int -> t -> float array -> int array
+(**
+    [quantize_array ?domains ?chunk q x] quantizes the whole interleaved array
+    [x] in parallel, by chunks of [?chunk] frames (default is [65536]). The
+    noise shaping filter starts from a zero state at the beginning of each
+    chunk, so the result depends on [?chunk] but not on [?domains]. *)
@@ -21,4 +21,7 @@
 
 module Audio = Audio
 module Io = Io
+module Quantize = Quantize
 module Feature = Feature
+module Effects = Effects
+module Analysis = Analysis
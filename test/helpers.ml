@@ -0,0 +1,52 @@
+(*****************************************************************************)
+(*                                                                           *)
+(*                                                                           *)
+(*  Copyright (C) 2023                                                       *)
+(*    Gabriel Santamaria                                                     *)
+(*                                                                           *)
+(*                                                                           *)
+(*  Licensed under the Apache License, Version 2.0 (the "License");          *)
+(*  you may not use this file except in compliance with the License.         *)
+(*  You may obtain a copy of the License at                                  *)
+(*                                                                           *)
+(*    http://www.apache.org/licenses/LICENSE-2.0                             *)
+(*                                                                           *)
+(*  Unless required by applicable law or agreed to in writing, software      *)
+(*  distributed under the License is distributed on an "AS IS" BASIS,        *)
+(*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *)
+(*  See the License for the specific language governing permissions and      *)
+(*  limitations under the License.                                           *)
+(*                                                                           *)
+(*****************************************************************************)
+
+(* fixtures shared by the tests *)
+
+open Soundml
+
+type planar = (float, Bigarray.float32_elt) Audio.G.t
+
+(* audio element holding the interleaved samples [x] *)
+let audio_of ?(sample_rate : int = 44100) ?(channels : int = 1)
+    (x : float array) : Audio.audio =
+  let meta =
+    Audio.Metadata.create ~name:"test" channels 32 sample_rate
+      (32 * sample_rate * channels)
+  in
+  Bigarray.Array1.of_array Bigarray.Float32 Bigarray.c_layout x
+  |> Bigarray.genarray_of_array1 |> Audio.of_generated meta
+
+(* processes [p] in place by consecutive blocks whose sizes cycle through
+   [sizes], and returns the processed blocks put back together *)
+let stream (process : planar -> unit) (sizes : int array) (p : planar) :
+    planar =
+  let frames = (Audio.G.shape p).(1) in
+  let blocks = ref [] and start = ref 0 and b = ref 0 in
+  while !start < frames do
+    let n = min sizes.(!b mod Array.length sizes) (frames - !start) in
+    let block = Audio.G.get_slice [[]; [!start; !start + n - 1]] p in
+    process block ;
+    blocks := block :: !blocks ;
+    start := !start + n ;
+    incr b
+  done ;
+  Audio.G.concatenate ~axis:1 (Array.of_list (List.rev !blocks))
@@ -0,0 +1,101 @@
+(*****************************************************************************)
+(*                                                                           *)
+(*                                                                           *)
+(*  Copyright (C) 2023                                                       *)
+(*    Gabriel Santamaria                                                     *)
+(*                                                                           *)
+(*                                                                           *)
+(*  Licensed under the Apache License, Version 2.0 (the "License");          *)
+(*  you may not use this file except in compliance with the License.         *)
+(*  You may obtain a copy of the License at                                  *)
+(*                                                                           *)
+(*    http://www.apache.org/licenses/LICENSE-2.0                             *)
+(*                                                                           *)
+(*  Unless required by applicable law or agreed to in writing, software      *)
+(*  distributed under the License is distributed on an "AS IS" BASIS,        *)
+(*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *)
+(*  See the License for the specific language governing permissions and      *)
+(*  limitations under the License.                                           *)
+(*                                                                           *)
+(*****************************************************************************)
+
+(* Audio.Compressed must give back the exact samples of audio quantized on
+   its grid, and stay within half a quantization step otherwise *)
+
+open Soundml
+
+let frames = 10_000
+
+let channels = 2
+
+(* a sine followed by white noise, so that the blocks exercise both the
+   predictors and large residuals *)
+let samples () : float array =
+  Random.init 42 ;
+  Array.init (frames * channels) (fun i ->
+      let frame = i / channels in
+      let k =
+        if frame < frames / 2 then
+          let w = 0.05 *. float_of_int (1 + (i mod channels)) in
+          int_of_float (Float.round (20000. *. sin (float_of_int frame *. w)))
+        else Random.int 65536 - 32768
+      in
+      float_of_int k /. 32768. )
+
+(* index of the sample at [ms] milliseconds, as computed by the accessors *)
+let sample_pos (ms : int) : int =
+  int_of_float (float_of_int ms /. 1000. *. 44100. *. float_of_int channels)
+
+let to_array (a : Audio.audio) : float array =
+  let d = Audio.data a in
+  Array.init (Audio.rawsize a) (fun i -> Audio.G.get d [|i|])
+
+let () =
+  let x = samples () in
+  let c =
+    Audio.Compressed.compress ~block_size:1000 (Helpers.audio_of ~channels x)
+  in
+  if Audio.Compressed.rawsize c <> Array.length x then
+    failwith "Compressed: wrong number of samples" ;
+  if Audio.Compressed.size c >= 2 * Array.length x then
+    failwith "Compressed: blocks are larger than the 16 bits samples" ;
+  let y = to_array (Audio.Compressed.to_audio ~domains:4 c) in
+  Array.iteri
+    (fun i v ->
+      if y.(i) <> v then
+        failwith
+          (Printf.sprintf "Compressed: sample %d is %g, not %g" i y.(i) v) )
+    x ;
+  (* positions are given in milliseconds, like for Audio.get_slice; these
+     slices cross block boundaries and some start on odd channels *)
+  List.iter
+    (fun (start, stop) ->
+      let s = to_array (Audio.Compressed.get_slice (start, stop) c) in
+      let first = sample_pos start and last = sample_pos stop in
+      if Array.length s <> last - first + 1 then
+        failwith "Compressed.get_slice: wrong length" ;
+      Array.iteri
+        (fun i v ->
+          if v <> x.(first + i) then
+            failwith
+              (Printf.sprintf "Compressed.get_slice: sample %d differs"
+                 (first + i) ) )
+        s )
+    [(0, 0); (1, 50); (22, 23); (45, 100); (200, 226)] ;
+  if Audio.Compressed.get 100 c <> x.(sample_pos 100) then
+    failwith "Compressed.get: wrong sample"
+
+let () =
+  (* samples outside of the grid are rounded to the nearest step *)
+  let x =
+    Array.init (frames * channels) (fun i ->
+        0.9 *. sin (float_of_int i *. 0.01) )
+  in
+  let c = Audio.Compressed.compress (Helpers.audio_of ~channels x) in
+  let y = to_array (Audio.Compressed.to_audio c) in
+  Array.iteri
+    (fun i v ->
+      if Float.abs (y.(i) -. v) > 0.5 /. 32768. +. 1e-7 then
+        failwith
+          (Printf.sprintf "Compressed: sample %d is %g, not %g" i y.(i) v) )
+    x
@@ -0,0 +1,112 @@
+(*****************************************************************************)
+(*                                                                           *)
+(*                                                                           *)
+(*  Copyright (C) 2023                                                       *)
+(*    Gabriel Santamaria                                                     *)
+(*                                                                           *)
+(*                                                                           *)
+(*  Licensed under the Apache License, Version 2.0 (the "License");          *)
+(*  you may not use this file except in compliance with the License.         *)
+(*  You may obtain a copy of the License at                                  *)
+(*                                                                           *)
+(*    http://www.apache.org/licenses/LICENSE-2.0                             *)
+(*                                                                           *)
+(*  Unless required by applicable law or agreed to in writing, software      *)
+(*  distributed under the License is distributed on an "AS IS" BASIS,        *)
+(*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *)
+(*  See the License for the specific language governing permissions and      *)
+(*  limitations under the License.                                           *)
+(*                                                                           *)
+(*****************************************************************************)
+
+(* the partitioned overlap-save convolution must match the direct
+   convolution, whole or streamed block by block *)
+
+open Soundml
+module Convolution = Effects.Convolution
+
+let sample_rate = 44100
+
+let channels = 2
+
+let frames = 20_000
+
+type planar = Helpers.planar
+
+let tolerance = 1e-4
+
+(* exponentially decaying noise, like a room response *)
+let impulse_response (length : int) : float array =
+  Random.init length ;
+  Array.init length (fun i ->
+      (Random.float 2. -. 1.) *. exp (-.float_of_int i /. 500.) /. 10. )
+
+let input () : Audio.audio =
+  Audio.Gen.noise ~sample_rate ~channels ~amplitude:0.8 ~seed:5
+    Audio.Gen.Pink
+    (float_of_int frames /. float_of_int sample_rate)
+
+let prepare ?block (h : float array) : Convolution.ir =
+  Bigarray.Array1.of_array Bigarray.Float32 Bigarray.c_layout h
+  |> Bigarray.genarray_of_array1 |> Convolution.prepare ?block
+
+(* full convolution of each row of [p] with [h] *)
+let direct (h : float array) (p : planar) : float array array =
+  let n = (Audio.G.shape p).(1) and m = Array.length h in
+  Array.init channels (fun c ->
+      let y = Array.make (n + m - 1) 0. in
+      for i = 0 to n - 1 do
+        let x = Audio.G.get p [|c; i|] in
+        for j = 0 to m - 1 do
+          y.(i + j) <- y.(i + j) +. (x *. h.(j))
+        done
+      done ;
+      y )
+
+(* compares the rows of [p], from frame [first] on, with [expected] *)
+let check (name : string) ?(first : int = 0) (expected : float array array)
+    (p : planar) : unit =
+  let n = (Audio.G.shape p).(1) - first in
+  for c = 0 to channels - 1 do
+    for i = 0 to n - 1 do
+      let e = if i < Array.length expected.(c) then expected.(c).(i) else 0. in
+      let v = Audio.G.get p [|c; first + i|] in
+      if Float.abs (v -. e) > tolerance then
+        failwith
+          (Printf.sprintf "%s: frame %d of channel %d is %g, not %g" name i c v
+             e )
+    done
+  done
+
+let () =
+  let a = input () in
+  let x = Audio.planar a in
+  (* shorter than a block, a multiple of the block size, and neither *)
+  List.iter
+    (fun (length, block) ->
+      let h = impulse_response length in
+      let ir = prepare ~block h in
+      let expected = direct h x in
+      let name = Printf.sprintf "Convolution (%d, %d)" length block in
+      let y = Convolution.convolve ir a in
+      if Audio.rawsize y <> Audio.rawsize a then
+        failwith (name ^ ": wrong length") ;
+      check name expected (Audio.planar y) ;
+      let y = Convolution.convolve ~tail:true ir a in
+      if Audio.rawsize y <> channels * (frames + length - 1) then
+        failwith (name ^ ": wrong length with the tail") ;
+      check name expected (Audio.planar y) ;
+      (* streaming with blocks of varying sizes, late by the latency *)
+      let c = Convolution.create ir ~channels in
+      Helpers.stream (Convolution.process c) [|1; 100; block; 3 * block; 7|] x
+      |> check (name ^ " streamed") ~first:(Convolution.latency c) expected
+      )
+    [(100, 256); (2048, 256); (3000, 512); (1, 64)] ;
+  (* every impulse response of a batch gives the result of [convolve] *)
+  let irs = Array.map (fun l -> prepare (impulse_response l)) [|10; 5000|] in
+  Array.iteri
+    (fun i y ->
+      let expected = Convolution.convolve irs.(i) a in
+      if not (Audio.G.equal (Audio.data y) (Audio.data expected)) then
+        failwith "Convolution.convolve_batch: wrong result" )
+    (Convolution.convolve_batch ~domains:2 irs a)
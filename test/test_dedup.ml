@@ -0,0 +1,102 @@
+(*****************************************************************************)
+(*                                                                           *)
+(*                                                                           *)
+(*  Copyright (C) 2023                                                       *)
+(*    Gabriel Santamaria                                                     *)
+(*                                                                           *)
+(*                                                                           *)
+(*  Licensed under the Apache License, Version 2.0 (the "License");          *)
+(*  you may not use this file except in compliance with the License.         *)
+(*  You may obtain a copy of the License at                                  *)
+(*                                                                           *)
+(*    http://www.apache.org/licenses/LICENSE-2.0                             *)
+(*                                                                           *)
+(*  Unless required by applicable law or agreed to in writing, software      *)
+(*  distributed under the License is distributed on an "AS IS" BASIS,        *)
+(*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *)
+(*  See the License for the specific language governing permissions and      *)
+(*  limitations under the License.                                           *)
+(*                                                                           *)
+(*****************************************************************************)
+
+(* a trimmed copy of a recording must be reported as its duplicate, while
+   unrelated recordings must not *)
+
+open Soundml
+module Dedup = Analysis.Dedup
+
+let sample_rate = 22050
+
+(* notes of three harmonic tones with decaying envelopes, changing every 0.15
+   to 0.6 seconds, over a faint noise *)
+let music (seed : int) (duration : float) : float array =
+  let st = Random.State.make [|seed|] in
+  let uniform lo hi = lo +. Random.State.float st (hi -. lo) in
+  let fs = float_of_int sample_rate in
+  let n = int_of_float (duration *. fs) in
+  let x = Array.init n (fun _ -> 0.01 *. uniform (-1.) 1.) in
+  let pos = ref 0 in
+  while !pos < n do
+    let len = int_of_float (uniform 0.15 0.6 *. fs) in
+    let decay = uniform 1. 6. in
+    for _ = 1 to 3 do
+      let note = float_of_int (Random.State.int st 36) in
+      let f0 = 110. *. Float.pow 2. (note /. 12.) in
+      for h = 1 to 7 do
+        let f = f0 *. float_of_int h in
+        let phase = uniform 0. 6. in
+        let amplitude = uniform 0.3 1. /. Float.pow (float_of_int h) 1.2 in
+        if f < fs /. 2. then
+          for i = 0 to min len (n - !pos) - 1 do
+            let t = float_of_int i /. fs in
+            x.(!pos + i) <-
+              x.(!pos + i)
+              +. amplitude *. exp (-.t *. decay)
+                 *. sin ((2. *. Float.pi *. f *. t) +. phase)
+          done
+      done
+    done ;
+    pos := !pos + len
+  done ;
+  let peak = Array.fold_left (fun m v -> Float.max m (Float.abs v)) 0. x in
+  Array.map (fun v -> 0.8 *. v /. peak) x
+
+let audio_of (x : float array) : Audio.audio =
+  Helpers.audio_of ~sample_rate x
+
+(* the same signal on both channels *)
+let stereo (x : float array) : Audio.audio =
+  Array.init (2 * Array.length x) (fun i -> x.(i / 2))
+  |> Helpers.audio_of ~sample_rate ~channels:2
+
+let () =
+  let x = music 1 20. in
+  (* trimmed at both ends by an arbitrary number of samples, quieter, and
+     stereo *)
+  let copy =
+    Array.sub x 3001 (Array.length x - 8001) |> Array.map (( *. ) 0.7)
+  in
+  let audios =
+    [| audio_of x
+     ; audio_of (music 2 20.)
+     ; stereo copy
+     ; audio_of (music 3 15.)
+     ; audio_of (Array.sub x 0 1000) |]
+  in
+  let sketches = Dedup.sketch_all ~domains:2 audios in
+  let s = Dedup.similarity sketches.(0) sketches.(2) in
+  if s < 0.15 then
+    failwith (Printf.sprintf "Dedup: the copy has a similarity of %g" s) ;
+  (* audio too short for any sub-fingerprint is similar to nothing *)
+  if Dedup.similarity sketches.(4) sketches.(4) <> 0. then
+    failwith "Dedup: an empty sketch is similar to itself" ;
+  match Dedup.duplicates ~domains:2 sketches with
+  | [(0, 2, _)] ->
+      ()
+  | pairs ->
+      failwith
+        (Printf.sprintf "Dedup: found the pairs %s instead of (0, 2)"
+           (String.concat ", "
+              (List.map
+                 (fun (i, j, s) -> Printf.sprintf "(%d, %d, %g)" i j s)
+                 pairs ) ) )
@@ -0,0 +1,131 @@
+(*****************************************************************************)
+(*                                                                           *)
+(*                                                                           *)
+(*  Copyright (C) 2023                                                       *)
+(*    Gabriel Santamaria                                                     *)
+(*                                                                           *)
+(*                                                                           *)
+(*  Licensed under the Apache License, Version 2.0 (the "License");          *)
+(*  you may not use this file except in compliance with the License.         *)
+(*  You may obtain a copy of the License at                                  *)
+(*                                                                           *)
+(*    http://www.apache.org/licenses/LICENSE-2.0                             *)
+(*                                                                           *)
+(*  Unless required by applicable law or agreed to in writing, software      *)
+(*  distributed under the License is distributed on an "AS IS" BASIS,        *)
+(*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *)
+(*  See the License for the specific language governing permissions and      *)
+(*  limitations under the License.                                           *)
+(*                                                                           *)
+(*****************************************************************************)
+
+(* FLAC files written by Io.write must decode, through ffmpeg, to the exact
+   samples they were written from *)
+
+open Soundml
+
+module Converter = Swresample.Make (Swresample.Frame) (Swresample.S32Bytes)
+
+let frames = 10_000
+
+let channels = 2
+
+let samples () : float array =
+  Random.init 7 ;
+  Array.init (frames * channels) (fun _ -> Random.float 1.8 -. 0.9)
+
+(* decodes the file with ffmpeg into 32 bits integers *)
+let decode (filename : string) : int * int array =
+  let format = Option.get (Av.Format.find_input_format "flac") in
+  let input = Av.open_input ~format filename in
+  let idx, istream, icodec = Av.find_best_audio_stream input in
+  let rsp =
+    Converter.from_codec icodec
+      (Avcodec.Audio.get_channel_layout icodec)
+      (Avcodec.Audio.get_sample_rate icodec)
+  in
+  let out = Buffer.create (1 lsl 16) in
+  let rec decode_frames () : unit =
+    match Av.read_input ~audio_frame:[istream] input with
+    | `Audio_frame (i, frame) when i = idx ->
+        Buffer.add_bytes out (Converter.convert rsp frame) ;
+        decode_frames ()
+    | exception Avutil.Error `Eof ->
+        ()
+    | _ ->
+        decode_frames ()
+  in
+  decode_frames () ;
+  Av.close input ;
+  let b = Buffer.to_bytes out in
+  ( Avcodec.Audio.get_nb_channels icodec
+  , Array.init (Bytes.length b / 4) (fun i ->
+        Int32.to_int (Bytes.get_int32_ne b (i * 4)) ) )
+
+(* bits per sample and MD5 signature stored in the STREAMINFO block *)
+let streaminfo (filename : string) : int * string =
+  let ic = open_in_bin filename in
+  let header = really_input_string ic 42 in
+  close_in ic ;
+  let byte i = Char.code header.[i] in
+  ( ((byte 20 land 1) lsl 4) + (byte 21 lsr 4) + 1
+  , String.sub header 26 16 )
+
+let () =
+  let a = Helpers.audio_of ~channels (samples ()) in
+  let filename = Filename.temp_file "soundml" ".flac" in
+  Io.write a filename "flac" ;
+  let bps, md5 = streaminfo filename in
+  (* the samples the writer quantized, rounded without dither *)
+  let scale = Float.pow 2. (float_of_int (bps - 1)) -. 1. in
+  let data = Audio.data a in
+  let k =
+    Array.init (Audio.rawsize a) (fun i ->
+        int_of_float (Float.round (Audio.G.get data [|i|] *. scale)) )
+  in
+  let decoded_channels, decoded = decode filename in
+  if decoded_channels <> channels then
+    failwith "FLAC: wrong number of channels" ;
+  if Array.length decoded <> Array.length k then
+    failwith
+      (Printf.sprintf "FLAC: %d samples decoded, %d written"
+         (Array.length decoded) (Array.length k) ) ;
+  let shift = 32 - bps in
+  Array.iteri
+    (fun i v ->
+      if v <> k.(i) lsl shift then
+        failwith
+          (Printf.sprintf "FLAC: sample %d is %d, not %d" i (v asr shift)
+             k.(i) ) )
+    decoded ;
+  (* the signature covers the little-endian samples *)
+  let width = bps / 8 in
+  let pcm = Bytes.create (width * Array.length k) in
+  Array.iteri
+    (fun i v ->
+      for b = 0 to width - 1 do
+        Bytes.set_uint8 pcm ((width * i) + b) ((v asr (8 * b)) land 0xff)
+      done )
+    k ;
+  if md5 <> Digest.bytes pcm then failwith "FLAC: wrong MD5 signature" ;
+  Sys.remove filename
+
+let () =
+  (* Flac.Md5 fed by pieces against the standard library *)
+  let message = String.init 1000 (fun i -> Char.chr ((i * 31) land 0xff)) in
+  List.iter
+    (fun cuts ->
+      let h = Flac.Md5.create () in
+      let last =
+        List.fold_left
+          (fun start stop ->
+            String.sub message start (stop - start)
+            |> Bytes.of_string |> Flac.Md5.feed h ;
+            stop )
+          0 cuts
+      in
+      Flac.Md5.feed h
+        (Bytes.of_string (String.sub message last (1000 - last))) ;
+      if Flac.Md5.finish h <> Digest.string message then
+        failwith "Flac.Md5: wrong digest" )
+    [[]; [0]; [1; 55; 56; 64; 119; 120; 500]; [999]]
@@ -0,0 +1,98 @@
+(*****************************************************************************)
+(*                                                                           *)
+(*                                                                           *)
+(*  Copyright (C) 2023                                                       *)
+(*    Gabriel Santamaria                                                     *)
+(*                                                                           *)
+(*                                                                           *)
+(*  Licensed under the Apache License, Version 2.0 (the "License");          *)
+(*  you may not use this file except in compliance with the License.         *)
+(*  You may obtain a copy of the License at                                  *)
+(*                                                                           *)
+(*    http://www.apache.org/licenses/LICENSE-2.0                             *)
+(*                                                                           *)
+(*  Unless required by applicable law or agreed to in writing, software      *)
+(*  distributed under the License is distributed on an "AS IS" BASIS,        *)
+(*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *)
+(*  See the License for the specific language governing permissions and      *)
+(*  limitations under the License.                                           *)
+(*                                                                           *)
+(*****************************************************************************)
+
+(* the output of the limiter must never go beyond its ceiling, whatever the
+   input and the way it is cut in blocks, and must leave quiet signals
+   untouched *)
+
+open Soundml
+module Limiter = Effects.Dynamics.Limiter
+
+let sample_rate = 44100
+
+let channels = 2
+
+let frames = 50_000
+
+type planar = Helpers.planar
+
+(* white noise whose level jumps every 500 frames, with isolated spikes *)
+let loud () : planar =
+  Random.init 3 ;
+  let p = Audio.G.zeros Bigarray.Float32 [|channels; frames|] in
+  let level = ref 1. in
+  for i = 0 to frames - 1 do
+    if i mod 500 = 0 then level := Random.float 8. ;
+    for c = 0 to channels - 1 do
+      let v =
+        if Random.int 1000 = 0 then 20. else !level *. (Random.float 2. -. 1.)
+      in
+      Audio.G.set p [|c; i|] v
+    done
+  done ;
+  p
+
+(* float32 rounding of the delayed samples multiplied by the gain *)
+let bound (ceiling : float) : float =
+  Float.pow 10. (ceiling /. 20.) *. (1. +. 1e-6)
+
+let check_ceiling (name : string) (ceiling : float) (p : planar) : unit =
+  let m = Audio.G.max' (Audio.G.abs p) in
+  if m > bound ceiling then
+    failwith
+      (Printf.sprintf "%s: peak of %g over the ceiling of %g dB" name m ceiling)
+
+(* processes [p] by blocks of varying sizes, returning the output *)
+let stream (l : Limiter.t) (p : planar) : planar =
+  Helpers.stream (Limiter.process l) [|1; 7; 300; 1024; 4096; 13|] p
+
+let () =
+  List.iter
+    (fun (ceiling, lookahead, release) ->
+      let l =
+        Limiter.create ~ceiling ~lookahead ~release ~sample_rate ~channels ()
+      in
+      check_ceiling "Limiter" ceiling (stream l (loud ())) ;
+      (* the state is cleared by [reset] *)
+      Limiter.reset l ;
+      check_ceiling "Limiter after reset" ceiling (stream l (loud ())) )
+    [(-1., 0.005, 0.05); (-6., 0.001, 0.5); (0., 0., 0.01); (-0.1, 0.02, 0.)]
+
+let () =
+  (* a signal under the ceiling goes through unchanged, only delayed *)
+  let l = Limiter.create ~ceiling:(-1.) ~sample_rate ~channels () in
+  let p = Audio.G.mul_scalar (loud ()) (0.5 /. 28.) in
+  let y = stream l (Audio.G.copy p) in
+  let latency = Limiter.latency l in
+  let expected = Audio.G.get_slice [[]; [0; frames - latency - 1]] p in
+  let delayed = Audio.G.get_slice [[]; [latency; frames - 1]] y in
+  if not (Audio.G.equal expected delayed) then
+    failwith "Limiter: a quiet signal was modified"
+
+let () =
+  (* whole audio elements, with the latency compensated *)
+  let a =
+    Audio.Gen.noise ~sample_rate ~channels ~amplitude:4. Audio.Gen.White 1.
+  in
+  let y = Effects.Dynamics.limiter ~ceiling:(-3.) a in
+  if Audio.rawsize y <> Audio.rawsize a then
+    failwith "Dynamics.limiter: wrong length" ;
+  check_ceiling "Dynamics.limiter" (-3.) (Audio.data y)
@@ -0,0 +1,72 @@
+(*****************************************************************************)
+(*                                                                           *)
+(*                                                                           *)
+(*  Copyright (C) 2023                                                       *)
+(*    Gabriel Santamaria                                                     *)
+(*                                                                           *)
+(*                                                                           *)
+(*  Licensed under the Apache License, Version 2.0 (the "License");          *)
+(*  you may not use this file except in compliance with the License.         *)
+(*  You may obtain a copy of the License at                                  *)
+(*                                                                           *)
+(*    http://www.apache.org/licenses/LICENSE-2.0                             *)
+(*                                                                           *)
+(*  Unless required by applicable law or agreed to in writing, software      *)
+(*  distributed under the License is distributed on an "AS IS" BASIS,        *)
+(*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *)
+(*  See the License for the specific language governing permissions and      *)
+(*  limitations under the License.                                           *)
+(*                                                                           *)
+(*****************************************************************************)
+
+(* the SI-SDR of a signal against itself is unbounded, and the one of a
+   noisy copy matches the level of the added noise *)
+
+open Soundml
+module Metrics = Analysis.Metrics
+
+let sample_rate = 16000
+
+let reference : Audio.audio =
+  Audio.Gen.multitone ~sample_rate [(220., 0.5); (440., 0.3); (1250., 0.1)] 2.
+
+(* [reference] plus a white noise [snr] dB under it *)
+let noisy (snr : float) : Audio.audio =
+  let x = Audio.data reference in
+  let noise =
+    Audio.Gen.noise ~sample_rate ~seed:9 Audio.Gen.White 2. |> Audio.data
+  in
+  let power a = Audio.G.(sum' (sqr a)) in
+  let gain = sqrt (power x /. power noise /. Float.pow 10. (snr /. 10.)) in
+  Audio.G.add x (Audio.G.mul_scalar noise gain) |> Audio.set_data reference
+
+let () =
+  let itself = Metrics.si_sdr ~reference reference in
+  if not (itself > 100.) then
+    failwith
+      (Printf.sprintf "Metrics.si_sdr: %g dB for the signal itself" itself) ;
+  (* the measure ignores the scale of the estimate *)
+  let scaled = Audio.G.mul_scalar (Audio.data reference) 0.25 in
+  let s = Metrics.si_sdr ~reference (Audio.set_data reference scaled) in
+  if not (s > 100.) then
+    failwith (Printf.sprintf "Metrics.si_sdr: %g dB for a scaled copy" s) ;
+  List.iter
+    (fun snr ->
+      let s = Metrics.si_sdr ~reference (noisy snr) in
+      if Float.abs (s -. snr) > 0.5 then
+        failwith
+          (Printf.sprintf "Metrics.si_sdr: %g dB for a noise at %g dB" s snr) )
+    [0.; 10.; 20.; 40.] ;
+  (* the batch gives the same values as the single measures *)
+  let pairs = [|(reference, reference); (reference, noisy 10.)|] in
+  let scores = Metrics.evaluate ~domains:2 pairs in
+  Array.iteri
+    (fun i (r, e) ->
+      let s = Metrics.si_sdr ~reference:r e in
+      if scores.(i).Metrics.si_sdr <> s then
+        failwith "Metrics.evaluate: SI-SDR differs from Metrics.si_sdr" )
+    pairs ;
+  if not (scores.(0).Metrics.stoi > 0.99) then
+    failwith
+      (Printf.sprintf "Metrics.evaluate: STOI of %g for the signal itself"
+         scores.(0).Metrics.stoi )
@@ -0,0 +1,94 @@
+(*****************************************************************************)
+(*                                                                           *)
+(*                                                                           *)
+(*  Copyright (C) 2023                                                       *)
+(*    Gabriel Santamaria                                                     *)
+(*                                                                           *)
+(*                                                                           *)
+(*  Licensed under the Apache License, Version 2.0 (the "License");          *)
+(*  you may not use this file except in compliance with the License.         *)
+(*  You may obtain a copy of the License at                                  *)
+(*                                                                           *)
+(*    http://www.apache.org/licenses/LICENSE-2.0                             *)
+(*                                                                           *)
+(*  Unless required by applicable law or agreed to in writing, software      *)
+(*  distributed under the License is distributed on an "AS IS" BASIS,        *)
+(*  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied. *)
+(*  See the License for the specific language governing permissions and      *)
+(*  limitations under the License.                                           *)
+(*                                                                           *)
+(*****************************************************************************)
+
+(* moments merged from chunks must agree with the ones computed in a single
+   pass, and both with a direct two-pass computation *)
+
+open Soundml
+module Moments = Analysis.Stats.Moments
+
+(* exponential values far from zero, so that the result depends on the
+   numerical stability of the updates *)
+let values : float array =
+  Random.init 11 ;
+  Array.init 100_000 (fun _ -> 1000. -. log (1. -. Random.float 1.))
+
+(* mean and central moments of order 2, 3 and 4 computed in two passes *)
+let reference (x : float array) : float * float * float * float =
+  let n = float_of_int (Array.length x) in
+  let mean = Array.fold_left ( +. ) 0. x /. n in
+  let moment k =
+    Array.fold_left (fun acc v -> acc +. Float.pow (v -. mean) k) 0. x /. n
+  in
+  let m2 = moment 2. and m3 = moment 3. and m4 = moment 4. in
+  (mean, m2, m3 /. Float.pow m2 1.5, (m4 /. (m2 *. m2)) -. 3.)
+
+let close (name : string) (expected : float) (v : float) : unit =
+  if Float.abs (v -. expected) > 1e-8 *. Float.max 1. (Float.abs expected)
+  then
+    failwith
+      (Printf.sprintf "Moments: %s is %.17g, not %.17g" name v expected)
+
+let check (x : float array) (m : Moments.t) : unit =
+  let mean, variance, skewness, kurtosis = reference x in
+  if Moments.count m <> Array.length x then failwith "Moments: wrong count" ;
+  close "min" (Array.fold_left Float.min infinity x) (Moments.min m) ;
+  close "max" (Array.fold_left Float.max neg_infinity x) (Moments.max m) ;
+  close "mean" mean (Moments.mean m) ;
+  close "variance" variance (Moments.variance m) ;
+  close "skewness" skewness (Moments.skewness m) ;
+  close "kurtosis" kurtosis (Moments.kurtosis m)
+
+let of_values (x : float array) : Moments.t =
+  let m = Moments.create () in
+  Array.iter (Moments.add m) x ; m
+
+let () =
+  let single = of_values values in
+  check values single ;
+  (* uneven chunks, some of them empty, merged from left to right *)
+  let bounds = [0; 0; 1; 17; 5000; 5000; 61_234; 99_999; 100_000] in
+  let rec chunks = function
+    | a :: (b :: _ as rest) ->
+        of_values (Array.sub values a (b - a)) :: chunks rest
+    | _ ->
+        []
+  in
+  let parts = chunks bounds in
+  check values (List.fold_left Moments.merge (Moments.create ()) parts) ;
+  (* and as a balanced tree, in parallel *)
+  let items = Array.init 64 (fun i -> Array.sub values (i * 1562) 1562) in
+  let merged =
+    Analysis.Stats.reduce ~domains:4 of_values Moments.merge items
+    |> Option.get
+  in
+  check (Array.concat (Array.to_list items)) merged ;
+  (* merging leaves its arguments untouched *)
+  check (Array.sub values 5000 56_234) (List.nth parts 5) ;
+  (* views over audio data give the same moments as the values they hold *)
+  let data =
+    Bigarray.Array1.of_array Bigarray.Float32 Bigarray.c_layout values
+    |> Bigarray.genarray_of_array1
+  in
+  let m = Moments.create () in
+  Moments.add_view m (Audio.View.of_data data) ;
+  Array.init (Array.length values) (fun i -> Audio.G.get data [|i|])
+  |> Fun.flip check m